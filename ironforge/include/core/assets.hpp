@@ -121,6 +121,7 @@ namespace assets {
     auto cleanup(instance_t &inst) -> void;
 
     [[nodiscard]] auto get_config(std::string_view path) -> std::optional<std::string>;
+    // cached reads below may run on worker threads
     [[nodiscard]] auto get_text(instance_t &inst, std::string_view name) -> std::optional<text_data_t>;
     [[nodiscard]] auto get_image(instance_t &inst, std::string_view name) -> std::optional<image_data_t>;
     [[nodiscard]] auto get_binary(instance_t &inst, std::string_view name) -> std::optional<binary_data_t>;
@@ -1,6 +1,8 @@
 #pragma once
 
 #include <cstdint>
+#include <thread>
+#include <mutex>
 #include <variant>
 #include <system_error>
 #include <string_view>
@@ -16,6 +18,18 @@
 namespace game {
     constexpr auto timestep = 0.002f;
 
+    ///
+    /// \brief Simulation on its own thread, render side presents a copy of the scene
+    /// updated from published render state
+    ///
+    struct simulation_instance {
+        std::thread                                     thread;
+        std::mutex                                      events_mutex;
+        std::vector<SDL_Event>                          events;
+        scene::render_exchange                          exchange;
+        scene::instance_t                               view;
+    };
+
     ///
     /// \brief Application instance
     ///
@@ -43,6 +57,8 @@ namespace game {
         scenes_type                                     scenes;
         scenes_type::size_type                          current_scene_index = 0;
         std::unique_ptr<renderer::instance>             render;
+        std::unique_ptr<scene::rewind_buffer>           rewind; // optional, "rewind" in config
+        std::unique_ptr<simulation_instance>            simulation; // optional, "threaded_simulation" in config
         video::instance_t                               vi;
         ui::context                                     uic;
         //imui::context_t                                 imui;
@@ -50,8 +66,7 @@ namespace game {
         uint64_t                                        current_time = 0ull;
         uint64_t                                        last_time = 0ull;
         uint64_t                                        timesteps = 0ull;
-        float                                           delta_accumulator = 0.0f;
-        bool                                            running = true;
+        utility::copyable_atomic<bool>                  running = true;
     } instance_t;
 
     using game_result = std::variant<instance_t, std::error_code>;
@@ -88,4 +103,12 @@ namespace game {
     /// \return system exit code
     ///
     [[nodiscard]] auto launch(instance_t &app) -> int;
+
+    ///
+    /// \brief Rewind current scene bodies and simulate again
+    /// \param[in] ticks Number of timesteps to go back
+    /// \param[in] resimulate Number of timesteps to simulate after rewind
+    /// \return false if history is too short, rewind is disabled or simulation is threaded
+    ///
+    auto rewind(instance_t &app, const uint32_t ticks, const uint32_t resimulate = 0) -> bool;
 } // namespace game
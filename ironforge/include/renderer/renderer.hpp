@@ -32,10 +32,29 @@ namespace renderer {
         virtual auto append(const phong::ambient_light &light) -> void = 0;
         virtual auto append(const phong::directional_light &light) -> void = 0;
         virtual auto append(const phong::point_light &light) -> void = 0;
-        virtual auto append(const phong::material &material) -> void = 0;
-        virtual auto append(const video::vertices_source &source, const video::vertices_draw &draw, const glm::mat4 &model) -> void = 0;
+        virtual auto append(const video::vertices_source &source, const video::vertices_draw &draw, const glm::mat4 &model, const uint32_t material) -> void = 0;
         virtual auto append(const video::texture &tex, const uint32_t flags) -> void = 0;
-        // TODO: think about add/remove from ubo mechanism
+
+        ///
+        /// \brief Register material once, draws reference it by returned index
+        ///
+        virtual auto register_material(const phong::material &material) -> uint32_t = 0;
+
+        ///
+        /// \brief Replace registered material, draws with its index use new values
+        ///
+        virtual auto update_material(const uint32_t index, const phong::material &material) -> void = 0;
+
+        ///
+        /// \brief Screen space quads for count particles, filled by caller before present, nullptr when full
+        ///
+        virtual auto append_particles(const uint32_t count) -> video::v3t2c4* = 0;
+
+        ///
+        /// \brief Lights, draws and particles appended after it are seen by given camera and
+        /// drawn over previous layers after depth clear, earlier ones use camera of present
+        ///
+        virtual auto begin_layer(const glm::mat4 &proj, const glm::mat4 &view) -> void = 0;
 
         virtual auto reset() -> void = 0;
         virtual auto present(video::instance_t &in, const glm::mat4 &proj, const glm::mat4 &view) -> void = 0;
@@ -1,5 +1,7 @@
 #pragma once
 
+#include <chrono>
+#include <memory>
 #include <string>
 #include <unordered_map>
 
@@ -7,13 +9,22 @@
 #include "../../src/scene/material.hpp"
 #include "../../src/scene/camera.hpp"
 #include "../../src/scene/script.hpp"
+#include "../../src/scene/coroutine.hpp"
 #include "../../src/scene/physics.hpp"
 #include "../../src/scene/input.hpp"
 #include "../../src/scene/transform.hpp"
 #include "../../src/scene/light.hpp"
 #include "../../src/scene/timer.hpp"
+#include "../../src/scene/event.hpp"
 #include "../../src/scene/emitter.hpp"
+#include "../../src/scene/occlusion.hpp"
 #include "../../src/scene/entity.hpp"
+#include "../../src/scene/culling.hpp"
+#include "../../src/scene/snapshot.hpp"
+#include "../../src/scene/rewind.hpp"
+#include "../../src/scene/render_state.hpp"
+#include "../../src/scene/prefab.hpp"
+#include "../../src/scene/streaming.hpp"
 
 namespace scene {
     struct bound_box; // AABB
@@ -30,7 +41,6 @@ namespace scene {
     constexpr size_t max_scripts        = 20;
     constexpr size_t max_input_sources  = 20;
     constexpr size_t max_inputs         = 100;
-    constexpr size_t max_timers         = 100;
 
     constexpr size_t initial_name = 100;
     constexpr size_t initial_material = 100;
@@ -43,6 +53,7 @@ namespace scene {
     constexpr size_t initial_transform = 100;
     constexpr size_t initial_emitter = 20;
     constexpr size_t initial_light = 100;
+    constexpr size_t initial_occluder = 20;
 
     typedef struct instance_type {
         using index_t = uint32_t;
@@ -56,13 +67,14 @@ namespace scene {
         using transform_t = transform_instance;
         using emitter_t = emitter_instance;
         using light_t = light_instance;
+        using occluder_t = occluder_instance;
 
         instance_type();
 
         // entity
         std::unordered_map<name_t, index_t>         names;
-        std::unordered_map<index_t, material_t>     materials;
-        std::unordered_map<index_t, model_t>        models;
+        std::unordered_map<index_t, material_handle> materials;
+        std::unordered_map<index_t, model_component> models;
         std::unordered_map<index_t, camera_t>       cameras;
         std::unordered_map<index_t, script_t>       scripts;
         std::unordered_map<index_t, body_t>         bodies;
@@ -70,13 +82,35 @@ namespace scene {
         std::unordered_map<index_t, transform_t>    transforms;
         std::unordered_map<index_t, emitter_t>      emitters;
         std::unordered_map<index_t, light_t>        lights;
+        std::unordered_map<index_t, occluder_t>     occluders;
 
         std::unordered_map<std::string, std::vector<input_action>> input_sources;
-        std::unordered_map<std::string, model_t>    all_models;
-        std::unordered_map<std::string, material_t> all_materials;
+        input_dispatch_table                                input_dispatch;
+        std::unordered_map<std::string, model_handle>       all_models;
+        std::unordered_map<std::string, material_handle>    all_materials;
+        std::unordered_map<std::string, prefab_instance>    prefabs;
+        std::shared_ptr<world_streaming>                    streaming; // optional, "streaming" in scene
+        timer_wheel                                         timers;
+        std::unordered_map<subscription_id, timer_handle>   script_timers; // Lua timers by subscription id
+        std::vector<coroutine_scheduler>                    coroutines; // per script group, Lua states are shared by scenes
+        event_bus                                           events;
+
+        // shared, addressed by handle
+        std::vector<model_t>                        model_storage;
+        std::vector<model_handle>                   free_models; // released slots
+        std::vector<material_t>                     material_storage; // default_material first
+        std::vector<material_handle>                free_materials; // released slots, keep renderer index
+        std::vector<material_handle>                updated_materials; // reused registered slots, repacked by renderer
+        size_t                                      registered_materials = 0; // already known by renderer
 
         video::texture                              skybox;
 
+        // per frame
+        std::vector<render_candidate>               render_candidates;
+        std::vector<occluder_draw>                  occluder_draws;
+        occlusion_buffer                            occlusion;
+        std::chrono::steady_clock::time_point       last_present; // particles advance by frame time
+
         auto get_script(const uint32_t index) -> script_t& {
             return scripts[index];
         }
@@ -89,5 +123,10 @@ namespace scene {
 
         index_t current_camera_index = 0;
         index_t current_entity_id = 1;
+
+        // live scenes step independently, 0 pauses
+        float time_scale = 1.f;
+        float accumulator = 0.f;
+        bool visible = true; // composited by present
     } instance_t;
 } // namespace scene
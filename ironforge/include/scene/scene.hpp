@@ -33,13 +33,37 @@ namespace scene {
 
     auto cleanup_all(std::vector<instance_t> &scenes) -> void;
     [[nodiscard]] auto load(assets::instance_t &asset, video::instance_t &vi, const std::string &path, const bool directly = false) -> load_result;
+    // textures, effects, materials, models, inputs and prefabs of scene or world cell
+    auto load_resources(assets::instance_t &asset, video::instance_t &vi, instance_t &sc, const json &j) -> void;
     auto update(instance_t &sc, const float dt) -> void;
+
+    // physics and timers, touch only own scene, so different scenes can run them concurrently
+    auto update_systems(instance_t &sc, const float dt) -> void;
+    // events and scripts, Lua states are shared by all scenes, so one scene at a time
+    auto update_scripts(instance_t &sc, const float dt) -> void;
+
     auto process_event(instance_t &sc, const SDL_Event &ev) -> void;
+
+    struct scene_layer {
+        instance_t  *scene = nullptr;
+        float       interpolation = 0.f;
+    };
+
+    ///
+    /// \brief Draws scenes into one frame in layer order, each with its own camera and lights,
+    /// depth is cleared between layers, first layer gives skybox
+    ///
+    auto present(video::instance_t &vi, const std::vector<scene_layer> &layers, std::unique_ptr<renderer::instance> &render) -> void;
     auto present(video::instance_t &vi, instance_t &sc, std::unique_ptr<renderer::instance> &render, const float interpolation) -> void;
 
-    auto cache_model(instance_t &sc, const std::string &name, const model_instance &m) -> bool;
-    auto cache_material(instance_t &sc, const std::string &name, const material_instance &m) -> bool;
+    auto cache_model(instance_t &sc, const std::string &name, const model_instance &m) -> std::optional<model_handle>;
+    auto cache_material(instance_t &sc, const std::string &name, const material_instance &m) -> std::optional<material_handle>;
+
+    // destroys meshes, slot is reused by next cache_model
+    auto release_model(video::instance_t &vi, instance_t &sc, const std::string &name) -> void;
+    // slot and its renderer index are reused by next cache_material
+    auto release_material(instance_t &sc, const std::string &name) -> void;
 
-    auto get_model(instance_t &sc, const std::string &name) -> std::optional<model_instance>;
-    auto get_material(instance_t &sc, const std::string &name) -> std::optional<material_instance>;
+    auto get_model(const instance_t &sc, const std::string &name) -> std::optional<model_handle>;
+    auto get_material(const instance_t &sc, const std::string &name) -> std::optional<material_handle>;
 } // namespace scene
@@ -11,10 +11,21 @@ namespace scene {
 
     struct bound_sphere {
         glm::vec3 center = glm::vec3(0.f);
-        glm::vec3 radius = glm::vec3(0.f);
+        float     radius = 0.f;
     };
 
     struct oriented_bound_box {
 
     };
+
+    struct frustum {
+        glm::vec4 planes[6]; // left, right, bottom, top, near, far; normals point inside
+    };
+
+    auto make_frustum(const glm::mat4 &projection_view) -> frustum;
+
+    // NOTE: zero sized box mean bounds are unknown
+    auto is_empty(const bound_box &box) noexcept -> bool;
+    auto transform_bound_box(const bound_box &box, const glm::mat4 &model) -> bound_box;
+    auto is_visible(const frustum &f, const bound_box &box) noexcept -> bool;
 } // namespace scene
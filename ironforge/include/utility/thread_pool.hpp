@@ -8,6 +8,8 @@
 #include <future>
 #include <functional>
 #include <chrono>
+#include <algorithm>
+#include <type_traits>
 
 namespace utils {
     class thread_pool {
@@ -39,8 +41,8 @@ namespace utils {
         }
 
         template<class F, class... Args>
-        auto enqueue(F&& f, Args&&... args) -> std::future<typename std::result_of<F(Args...)>::type> {
-            using return_type = typename std::result_of<F(Args...)>::type;
+        auto enqueue(F&& f, Args&&... args) -> std::future<std::invoke_result_t<F, Args...>> {
+            using return_type = std::invoke_result_t<F, Args...>;
 
             auto task = std::make_shared<std::packaged_task<return_type()>>(std::bind(std::forward<F>(f), std::forward<Args>(args)...));
             std::future<return_type> res = task->get_future();
@@ -61,6 +63,32 @@ namespace utils {
             return res;
         }
 
+        ///
+        /// \brief Run one queued task on the calling thread
+        /// \return false if there was nothing to run
+        ///
+        auto run_pending_task() -> bool {
+            std::function<void()> task;
+
+            {
+                std::unique_lock<std::mutex> lock(queue_mutex);
+
+                if (tasks.empty())
+                    return false;
+
+                task = std::move(tasks.front());
+                tasks.pop();
+            }
+
+            task();
+
+            return true;
+        }
+
+        auto size() const noexcept -> size_t {
+            return workers.size();
+        }
+
         ~thread_pool() {
             {
                 std::unique_lock<std::mutex> lock(queue_mutex);
@@ -87,6 +115,52 @@ namespace utils {
         std::condition_variable             condition;
         bool                                stop;
     };
+
+    ///
+    /// \brief Engine wide worker pool, the calling thread is counted as one of workers
+    ///
+    inline auto shared_pool() -> thread_pool& {
+        static thread_pool pool{std::max<size_t>(std::thread::hardware_concurrency(), 2) - 1};
+        return pool;
+    }
+
+    ///
+    /// \brief Split [0, count) into chunks and run fn(begin, end) for each of them on the pool.
+    /// The calling thread takes the first chunk and helps with queued tasks while waiting,
+    /// so it is safe to call from inside a pool task.
+    ///
+    template <typename F>
+    auto parallel_for(thread_pool &pool, const size_t count, const size_t chunk_size, F &&fn) -> void {
+        if (count == 0)
+            return;
+
+        const auto chunk = std::max<size_t>(chunk_size, 1);
+
+        if (count <= chunk || pool.size() == 0) {
+            fn(size_t{0}, count);
+            return;
+        }
+
+        std::vector<std::future<void>> chunks;
+        chunks.reserve(count / chunk);
+
+        for (size_t begin = chunk; begin < count; begin += chunk) {
+            const auto end = std::min(begin + chunk, count);
+            chunks.push_back(pool.enqueue([&fn, begin, end] {
+                fn(begin, end);
+            }));
+        }
+
+        fn(size_t{0}, chunk);
+
+        for (auto &c : chunks)
+            while (c.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+                if (!pool.run_pending_task())
+                    std::this_thread::yield();
+
+        for (auto &c : chunks)
+            c.get();
+    }
 } // namespace utils
 
 /*void test() {
@@ -57,8 +57,8 @@ namespace video {
         auto destroy_buffer(buffer &buf) -> void;
         auto bind_buffer(buffer &buf) -> void;
         auto unbind_buffer(buffer &buf) -> void;
-        // auto bind_buffer_range() -> void;
-        // auto bind_buffer_base() -> void;
+        auto bind_buffer_range(buffer &buf, const uint32_t index, const size_t offset, const size_t size) -> void;
+        auto bind_buffer_base(buffer &buf, const uint32_t index) -> void;
         auto update_buffer(buffer &buf, const size_t offset, const void *data, const size_t size) -> void;
         auto map_buffer(buffer &buf, const buffer_access access) -> void*;
         auto unmap_buffer(buffer &buf) -> bool;
@@ -15,11 +15,26 @@ namespace video {
 
     namespace gl330 {
 
+        // per instance attributes, model matrix takes four locations
+        constexpr uint32_t instance_model_location = 8;
+        constexpr uint32_t instance_material_location = 12;
+
+        struct instance_attributes {
+            glm::mat4   model;
+            int32_t     material;
+            int32_t     padding[3];
+        };
+
         namespace detail {
             struct clear {
                 clear() = default;
             };
 
+            // depth only, color of previous passes stays
+            struct clear_depth {
+                clear_depth() = default;
+            };
+
             struct viewport {
                 viewport() = default;
                 viewport(const framebuffer &fb) : x{0}, y{0}, w{static_cast<int32_t>(fb.width)}, h{static_cast<int32_t>(fb.height)} {
@@ -39,6 +54,10 @@ namespace video {
                     
                 }
 
+                draw_elements(const vertices_draw &vd, const uint32_t instances) : mode{vd.mode}, count{vd.count}, primcount{instances}, base_vertex{0}, indices_offset{0} {
+
+                }
+
                 uint32_t mode = 0;
                 uint32_t type = 0;
                 uint32_t count = 0;
@@ -54,6 +73,10 @@ namespace video {
 
                 }
 
+                draw_arrays(const vertices_draw &vd, const uint32_t instances) : mode{vd.mode}, count{vd.count}, primcount{instances}, first{0} {
+
+                }
+
                 uint32_t mode;
                 uint32_t count;
                 uint32_t primcount;
@@ -81,8 +104,8 @@ namespace video {
             struct bind_texture {
                 bind_texture() = default;
 
-                bind_texture(const program &p, const std::string_view name, uint32_t _unit, const texture &tex)
-                    : unit{_unit}, target{tex.target}, texture{tex.id}, location{get_uniform_location(p, name)} {
+                bind_texture(const uniform_handle u, uint32_t _unit, const texture &tex)
+                    : unit{_unit}, target{tex.target}, texture{tex.id}, location{u.location} {
 
                 }
 
@@ -111,16 +134,41 @@ namespace video {
                 uint32_t id;
             };
 
+            // points instance attributes of bound vertex array to instance_attributes at offset
+            struct bind_instances {
+                bind_instances() = default;
+                bind_instances(const buffer &b, const size_t _offset) : buf{b.id}, offset{_offset} {
+
+                }
+
+                uint32_t    buf;
+                size_t      offset;
+            };
+
+            struct bind_buffer_range {
+                bind_buffer_range() = default;
+                bind_buffer_range(const buffer &b, const uint32_t _index, const size_t _offset, const size_t _size)
+                    : buf{b.id}, target{b.target}, index{_index}, offset{_offset}, size{_size} {
+
+                }
+
+                uint32_t    buf;
+                uint32_t    target;
+                uint32_t    index;
+                size_t      offset;
+                size_t      size;
+            };
+
             struct bind_uniform {
                 bind_uniform() = default;
 
-                bind_uniform(const program &p, const std::string_view name, const glm::mat4 &m);
-                bind_uniform(const program &p, const std::string_view name, const glm::mat3 &m);
-                bind_uniform(const program &p, const std::string_view name, const float &value);
-                bind_uniform(const program &p, const std::string_view name, const glm::vec2 &value);
-                bind_uniform(const program &p, const std::string_view name, const glm::vec3 &value);
-                bind_uniform(const program &p, const std::string_view name, const glm::vec4 &value);
-                bind_uniform(const program &p, const std::string_view name, const int &value);
+                bind_uniform(const uniform_handle u, const glm::mat4 &m);
+                bind_uniform(const uniform_handle u, const glm::mat3 &m);
+                bind_uniform(const uniform_handle u, const float &value);
+                bind_uniform(const uniform_handle u, const glm::vec2 &value);
+                bind_uniform(const uniform_handle u, const glm::vec3 &value);
+                bind_uniform(const uniform_handle u, const glm::vec4 &value);
+                bind_uniform(const uniform_handle u, const int &value);
 
                 int32_t location;
                 uint32_t type;
@@ -166,7 +214,7 @@ namespace video {
             };
         } // namespace detail
 
-        typedef std::variant<detail::clear, detail::viewport, detail::draw_elements, detail::draw_arrays, detail::bind_framebuffer, detail::bind_program, detail::bind_texture, detail::bind_sampler, detail::bind_vertex_array, detail::bind_uniform, detail::update, detail::blit> command;
+        typedef std::variant<detail::clear, detail::clear_depth, detail::viewport, detail::draw_elements, detail::draw_arrays, detail::bind_framebuffer, detail::bind_program, detail::bind_texture, detail::bind_sampler, detail::bind_vertex_array, detail::bind_instances, detail::bind_buffer_range, detail::bind_uniform, detail::update, detail::blit> command;
 
     } // namespace gl330
 
@@ -44,6 +44,8 @@ namespace video {
         auto operator <<(command_buffer &cb, const detail::bind_uniform &c) -> command_buffer&;
 
         auto dispath_command(const command &c, command_buffer &buf) -> void;
+        // forgets bound objects, other code binds between frames
+        auto reset_dispatch_cache() -> void;
 
     } // namespace gl330
 
@@ -30,6 +30,18 @@ namespace video {
             uint32_t        type;
         };
 
+        struct uniform_block {
+            std::string     name;
+            uint64_t        name_hash;
+            uint32_t        index;
+            int32_t         size;
+        };
+
+        // location resolved once per program, -1 when program doesn't use uniform
+        struct uniform_handle {
+            int32_t location = -1;
+        };
+
         struct program_info {
             std::string name;
             std::vector<shader_source>  sources;
@@ -42,11 +54,17 @@ namespace video {
             std::vector<shader_source>  sources;
             std::vector<uniform>        uniforms;
             std::vector<attribute>      attributes;
+            std::vector<uniform_block>  uniform_blocks;
         };
 
         auto create_program(const program_info &info) -> program;
         auto destroy_program(program &pro) -> void;
         auto get_uniform_location(const program &pro, const std::string_view name) -> int32_t;
+        // for tables built with program, missing uniforms are expected there
+        auto get_uniform(const program &pro, const std::string_view name) -> uniform_handle;
+        // -1 when program has no such active attribute
+        auto get_attribute_location(const program &pro, const std::string_view name) -> int32_t;
+        auto bind_uniform_block(const program &pro, const std::string_view name, const uint32_t binding) -> bool;
     } // namespace gl330
 
 } // namespace video
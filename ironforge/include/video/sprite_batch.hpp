@@ -5,6 +5,7 @@
 #include <video/video.hpp>
 
 namespace video {
+    constexpr uint32_t max_sprites_per_draw = 16384; // 16 bit indices, larger batches are drawn with base vertex
 
     struct sprite_batch_info {
         uint32_t                max_sprites;
@@ -21,6 +22,9 @@ namespace video {
         std::vector<uint16_t>   indices;
 
         vertices_source         source;
+
+        uint32_t                program = 0; // color_map is resolved for it
+        gl::uniform_handle      color_map;
     };
 
     auto create_sprite_batch(instance_t &vi, const sprite_batch_info &info) -> sprite_batch;
@@ -29,6 +33,14 @@ namespace video {
     auto append_sprite_vertices(sprite_batch &sb, const v3t2c4 (&vertices)[4]) -> void;
     auto append_sprite(sprite_batch &sb, const glm::vec3 &position, const glm::vec2 size, const glm::vec4 offset, const glm::vec4 color) -> void;
 
+    // vertices of count new sprites to be filled by caller, nullptr when batch is full
+    auto map_sprites(sprite_batch &sb, const uint32_t count) -> v3t2c4*;
+
     auto submit_sprite_batch(gl::command_buffer &cb, sprite_batch &sb, const gl::program &pm, const gl::sampler &sr) -> void;
 
+    // same as submit in steps, so ranges of one upload could go into different command buffers
+    auto update_sprite_batch(gl::command_buffer &cb, sprite_batch &sb) -> void;
+    auto submit_sprite_range(gl::command_buffer &cb, sprite_batch &sb, const gl::program &pm, const gl::sampler &sr, const uint32_t first, const uint32_t count) -> void;
+    auto clear_sprite_batch(sprite_batch &sb) -> void;
+
 } // namespace video
@@ -5,13 +5,21 @@
 
 namespace video {
 
+    constexpr uint32_t max_stats_lods = 4; // last one counts all coarser levels
+
     struct drawing_info {
         uint32_t    dips;
         uint32_t    tris;
         uint32_t    tex_bindings;
         uint32_t    prg_bindings;
+        uint32_t    state_changes; // binds dispatched
+        uint32_t    state_skips; // binds dropped, object already bound
+        uint32_t    culled;
+        uint32_t    occluded;
+        uint32_t    lods[max_stats_lods];
+        float       particles_ms; // cpu time of particle simulation and projection
         float       tv;
-        char        info[100];
+        char        info[192];
         size_t      info_size;
     };
 
@@ -42,6 +50,30 @@ namespace video {
         video_stats.prg_bindings++;
     }
 
+    inline void stats_inc_state_changes() {
+        video_stats.state_changes++;
+    }
+
+    inline void stats_inc_state_skips() {
+        video_stats.state_skips++;
+    }
+
+    inline void stats_add_culled(uint32_t n) {
+        video_stats.culled += n;
+    }
+
+    inline void stats_add_occluded(uint32_t n) {
+        video_stats.occluded += n;
+    }
+
+    inline void stats_add_lod(uint32_t lod) {
+        video_stats.lods[lod < max_stats_lods ? lod : max_stats_lods - 1]++;
+    }
+
+    inline void stats_add_particles_time(const float ms) {
+        video_stats.particles_ms += ms;
+    }
+
     inline void stats_update(const float dt) {
         stats::update(video_stats, dt);
     }
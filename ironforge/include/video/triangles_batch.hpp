@@ -17,6 +17,9 @@ namespace video {
 
         std::vector<v3t2c4>     vertices;
         vertices_source         source;
+
+        uint32_t                program = 0; // color_map is resolved for it
+        gl::uniform_handle      color_map;
     };
 
     auto create_triangles_batch(instance_t &vi, const triangles_batch_info &info) -> triangles_batch;
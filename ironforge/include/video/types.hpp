@@ -14,6 +14,7 @@ namespace video {
         vertices_desc   desc;
         vertices_source source;
         vertices_draw   draw;
+        vertices_bounds bounds;
     };
 
 } // namespace video
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include <video/buffer.hpp>
+
+namespace video {
+
+    namespace gl330 {
+
+        constexpr uint32_t uniform_ring_frames = 3;
+
+        // std140 blocks of one frame go to own region, so regions still read by GPU are not written
+        struct uniform_ring {
+            buffer                  buf;
+            size_t                  region_size = 0;
+            size_t                  alignment = 256; // GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT
+            uint32_t                frame = 0;
+            std::vector<uint8_t>    staging; // current frame, uploaded in one call
+        };
+
+        auto create_uniform_ring(const size_t region_size) -> uniform_ring;
+        auto destroy_uniform_ring(uniform_ring &ring) -> void;
+
+        inline auto aligned_uniform_size(const uniform_ring &ring, const size_t size) -> size_t {
+            return (size + ring.alignment - 1) / ring.alignment * ring.alignment;
+        }
+
+        // moves to next region, grows buffer when frame needs more than region_size
+        auto begin_uniform_frame(uniform_ring &ring, const size_t size) -> void;
+        // offset in buffer for bind_buffer_range
+        auto push_uniforms(uniform_ring &ring, const void *data, const size_t size) -> size_t;
+        auto upload_uniform_frame(uniform_ring &ring) -> void;
+
+        template <typename T>
+        inline auto push_uniforms(uniform_ring &ring, const T &block) -> size_t {
+            return push_uniforms(ring, &block, sizeof block);
+        }
+
+    } // namespace gl330
+
+} // namespace video
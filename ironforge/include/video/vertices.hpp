@@ -66,9 +66,17 @@ namespace video {
         size_t      indices_num;
     };
 
+    struct vertices_bounds {
+        glm::vec3   min = glm::vec3{0.f};
+        glm::vec3   max = glm::vec3{0.f};
+        glm::vec3   center = glm::vec3{0.f};
+        float       radius = 0.f;
+    };
+
     struct vertices_info {
-        vertices_data data;
-        vertices_desc desc;
+        vertices_data   data;
+        vertices_desc   desc;
+        vertices_bounds bounds;
     };
 
     struct vertices_draw {
@@ -15,6 +15,7 @@
 #include <video/command.hpp>
 #include <video/command_buffer.hpp>
 #include <video/buffer.hpp>
+#include <video/uniform_ring.hpp>
 #include <video/vertex_array.hpp>
 #include <video/texture.hpp>
 #include <video/image_gen.hpp>
@@ -135,9 +136,33 @@ namespace video {
     auto create_program(assets::instance_t &asset, instance_t &inst, const json &info) -> program;
     auto create_mesh(assets::instance_t &asset, instance_t &vi, const json &info) -> std::optional<mesh>;
 
+    // decoded images of one texture, one for 2d and six for cubemap
+    struct texture_data {
+        std::string             name;
+        bool                    cubemap = false;
+        std::vector<image_data> images;
+    };
+
+    // create_* split into file reading without video context, safe on worker threads, and upload
+    auto read_texture(assets::instance_t &asset, const uint32_t texture_level, const json &info) -> std::optional<texture_data>;
+    auto read_program(assets::instance_t &asset, const json &info) -> std::optional<gl::program_info>;
+
+    // already created resource with the same name is returned as is
+    auto upload_texture(instance_t &vi, const texture_data &data) -> texture;
+    auto upload_program(instance_t &vi, const gl::program_info &info) -> program;
+    auto upload_mesh(instance_t &vi, const vertices_info &info) -> mesh;
+
+    // release resources created above before cleanup, for parts of world loaded on demand
+    auto destroy_texture(instance_t &vi, const std::string &name) -> void;
+    auto destroy_mesh(instance_t &vi, mesh &m) -> void;
+    auto create_vertices_info(assets::instance_t &asset, const json &info) -> std::optional<vertices_info>;
+
     auto make_texture_2d(instance_t &vi, const std::string &name, const image_data &data, const uint32_t flags) -> texture;
     auto make_texture_cube(instance_t &vi, const std::string &name, const std::string (&names)[6]) -> texture;
     auto make_vertices_source(instance_t &vi, const std::vector<vertices_data> &data, const vertices_desc &desc, std::vector<vertices_draw> &draws) -> vertices_source;
+    auto calc_vertices_bounds(const vertices_data &data, const vertices_desc &desc) -> vertices_bounds;
+    auto get_vertex_stride(const vertex_format vf) -> size_t;
+    auto read_triangles(const vertices_data &data, const vertices_desc &desc, std::vector<glm::vec3> &positions, std::vector<uint32_t> &indices) -> bool;
 
     auto get_texture(instance_t &vi, const std::string &name) -> texture;
     auto get_heightmap(instance_t &vi, const std::string &name) -> heightmap_t;
@@ -12,6 +12,7 @@ namespace fs = std::experimental::filesystem;
 namespace assets {
 
     std::mutex      text_mutex;
+    std::mutex      cache_mutex; // caches below are shared with streaming workers, files are read unlocked
 
     static auto is_readable(const instance_t &inst, const std::string &ext) -> bool {
         if (inst.binary_readers.find(ext) != inst.binary_readers.end())
@@ -203,10 +204,12 @@ namespace assets {
     auto get_text(instance_t &inst, std::string_view name) -> std::optional<text_data_t> {
         const auto _name = std::string{name};
 
-        auto t = inst.texts.find(_name);
+        {
+            std::lock_guard lock(cache_mutex);
 
-        if (t != inst.texts.end())
-            return t->second;
+            if (auto t = inst.texts.find(_name); t != inst.texts.end())
+                return t->second;
+        }
 
         auto f = inst.all_files.find(_name);
 
@@ -223,6 +226,7 @@ namespace assets {
                 }
 
                 game::journal::debug(game::journal::_GAME, "Read file %", f->second);
+                std::lock_guard lock(cache_mutex);
                 inst.texts.insert({p.filename().string(), res.value()});
                 return res.value();
             }
@@ -240,10 +244,12 @@ namespace assets {
     auto get_image(instance_t &inst, std::string_view name) -> std::optional<image_data_t> {
         const auto _name = std::string{name};
 
-        auto im = inst.images.find(_name);
+        {
+            std::lock_guard lock(cache_mutex);
 
-        if (im != inst.images.end())
-            return im->second;
+            if (auto im = inst.images.find(_name); im != inst.images.end())
+                return im->second;
+        }
 
         auto f = inst.all_files.find(_name);
 
@@ -261,6 +267,7 @@ namespace assets {
                 }
 
                 game::journal::debug(game::journal::_GAME, "Read file %", f->second);
+                std::lock_guard lock(cache_mutex);
                 inst.images.insert({p.filename().string(), res.value()}); // TODO: free memory
                 return res.value();
             }
@@ -276,10 +283,12 @@ namespace assets {
     auto get_binary(instance_t &inst, std::string_view name) -> std::optional<binary_data_t> {
         const auto _name = std::string{name};
 
-        auto bin = inst.binaries.find(_name);
+        {
+            std::lock_guard lock(cache_mutex);
 
-        if (bin != inst.binaries.end())
-            return bin->second;
+            if (auto bin = inst.binaries.find(_name); bin != inst.binaries.end())
+                return bin->second;
+        }
 
         auto f = inst.all_files.find(_name);
 
@@ -297,6 +306,7 @@ namespace assets {
                 }
 
                 game::journal::debug(game::journal::_GAME, "Read file %", f->second);
+                std::lock_guard lock(cache_mutex);
                 inst.binaries.insert({p.filename().string(), res.value()});
                 return res.value();
             }
@@ -16,6 +16,7 @@
 #include <video/video.hpp>
 #include <renderer/renderer.hpp>
 #include <scene/scene.hpp>
+#include <utility/thread_pool.hpp>
 
 #include "game_detail.hpp"
 #include "config.h"
@@ -32,11 +33,20 @@ namespace game {
 
             input::process_event(app, ev);
             //ui::process_event(in.uic, ev);
+
+            if (app.simulation) {
+                std::lock_guard<std::mutex> lock(app.simulation->events_mutex);
+                app.simulation->events.push_back(ev);
+                continue;
+            }
+
             scene::process_event(app.current_scene(), ev);
         }        
     }
 
     static auto cleanup_all(instance_t &app) -> void {
+        app.simulation.reset(nullptr);
+        app.rewind.reset(nullptr);
         app.render.reset(nullptr);
 
         video::cleanup(app.vi);
@@ -44,18 +54,128 @@ namespace game {
         assets::cleanup(app.asset_instance);
     }
 
-    static auto update(instance_t &app, const float dt) -> void {
+    // once per frame, scenes are stepped separately
+    static auto update_frame(instance_t &app, const float dt) -> void {
         input::update(app);
         assets::process(app.asset_instance);
-        scene::update(app.current_scene(), dt);
         video::process_resources(app.asset_instance, app.vi);
+        video::stats_update(dt);
+    }
+
+    // live scenes step in rounds, systems of stepping scenes run in parallel,
+    // scripts share Lua states, so they follow one scene at a time
+    static auto update_scenes(instance_t &app, const float dt) -> void {
+        auto &current = app.current_scene();
+
+        for (auto &sc : app.scenes)
+            sc.accumulator += dt * sc.time_scale;
+
+        std::vector<scene::instance_t*> stepping;
+        stepping.reserve(app.scenes.size());
+
+        for (;;) {
+            stepping.clear();
+
+            for (auto &sc : app.scenes)
+                if (sc.accumulator >= timestep) {
+                    sc.accumulator -= timestep;
+                    stepping.push_back(&sc);
+                }
+
+            if (stepping.empty())
+                break;
+
+            if (stepping.size() == 1)
+                scene::update_systems(*stepping.front(), timestep);
+            else
+                utils::parallel_for(utils::shared_pool(), stepping.size(), 1, [&stepping] (const size_t begin, const size_t end) {
+                    for (size_t i = begin; i < end; i++)
+                        scene::update_systems(*stepping[i], timestep);
+                });
+
+            for (auto sc : stepping)
+                scene::update_scripts(*sc, timestep);
+
+            // ticks and rewind follow current scene
+            if (std::find(stepping.begin(), stepping.end(), &current) != stepping.end()) {
+                app.timesteps++;
+
+                if (app.rewind)
+                    scene::record_tick(*app.rewind, current, app.timesteps);
+            }
+        }
     }
 
-    static auto present(instance_t &app, const float interpolation) -> void {
+    static auto present(instance_t &app, scene::instance_t &sc, const float interpolation) -> void {
         using std::placeholders::_1;
         //ui::present(in.uic, std::bind(&renderer::instance::dispath, in.render.get(), _1));
         //scene::present(current_scene(), inst.render, interpolation);
-        scene::present(app.vi, app.current_scene(), app.render, interpolation);
+        scene::present(app.vi, sc, app.render, interpolation);
+    }
+
+    // current scene is drawn first and gives skybox, other visible scenes are drawn over it
+    // in load order, each with its own camera and lights
+    static auto present_scenes(instance_t &app) -> void {
+        std::vector<scene::scene_layer> layers;
+        layers.reserve(app.scenes.size());
+
+        auto &current = app.current_scene();
+        layers.push_back({&current, current.accumulator / timestep});
+
+        for (auto &sc : app.scenes)
+            if (&sc != &current && sc.visible)
+                layers.push_back({&sc, sc.accumulator / timestep});
+
+        scene::present(app.vi, layers, app.render);
+    }
+
+    static auto simulate(instance_t &app) -> void {
+        using namespace std;
+
+        auto &sim = *app.simulation;
+        auto &sc = app.current_scene();
+
+        vector<SDL_Event> events;
+
+        const auto freq = SDL_GetPerformanceFrequency();
+        auto last_time = SDL_GetPerformanceCounter();
+        auto accumulator = 0.f;
+
+        while (app.running) {
+            {
+                lock_guard<mutex> lock(sim.events_mutex);
+                events.swap(sim.events);
+            }
+
+            for (const auto &ev : events)
+                scene::process_event(sc, ev);
+
+            events.clear();
+
+            const auto current_time = SDL_GetPerformanceCounter();
+            const auto dt = static_cast<float>(static_cast<double>(current_time - last_time) / static_cast<double>(freq));
+            last_time = current_time;
+
+            accumulator += clamp(dt, 0.f, 0.2f);
+
+            auto stepped = false;
+            while (accumulator >= timestep) {
+                accumulator -= timestep;
+
+                scene::update(sc, timestep);
+
+                app.timesteps++;
+                stepped = true;
+
+                if (app.rewind)
+                    scene::record_tick(*app.rewind, sc, app.timesteps);
+            }
+
+            if (stepped)
+                scene::publish_render_state(sim.exchange, sc, app.timesteps, current_time, accumulator);
+            else
+                this_thread::sleep_for(chrono::microseconds(250));
+        }
     }
 
     auto quit() noexcept -> void {
@@ -160,6 +280,22 @@ namespace game {
                     ctx.scenes.push_back(get<scene::instance_t>(res));
                 }
 
+            // updated and presented together with start scene, which stays current
+            if (any_loaded && j.find("live_scenes") != j.end())
+                for (auto &name : j["live_scenes"]) {
+                    const auto live_scene = name.get<string>();
+                    if (live_scene == start_scene)
+                        continue;
+
+                    auto res = scene::load(ctx.asset_instance, ctx.vi, live_scene);
+                    if (!scene::is_ok(res)) {
+                        journal::warning(journal::_GAME, "Can't load live scene '%'", live_scene);
+                        continue;
+                    }
+
+                    ctx.scenes.push_back(get<scene::instance_t>(res));
+                }
+
             scene::setup_bindings(ctx.current_scene());
 
             if (!any_loaded)
@@ -200,6 +336,18 @@ namespace game {
 //            }
 //        }
 
+        // Rewind
+        if (j.find("rewind") != j.end()) {
+            const auto rewind_info = j["rewind"];
+            const auto capacity = rewind_info.find("capacity") != rewind_info.end() ? rewind_info["capacity"].get<size_t>() : scene::rewind_default_capacity;
+            const auto keyframe_interval = rewind_info.find("keyframe_interval") != rewind_info.end() ? rewind_info["keyframe_interval"].get<uint32_t>() : scene::rewind_default_keyframe_interval;
+
+            ctx.rewind = std::make_unique<scene::rewind_buffer>(capacity, keyframe_interval);
+        }
+
+        if (j.find("threaded_simulation") != j.end() && j["threaded_simulation"].get<bool>())
+            ctx.simulation = std::make_unique<simulation_instance>();
+
         // Locale
         setup_locale("");
 
@@ -220,7 +368,16 @@ namespace game {
         app.current_time = 0ull;
         app.last_time = 0ull;
         app.timesteps = 0ull;
-        app.delta_accumulator = 0.0f;
+
+        if (app.simulation) {
+            auto &sim = *app.simulation;
+
+            sim.view = app.current_scene();
+            scene::publish_render_state(sim.exchange, app.current_scene(), 0, SDL_GetPerformanceCounter(), 0.f);
+            sim.thread = thread(simulate, ref(app));
+
+            journal::info(journal::_GAME, "%", "Simulation thread started");
+        }
 
         while (app.running) {
             process_events(app);
@@ -231,19 +388,33 @@ namespace game {
             const auto freq = SDL_GetPerformanceFrequency();
             const auto dt = static_cast<float>(static_cast<double>(app.current_time - app.last_time) / static_cast<double>(freq));
 
-            app.delta_accumulator += clamp(dt, 0.f, 0.2f);
+            if (app.simulation) {
+                auto &sim = *app.simulation;
 
-            while (app.delta_accumulator >= timestep) {
-                app.delta_accumulator -= timestep;
+                update_frame(app, clamp(dt, 0.f, 0.2f));
 
-                update(app, timestep);
+                const auto &rs = scene::acquire_render_state(sim.exchange);
+                scene::apply_render_state(sim.view, rs);
 
-                app.timesteps++;
+                // state was published some time ago, extrapolate interpolation factor from it
+                const auto since_publish = static_cast<float>(static_cast<double>(app.current_time - rs.time) / static_cast<double>(freq));
+                present(app, sim.view, clamp((rs.accumulator + since_publish) / timestep, 0.f, 1.f));
+
+                continue;
             }
 
-            present(app, app.delta_accumulator / timestep);
+            update_frame(app, clamp(dt, 0.f, 0.2f));
+            update_scenes(app, clamp(dt, 0.f, 0.2f));
+
+            // threaded simulation owns the scene, so streaming works only here
+            scene::update_streaming(app.asset_instance, app.vi, app.current_scene());
+
+            present_scenes(app);
         }
 
+        if (app.simulation && app.simulation->thread.joinable())
+            app.simulation->thread.join();
+
         cleanup_all(app);
 
         /*if (loader.joinable())
@@ -252,4 +423,27 @@ namespace game {
         return EXIT_SUCCESS;
     }
 
+    auto rewind(instance_t &app, const uint32_t ticks, const uint32_t resimulate) -> bool {
+        // simulation thread owns the scene
+        if (!app.rewind || app.simulation)
+            return false;
+
+        auto &sc = app.current_scene();
+
+        const auto tick = scene::rewind(*app.rewind, sc, ticks);
+        if (!tick)
+            return false;
+
+        app.timesteps = tick.value();
+
+        for (uint32_t i = 0; i < resimulate; i++) {
+            scene::update(sc, timestep);
+
+            app.timesteps++;
+            scene::record_tick(*app.rewind, sc, app.timesteps);
+        }
+
+        return true;
+    }
+
 } // namespace game
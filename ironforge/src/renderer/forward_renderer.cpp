@@ -1,3 +1,8 @@
+#include <array>
+#include <cstring>
+#include <utility>
+#include <algorithm>
+
 #include <video/commands.hpp>
 #include <video/glyphs.hpp>
 #include <core/journal.hpp>
@@ -10,6 +15,40 @@ template<class... Ts> struct overloaded : Ts... { using Ts::operator()...; };
 template<class... Ts> overloaded(Ts...) -> overloaded<Ts...>;
 
 namespace renderer {
+    static auto resolve_uniforms(const video::program &p) -> program_uniforms {
+        program_uniforms u;
+        u.projection_view_matrix = video::gl::get_uniform(p, "projection_view_matrix");
+        u.model_matrix = video::gl::get_uniform(p, "model_matrix");
+        u.view_position = video::gl::get_uniform(p, "view_position");
+        u.material_index = video::gl::get_uniform(p, "material_index");
+        u.ambient_color = video::gl::get_uniform(p, "ambient_color");
+        u.ambient_intensity = video::gl::get_uniform(p, "ambient_intensity");
+        u.emission_color = video::gl::get_uniform(p, "emission_color");
+        u.light_direction = video::gl::get_uniform(p, "light_direction");
+        u.light_ld = video::gl::get_uniform(p, "light.Ld");
+        u.light_ls = video::gl::get_uniform(p, "light.Ls");
+        u.material_kd = video::gl::get_uniform(p, "material.Kd");
+        u.material_ks = video::gl::get_uniform(p, "material.Ks");
+        u.material_shininess = video::gl::get_uniform(p, "material.shininess");
+        u.material_transparency = video::gl::get_uniform(p, "material.transparency");
+        u.material_reflectivity = video::gl::get_uniform(p, "material.reflectivity");
+        u.size = video::gl::get_uniform(p, "size");
+        u.scale = video::gl::get_uniform(p, "scale");
+        u.ambient_map = video::gl::get_uniform(p, "ambient_map");
+        u.diffuse_map = video::gl::get_uniform(p, "diffuse_map");
+        u.specular_map = video::gl::get_uniform(p, "specular_map");
+        u.gloss_map = video::gl::get_uniform(p, "gloss_map");
+        u.normal_map = video::gl::get_uniform(p, "normal_map");
+        u.environment_map = video::gl::get_uniform(p, "environment_map");
+        u.emission_map = video::gl::get_uniform(p, "emission_map");
+        u.cubemap = video::gl::get_uniform(p, "cubemap");
+        u.tex0 = video::gl::get_uniform(p, "tex0");
+        u.color_map = video::gl::get_uniform(p, "color_map");
+        u.glow_map = video::gl::get_uniform(p, "glow_map");
+
+        return u;
+    }
+
     forward_renderer::forward_renderer(video::instance_t &vi, const uint32_t renderer_flags)
         : aspect_ratio{vi.aspect_ratio},
           display_width{static_cast<float>(vi.w)},
@@ -28,6 +67,14 @@ namespace renderer {
         skybox_shader = video::get_shader(vi, "skybox-shader");
         sprite_shader = video::get_shader(vi, "sprite-shader");
 
+        emission_uniforms = resolve_uniforms(emission_shader);
+        ambient_uniforms = resolve_uniforms(ambient_light_shader);
+        directional_uniforms = resolve_uniforms(directional_light_shader);
+        postprocess_uniforms = resolve_uniforms(postprocess_shader);
+        vblur_uniforms = resolve_uniforms(filter_vblur_shader);
+        hblur_uniforms = resolve_uniforms(filter_hblur_shader);
+        skybox_uniforms = resolve_uniforms(skybox_shader);
+
         video::gl::sampler_info sam_info;
 
         switch (vi.texture_filter) {
@@ -113,6 +160,11 @@ namespace renderer {
         sb_info.tex = glyphs_map;
         sprites = video::create_sprite_batch(vi, sb_info);
 
+        sprite_batch_info pb_info;
+        pb_info.max_sprites = max_particles;
+        pb_info.tex = video::get_texture(vi, "white-map");
+        particles = video::create_sprite_batch(vi, pb_info);
+
         triangles_batch_info tb_info;
         tb_info.max_triangles = 1000;
         tb_info.tex = glyphs_map;
@@ -122,15 +174,66 @@ namespace renderer {
         sources.reserve(max_sources);
         draws.reserve(max_draws);
         matrices.reserve(max_matrices);
+        draw_materials.reserve(max_draws);
         materials.reserve(max_materials);
+        raw_materials.reserve(max_materials);
+
+        // pages are bound per draw, 16KB offsets meet any uniform buffer offset alignment
+        material_capacity = material_page;
+        material_buffer = gl::create_buffer(gl::buffer_target::uniform, sizeof(raw_material) * material_capacity, nullptr, gl::buffer_usage::static_draw);
 
+        const auto ambient_block = gl::bind_uniform_block(ambient_light_shader, "material_block", material_block_binding);
+        const auto directional_block = gl::bind_uniform_block(directional_light_shader, "material_block", material_block_binding);
+        const auto emission_block = gl::bind_uniform_block(emission_shader, "material_block", material_block_binding);
+        material_blocks = ambient_block && directional_block && emission_block;
 
+        if (!material_blocks)
+            game::journal::warning(game::journal::_RENDER, "%", "Shaders without material_block, fallback to uniforms");
+
+        // instance material index is useful only with material blocks
+        const auto instanced = [] (const video::program &p) {
+            return gl::get_attribute_location(p, "instance_model") == static_cast<int32_t>(gl::instance_model_location)
+                    && gl::get_attribute_location(p, "instance_material") == static_cast<int32_t>(gl::instance_material_location);
+        };
+        instanced_draws = material_blocks && instanced(ambient_light_shader) && instanced(directional_light_shader) && instanced(emission_shader);
+
+        // per frame data from ring, draw_block carries material index, so material blocks are required
+        const auto bind_blocks = [] (const video::program &p, const bool lights) {
+            return gl::bind_uniform_block(p, "frame_block", frame_block_binding) && gl::bind_uniform_block(p, "draw_block", draw_block_binding)
+                    && (!lights || gl::bind_uniform_block(p, "light_block", light_block_binding));
+        };
+        uniform_blocks = material_blocks && bind_blocks(ambient_light_shader, true) && bind_blocks(directional_light_shader, true) && bind_blocks(emission_shader, false);
+
+        if (uniform_blocks)
+            uniforms = gl::create_uniform_ring(initial_uniform_ring);
+        else
+            game::journal::warning(game::journal::_RENDER, "%", "Shaders without frame_block, fallback to uniforms");
+
+        if (instanced_draws) {
+            instance_capacity = initial_instances;
+            instance_buffer = gl::create_buffer(gl::buffer_target::array, sizeof(gl::instance_attributes) * instance_capacity, nullptr, gl::buffer_usage::stream_draw);
+        } else
+            game::journal::warning(game::journal::_RENDER, "%", "Shaders without instance attributes, one draw per mesh");
+
+        // index 0 is used when registry is full
+        phong::material default_material = {};
+        default_material.kd = glm::vec3{1.f};
+        default_material.diffuse_tex = video::get_texture(vi, "white-map");
+        default_material.normal_tex = default_material.diffuse_tex;
+        register_material(default_material);
 
         reset();
     }
 
     forward_renderer::~forward_renderer() {
         video::delete_sprite_batch(sprites);
+        video::delete_sprite_batch(particles);
+
+        video::gl::destroy_buffer(material_buffer);
+        if (instanced_draws)
+            video::gl::destroy_buffer(instance_buffer);
+        if (uniform_blocks)
+            video::gl::destroy_uniform_ring(uniforms);
 
         video::gl::destroy_framebuffer(color_framebuffer);
         video::gl::destroy_texture(color_map);
@@ -157,15 +260,47 @@ namespace renderer {
         point_lights.push_back(light);
     }
 
-    auto forward_renderer::append(const phong::material &material) -> void {
-        // TODO: make row vector
-        materials.push_back(material);
-    }
-
-    auto forward_renderer::append(const video::vertices_source &source, const video::vertices_draw &draw, const glm::mat4 &model) -> void {
+    auto forward_renderer::append(const video::vertices_source &source, const video::vertices_draw &draw, const glm::mat4 &model, const uint32_t material) -> void {
         sources.push_back(source);
         draws.push_back(draw);
         matrices.push_back(model);
+        draw_materials.push_back(material < materials.size() ? material : 0);
+    }
+
+    static auto pack_material(const phong::material &material) -> raw_material {
+        raw_material raw;
+        raw.values[0] = glm::vec4{material.ka, 1.f}; // opaque, same as uniform path
+        raw.values[1] = glm::vec4{material.kd, material.reflectivity};
+        raw.values[2] = glm::vec4{material.ks, material.ns};
+        raw.values[3] = glm::vec4{material.ke, 0.f};
+
+        return raw;
+    }
+
+    auto forward_renderer::register_material(const phong::material &material) -> uint32_t {
+        if (materials.size() >= max_materials) {
+            if (!materials_full)
+                game::journal::warning(game::journal::_RENDER, "Materials limit % reached, default material is used", max_materials);
+
+            materials_full = true;
+            return 0;
+        }
+
+        materials.push_back(material);
+        raw_materials.push_back(pack_material(material));
+
+        return static_cast<uint32_t>(materials.size() - 1);
+    }
+
+    auto forward_renderer::update_material(const uint32_t index, const phong::material &material) -> void {
+        if (index == 0 || index >= materials.size())
+            return;
+
+        materials[index] = material;
+        raw_materials[index] = pack_material(material);
+
+        // uploaded again from first changed material on present
+        uploaded_materials = std::min(uploaded_materials, static_cast<size_t>(index));
     }
 
     auto forward_renderer::append(const video::texture &tex, const uint32_t flags) -> void {
@@ -174,6 +309,20 @@ namespace renderer {
         }
     }
 
+    auto forward_renderer::begin_layer(const glm::mat4 &proj, const glm::mat4 &view) -> void {
+        // one layer is kept for items appended before first begin_layer
+        if (layers.size() + 1 >= max_layers) {
+            if (!layers_full)
+                game::journal::warning(game::journal::_RENDER, "Layers limit % reached, next layers are merged into last one", max_layers);
+
+            layers_full = true;
+            return;
+        }
+
+        layers.push_back({proj, view, static_cast<uint32_t>(draws.size()), static_cast<uint32_t>(ambient_lights.size()),
+                          static_cast<uint32_t>(directional_lights.size()), particles.sprites_count});
+    }
+
     auto forward_renderer::dispath(video::instance_t &vi, const ui::draw_command_t &c) -> void {
 
         std::visit(overloaded {
@@ -192,11 +341,178 @@ namespace renderer {
                    }, c);
     }
 
+    auto forward_renderer::append_particles(const uint32_t count) -> video::v3t2c4* {
+        return video::map_sprites(particles, count);
+    }
+
+    static auto make_sort_key(const uint32_t layer, const render_pass pass, const uint32_t program, const uint32_t material, const uint32_t vertex_array, const float depth) -> uint64_t {
+        // bits of non negative float grow with value, top 24 are enough for ordering
+        uint32_t depth_bits = 0;
+        const auto d = std::max(depth, 0.f);
+        std::memcpy(&depth_bits, &d, sizeof d);
+
+        return (static_cast<uint64_t>(layer) & 0xf) << 60
+                | (static_cast<uint64_t>(pass) & 0xf) << 56
+                | (static_cast<uint64_t>(program) & 0xf) << 52
+                | (static_cast<uint64_t>(material) & 0xfff) << 40
+                | (static_cast<uint64_t>(vertex_array) & 0xffff) << 24
+                | static_cast<uint64_t>(depth_bits >> 7);
+    }
+
+    // LSD radix sort by 8 bit digits, digits same for all keys are skipped
+    static auto sort_draw_queue(std::vector<queued_draw> &queue, std::vector<queued_draw> &scratch) -> void {
+        constexpr uint32_t digits = sizeof(uint64_t);
+
+        if (queue.size() < 2)
+            return;
+
+        std::array<std::array<uint32_t, 256>, digits> counts = {};
+        for (const auto &q : queue)
+            for (uint32_t d = 0; d < digits; d++)
+                counts[d][(q.key >> (d * 8)) & 0xff]++;
+
+        scratch.resize(queue.size());
+
+        for (uint32_t d = 0; d < digits; d++) {
+            auto &c = counts[d];
+            if (c[(queue.front().key >> (d * 8)) & 0xff] == queue.size())
+                continue;
+
+            uint32_t offset = 0;
+            for (auto &n : c)
+                offset += std::exchange(n, offset);
+
+            for (const auto &q : queue)
+                scratch[c[(q.key >> (d * 8)) & 0xff]++] = q;
+
+            queue.swap(scratch);
+        }
+    }
+
+    static auto same_range(const video::vertices_draw &a, const video::vertices_draw &b) -> bool {
+        return a.mode == b.mode && a.count == b.count && a.ib_offset == b.ib_offset && a.vb_offset == b.vb_offset
+                && a.base_vertex == b.base_vertex && a.base_index == b.base_index;
+    }
+
+    // index inside bound material_block page
+    static auto material_slot(const uint32_t material) -> int32_t {
+        return static_cast<int32_t>(material % material_page);
+    }
+
+    // binds page of material when it differs from bound one
+    static auto bind_material_page(video::gl::command_buffer &commands, const video::gl::buffer &material_buffer, uint32_t &bound_page, const uint32_t material) -> void {
+        const auto page = static_cast<uint32_t>(material / material_page);
+        if (page == bound_page)
+            return;
+
+        constexpr auto page_size = sizeof(raw_material) * material_page;
+        commands << vcs::bind_buffer_range{material_buffer, material_block_binding, page * page_size, page_size};
+        bound_page = page;
+    }
+
+    // sorted queue keeps material and vertex array together, runs are split by draw range
+    auto forward_renderer::build_batches() -> void {
+        constexpr uint64_t state_mask = ~uint64_t{0xffffff}; // all but depth
+
+        batches.clear();
+        instances.clear();
+
+        if (!instanced_draws) {
+            for (const auto &q : draw_queue)
+                batches.push_back({q.index, 0, 1});
+
+            return;
+        }
+
+        for (size_t first = 0; first < draw_queue.size();) {
+            auto last = first + 1;
+            while (last < draw_queue.size() && (draw_queue[last].key & state_mask) == (draw_queue[first].key & state_mask))
+                last++;
+
+            const auto run_batches = batches.size();
+
+            for (auto i = first; i < last; i++) {
+                const auto d = draw_queue[i].index;
+
+                // material bits of key may alias, so batch keeps exactly one material
+                const auto known = std::any_of(batches.begin() + static_cast<ptrdiff_t>(run_batches), batches.end(), [this, d] (const draw_batch &b) {
+                    return draw_materials[b.draw] == draw_materials[d] && same_range(draws[b.draw], draws[d]);
+                });
+                if (known)
+                    continue;
+
+                // instances stay in depth order
+                draw_batch b = {d, static_cast<uint32_t>(instances.size()), 0};
+                for (auto j = i; j < last; j++) {
+                    const auto e = draw_queue[j].index;
+                    if (draw_materials[e] != draw_materials[d] || !same_range(draws[e], draws[d]))
+                        continue;
+
+                    instances.push_back({matrices[e], material_slot(draw_materials[e]), {}});
+                    b.instances++;
+                }
+
+                batches.push_back(b);
+            }
+
+            first = last;
+        }
+
+        if (instances.size() > instance_capacity) {
+            video::gl::destroy_buffer(instance_buffer);
+
+            instance_capacity = std::max(instances.size(), instance_capacity * 2);
+            instance_buffer = video::gl::create_buffer(video::gl::buffer_target::array, sizeof(video::gl::instance_attributes) * instance_capacity, nullptr, video::gl::buffer_usage::stream_draw);
+        }
+
+        if (!instances.empty())
+            video::gl::update_buffer(instance_buffer, 0, instances.data(), sizeof(video::gl::instance_attributes) * instances.size());
+    }
+
+    // end of layer items is start of next layer or total count
+    static auto layer_end(const std::vector<render_layer> &layers, const size_t l, uint32_t render_layer::*first, const size_t total) -> uint32_t {
+        return l + 1 < layers.size() ? layers[l + 1].*first : static_cast<uint32_t>(total);
+    }
+
+    static auto reset_layer_commands(layer_commands &lc) -> void {
+        lc.ambient.clear_color = glm::vec4(0.0f, 0.0f, 0.0f, 0.f);
+        lc.ambient.memory_offset = 0;
+        lc.ambient.commands.clear();
+        lc.ambient.depth.depth_test = true;
+        lc.ambient.depth.depth_write = true;
+        lc.ambient.depth.depth_func = video::gl::depth_fn::less;
+        //lc.ambient.rasterizer.cull_face = true;
+        lc.ambient.rasterizer.cull_mode = video::gl::cull_face_mode::back;
+
+        lc.directional.clear_color = glm::vec4(0.0f, 0.0f, 0.0f, 0.f);
+        lc.directional.memory_offset = 0;
+        lc.directional.commands.clear();
+        lc.directional.blend.enable = true;
+        lc.directional.blend.dfactor = video::gl::blend_factor::one;
+        lc.directional.blend.sfactor = video::gl::blend_factor::one;
+        lc.directional.depth.depth_test = true;
+        lc.directional.depth.depth_write = false;
+        lc.directional.depth.depth_func = video::gl::depth_fn::equal;
+        //lc.directional.rasterizer.cull_face = true;
+        lc.directional.rasterizer.cull_mode = video::gl::cull_face_mode::back;
+
+        // drawn into lit scene, tested but not written against its depth
+        lc.particles.memory_offset = 0;
+        lc.particles.commands.clear();
+        lc.particles.blend.enable = true;
+        lc.particles.blend.sfactor = video::gl::blend_factor::src_alpha;
+        lc.particles.blend.dfactor = video::gl::blend_factor::one_minus_src_alpha;
+        lc.particles.depth.depth_test = true;
+        lc.particles.depth.depth_write = false;
+        lc.particles.depth.depth_func = video::gl::depth_fn::less;
+    }
+
     auto forward_renderer::reset() -> void {
         sources.clear();
-        materials.clear();
         matrices.clear();
         draws.clear();
+        draw_materials.clear();
+        draw_queue.clear();
 
         ambient_lights.clear();
         directional_lights.clear();
@@ -209,26 +525,9 @@ namespace renderer {
         prepare_commands.depth.depth_test = false;
         prepare_commands.depth.depth_write = true;
 
-        ambient_commands.clear_color = glm::vec4(0.0f, 0.0f, 0.0f, 0.f);
-        ambient_commands.memory_offset = 0;
-        ambient_commands.commands.clear();
-        ambient_commands.depth.depth_test = true;
-        ambient_commands.depth.depth_write = true;
-        ambient_commands.depth.depth_func = video::gl::depth_fn::less;
-        //ambient_commands.rasterizer.cull_face = true;
-        ambient_commands.rasterizer.cull_mode = video::gl::cull_face_mode::back;
-
-        directional_commands.clear_color = glm::vec4(0.0f, 0.0f, 0.0f, 0.f);
-        directional_commands.memory_offset = 0;
-        directional_commands.commands.clear();
-        directional_commands.blend.enable = true;
-        directional_commands.blend.dfactor = video::gl::blend_factor::one;
-        directional_commands.blend.sfactor = video::gl::blend_factor::one;
-        directional_commands.depth.depth_test = true;
-        directional_commands.depth.depth_write = false;
-        directional_commands.depth.depth_func = video::gl::depth_fn::equal;
-        //directional_commands.rasterizer.cull_face = true;
-        directional_commands.rasterizer.cull_mode = video::gl::cull_face_mode::back;
+        layers.clear();
+        for (auto &lc : layer_passes)
+            reset_layer_commands(*lc);
 
         glow_commands.clear_color = glm::vec4(0.0f, 0.0f, 0.0f, 0.f);
         glow_commands.memory_offset = 0;
@@ -277,94 +576,270 @@ namespace renderer {
         cam_model = glm::scale(cam_model, glm::vec3(5.f));
         glm::mat4 projection_view = proj * view;
 
-        prepare_commands << vcs::bind_framebuffer{sample_framebuffer};
-        prepare_commands << vcs::viewport{sample_framebuffer};
-        prepare_commands << vcs::clear{};
+        // buffer grows by whole pages and is uploaded again, otherwise only materials registered since last frame
+        if (raw_materials.size() > material_capacity) {
+            video::gl::destroy_buffer(material_buffer);
 
-        skybox_commands << vcs::bind_program{skybox_shader};
-        skybox_commands << vcs::bind_uniform{skybox_shader, "projection_view_matrix", projection_view};
-        skybox_commands << vcs::bind_uniform{skybox_shader, "model_matrix", cam_model};
+            material_capacity = std::max(material_capacity * 2, (raw_materials.size() + material_page - 1) / material_page * material_page);
+            material_buffer = video::gl::create_buffer(video::gl::buffer_target::uniform, sizeof(raw_material) * material_capacity, nullptr, video::gl::buffer_usage::static_draw);
+            uploaded_materials = 0;
+        }
 
-        skybox_commands << vcs::bind_texture{skybox_shader, "cubemap", 0, skybox_map};
-        skybox_commands << vcs::bind_sampler{0, texture_sampler};
+        if (uploaded_materials < raw_materials.size()) {
+            video::gl::update_buffer(material_buffer, sizeof(raw_material) * uploaded_materials, &raw_materials[uploaded_materials],
+                    sizeof(raw_material) * (raw_materials.size() - uploaded_materials));
+            uploaded_materials = raw_materials.size();
+        }
 
-        skybox_commands << vcs::bind_vertex_array{skybox_cube.array};
-        skybox_commands << vcs::draw_elements{skybox_draw};
+        // items appended before first begin_layer are seen by present camera
+        const auto leading_items = layers.empty() || layers.front().first_draw > 0 || layers.front().first_ambient > 0
+                || layers.front().first_directional > 0 || layers.front().first_particle > 0;
+        if (leading_items)
+            layers.insert(layers.begin(), render_layer{proj, view, 0, 0, 0, 0});
+
+        // all geometry is opaque and every scene pass has one program, so one order serves all of them,
+        // layers in order, front to back inside material and vertex array
+        for (uint32_t l = 0; l < layers.size(); l++) {
+            const auto &ly = layers[l];
+
+            for (auto i = ly.first_draw; i < layer_end(layers, l, &render_layer::first_draw, draws.size()); i++) {
+                const auto depth = -(ly.view * matrices[i][3]).z;
+                draw_queue.push_back({make_sort_key(l, render_pass::opaque, 0, draw_materials[i], sources[i].array.id, depth), i});
+            }
+        }
+
+        sort_draw_queue(draw_queue, sort_scratch);
+        build_batches();
+
+        // layer is top of key, so batches follow layer order and none crosses layers
+        for (size_t l = 0, b = 0; l < layers.size(); l++) {
+            const auto end = layer_end(layers, l, &render_layer::first_draw, draws.size());
 
-        ambient_commands << vcs::bind_program{ambient_light_shader};
-        ambient_commands << vcs::bind_uniform{ambient_light_shader, "projection_view_matrix", projection_view};
+            layers[l].first_batch = b;
+            while (b < batches.size() && batches[b].draw < end)
+                b++;
+        }
+
+        const auto last_batch = [this] (const size_t l) {
+            return l + 1 < layers.size() ? layers[l + 1].first_batch : batches.size();
+        };
 
-        for (const auto &lt : ambient_lights) {
-            ambient_commands << vcs::bind_uniform{ambient_light_shader, "ambient_intensity", lt.la};
+        // frame, light and draw blocks are written once and shared by all passes
+        if (uniform_blocks) {
+            using namespace video::gl;
 
-            for (size_t i = 0; i < draws.size(); i++) {
-                ambient_commands << vcs::bind_uniform{ambient_light_shader, "model_matrix", matrices[i]};
-                ambient_commands << vcs::bind_uniform{ambient_light_shader, "ambient_color", materials[i].ka};
+            const auto objects = instanced_draws ? 0 : batches.size();
+            const auto lights = ambient_lights.size() + directional_lights.size();
+            begin_uniform_frame(uniforms, layers.size() * aligned_uniform_size(uniforms, sizeof(raw_frame)) + lights * aligned_uniform_size(uniforms, sizeof(raw_light))
+                                + objects * aligned_uniform_size(uniforms, sizeof(raw_object)));
 
-                ambient_commands << vcs::bind_texture{ambient_light_shader, "ambient_map", 0, materials[i].diffuse_tex};
-                ambient_commands << vcs::bind_sampler{0, texture_sampler};
+            for (auto &ly : layers)
+                ly.frame_block = push_uniforms(uniforms, raw_frame{ly.projection * ly.view, glm::vec4{-glm::vec3(ly.view[3]), 1.f}});
 
-                ambient_commands << vcs::bind_vertex_array{sources[i].array};
-                ambient_commands << vcs::draw_elements{draws[i]};
-            }
+            light_blocks.clear();
+            for (const auto &lt : ambient_lights)
+                light_blocks.push_back(push_uniforms(uniforms, raw_light{glm::vec4{0.f}, glm::vec4{lt.la, 0.f}, glm::vec4{0.f}, glm::vec4{0.f}}));
+
+            for (const auto &lt : directional_lights)
+                light_blocks.push_back(push_uniforms(uniforms, raw_light{glm::vec4{lt.direction, 0.f}, glm::vec4{0.f}, glm::vec4{lt.ld, 0.f}, glm::vec4{lt.ls, 0.f}}));
+
+            if (!instanced_draws)
+                for (auto &b : batches)
+                    b.uniforms = push_uniforms(uniforms, raw_object{matrices[b.draw], glm::ivec4{material_slot(draw_materials[b.draw]), 0, 0, 0}});
+
+            upload_uniform_frame(uniforms);
         }
 
-        directional_commands << vcs::bind_program{directional_light_shader};
-        directional_commands << vcs::bind_uniform{directional_light_shader, "projection_view_matrix", projection_view};
+        prepare_commands << vcs::bind_framebuffer{sample_framebuffer};
+        prepare_commands << vcs::viewport{sample_framebuffer};
+        prepare_commands << vcs::clear{};
 
-        directional_commands << vcs::bind_uniform{directional_light_shader, "view_position", -glm::vec3(view[3])};
+        skybox_commands << vcs::bind_program{skybox_shader};
+        skybox_commands << vcs::bind_uniform{skybox_uniforms.projection_view_matrix, projection_view};
+        skybox_commands << vcs::bind_uniform{skybox_uniforms.model_matrix, cam_model};
 
+        skybox_commands << vcs::bind_texture{skybox_uniforms.cubemap, 0, skybox_map};
+        skybox_commands << vcs::bind_sampler{0, texture_sampler};
 
-        for (const auto &lt : directional_lights) {
-            directional_commands << vcs::bind_uniform{directional_light_shader, "light_direction", lt.direction};
-            directional_commands << vcs::bind_uniform{directional_light_shader, "light.Ld", lt.ld};
-            directional_commands << vcs::bind_uniform{directional_light_shader, "light.Ls", lt.ls};
+        skybox_commands << vcs::bind_vertex_array{skybox_cube.array};
+        skybox_commands << vcs::draw_elements{skybox_draw};
 
-            for (size_t i = 0; i < draws.size(); i++) {
+        while (layer_passes.size() < layers.size()) {
+            layer_passes.push_back(std::make_unique<layer_commands>());
+            reset_layer_commands(*layer_passes.back());
+        }
 
-                directional_commands << vcs::bind_uniform{directional_light_shader, "model_matrix", matrices[i]};
-                directional_commands << vcs::bind_uniform{directional_light_shader, "material.Kd", materials[i].kd};
-                directional_commands << vcs::bind_uniform{directional_light_shader, "material.Ks", materials[i].ks};
-                directional_commands << vcs::bind_uniform{directional_light_shader, "material.shininess", materials[i].ns};
-                directional_commands << vcs::bind_uniform{directional_light_shader, "material.transparency", 1.f};
-                directional_commands << vcs::bind_uniform{directional_light_shader, "material.reflectivity", materials[i].reflectivity};
+        // particles of all layers are uploaded once, before first layer draws its range
+        video::update_sprite_batch(layer_passes.front()->particles, particles);
 
-                directional_commands << vcs::bind_texture{directional_light_shader, "diffuse_map", 0, materials[i].diffuse_tex};
-                directional_commands << vcs::bind_sampler{0, texture_sampler};
+        for (size_t l = 0; l < layers.size(); l++) {
+            const auto &ly = layers[l];
+            auto &lc = *layer_passes[l];
 
-                directional_commands << vcs::bind_texture{directional_light_shader, "specular_map", 1, /*materials[i].specular_tex*/white_tex};
-                directional_commands << vcs::bind_sampler{1, texture_sampler};
+            const auto layer_projection_view = ly.projection * ly.view;
+            const auto first_batch = ly.first_batch;
+            const auto end_batch = last_batch(l);
 
-                directional_commands << vcs::bind_texture{directional_light_shader, "gloss_map", 2, /*materials[i].gloss_tex*/white_tex};
-                directional_commands << vcs::bind_sampler{2, texture_sampler};
+            // sample framebuffer stays bound, layer keeps color of previous ones and drops their depth
+            if (l > 0)
+                lc.ambient << vcs::clear_depth{};
 
-                directional_commands << vcs::bind_texture{directional_light_shader, "normal_map", 3, materials[i].normal_tex};
-                directional_commands << vcs::bind_sampler{3, texture_sampler};
+            lc.ambient << vcs::bind_program{ambient_light_shader};
+            if (uniform_blocks)
+                lc.ambient << vcs::bind_buffer_range{uniforms.buf, frame_block_binding, ly.frame_block, sizeof(raw_frame)};
+            else
+                lc.ambient << vcs::bind_uniform{ambient_uniforms.projection_view_matrix, layer_projection_view};
+
+            uint32_t material_page_bound = UINT32_MAX;
+            for (auto a = ly.first_ambient; a < layer_end(layers, l, &render_layer::first_ambient, ambient_lights.size()); a++) {
+                if (uniform_blocks)
+                    lc.ambient << vcs::bind_buffer_range{uniforms.buf, light_block_binding, light_blocks[a], sizeof(raw_light)};
+                else
+                    lc.ambient << vcs::bind_uniform{ambient_uniforms.ambient_intensity, ambient_lights[a].la};
+
+                for (auto bi = first_batch; bi < end_batch; bi++) {
+                    const auto &b = batches[bi];
+                    const auto i = b.draw;
+                    const auto m = draw_materials[i];
+
+                    if (material_blocks)
+                        bind_material_page(lc.ambient, material_buffer, material_page_bound, m);
+
+                    if (uniform_blocks && !instanced_draws)
+                        lc.ambient << vcs::bind_buffer_range{uniforms.buf, draw_block_binding, b.uniforms, sizeof(raw_object)};
+                    else if (!instanced_draws) {
+                        lc.ambient << vcs::bind_uniform{ambient_uniforms.model_matrix, matrices[i]};
+                        if (material_blocks)
+                            lc.ambient << vcs::bind_uniform{ambient_uniforms.material_index, material_slot(m)};
+                        else
+                            lc.ambient << vcs::bind_uniform{ambient_uniforms.ambient_color, materials[m].ka};
+                    }
+
+                    lc.ambient << vcs::bind_texture{ambient_uniforms.ambient_map, 0, materials[m].diffuse_tex};
+                    lc.ambient << vcs::bind_sampler{0, texture_sampler};
+
+                    lc.ambient << vcs::bind_vertex_array{sources[i].array};
+                    if (instanced_draws)
+                        lc.ambient << vcs::bind_instances{instance_buffer, sizeof(video::gl::instance_attributes) * b.first_instance};
+                    lc.ambient << vcs::draw_elements{draws[i], b.instances};
+                }
+            }
 
-                directional_commands << vcs::bind_texture{directional_light_shader, "environment_map", 4, /*skybox_map*/white_tex};
-                directional_commands << vcs::bind_sampler{4, filter_sampler};
+            lc.directional << vcs::bind_program{directional_light_shader};
+            if (uniform_blocks)
+                lc.directional << vcs::bind_buffer_range{uniforms.buf, frame_block_binding, ly.frame_block, sizeof(raw_frame)};
+            else {
+                lc.directional << vcs::bind_uniform{directional_uniforms.projection_view_matrix, layer_projection_view};
+                lc.directional << vcs::bind_uniform{directional_uniforms.view_position, -glm::vec3(ly.view[3])};
+            }
 
-                directional_commands << vcs::bind_vertex_array{sources[i].array};
-                directional_commands << vcs::draw_elements{draws[i]};
+            material_page_bound = UINT32_MAX;
+            for (auto d = ly.first_directional; d < layer_end(layers, l, &render_layer::first_directional, directional_lights.size()); d++) {
+                const auto &lt = directional_lights[d];
+
+                if (uniform_blocks)
+                    lc.directional << vcs::bind_buffer_range{uniforms.buf, light_block_binding, light_blocks[ambient_lights.size() + d], sizeof(raw_light)};
+                else {
+                    lc.directional << vcs::bind_uniform{directional_uniforms.light_direction, lt.direction};
+                    lc.directional << vcs::bind_uniform{directional_uniforms.light_ld, lt.ld};
+                    lc.directional << vcs::bind_uniform{directional_uniforms.light_ls, lt.ls};
+                }
+
+                for (auto bi = first_batch; bi < end_batch; bi++) {
+                    const auto &b = batches[bi];
+                    const auto i = b.draw;
+                    const auto m = draw_materials[i];
+
+                    if (material_blocks)
+                        bind_material_page(lc.directional, material_buffer, material_page_bound, m);
+
+                    if (uniform_blocks && !instanced_draws)
+                        lc.directional << vcs::bind_buffer_range{uniforms.buf, draw_block_binding, b.uniforms, sizeof(raw_object)};
+                    else if (!instanced_draws) {
+                        lc.directional << vcs::bind_uniform{directional_uniforms.model_matrix, matrices[i]};
+                        if (material_blocks)
+                            lc.directional << vcs::bind_uniform{directional_uniforms.material_index, material_slot(m)};
+                        else {
+                            lc.directional << vcs::bind_uniform{directional_uniforms.material_kd, materials[m].kd};
+                            lc.directional << vcs::bind_uniform{directional_uniforms.material_ks, materials[m].ks};
+                            lc.directional << vcs::bind_uniform{directional_uniforms.material_shininess, materials[m].ns};
+                            lc.directional << vcs::bind_uniform{directional_uniforms.material_transparency, 1.f};
+                            lc.directional << vcs::bind_uniform{directional_uniforms.material_reflectivity, materials[m].reflectivity};
+                        }
+                    }
+
+                    lc.directional << vcs::bind_texture{directional_uniforms.diffuse_map, 0, materials[m].diffuse_tex};
+                    lc.directional << vcs::bind_sampler{0, texture_sampler};
+
+                    lc.directional << vcs::bind_texture{directional_uniforms.specular_map, 1, /*materials[i].specular_tex*/white_tex};
+                    lc.directional << vcs::bind_sampler{1, texture_sampler};
+
+                    lc.directional << vcs::bind_texture{directional_uniforms.gloss_map, 2, /*materials[i].gloss_tex*/white_tex};
+                    lc.directional << vcs::bind_sampler{2, texture_sampler};
+
+                    lc.directional << vcs::bind_texture{directional_uniforms.normal_map, 3, materials[m].normal_tex};
+                    lc.directional << vcs::bind_sampler{3, texture_sampler};
+
+                    lc.directional << vcs::bind_texture{directional_uniforms.environment_map, 4, /*skybox_map*/white_tex};
+                    lc.directional << vcs::bind_sampler{4, filter_sampler};
+
+                    lc.directional << vcs::bind_vertex_array{sources[i].array};
+                    if (instanced_draws)
+                        lc.directional << vcs::bind_instances{instance_buffer, sizeof(video::gl::instance_attributes) * b.first_instance};
+                    lc.directional << vcs::draw_elements{draws[i], b.instances};
+                }
             }
+
+            // sample framebuffer is still bound after directional pass
+            const auto end_particle = layer_end(layers, l, &render_layer::first_particle, particles.sprites_count);
+            video::submit_sprite_range(lc.particles, particles, sprite_shader, texture_sampler, ly.first_particle, end_particle - ly.first_particle);
         }
 
+        video::clear_sprite_batch(particles);
+
         glow_commands << vcs::bind_framebuffer{glow_framebuffer};
         glow_commands << vcs::viewport{glow_framebuffer};
         glow_commands << vcs::clear{};
 
         glow_commands << vcs::bind_program{emission_shader};
-        glow_commands << vcs::bind_uniform{emission_shader, "projection_view_matrix", projection_view};
 
-        for (size_t i = 0; i < draws.size(); i++) {
-            glow_commands << vcs::bind_uniform{emission_shader, "model_matrix", matrices[i]};
-            glow_commands << vcs::bind_uniform{emission_shader, "emission_color", materials[i].ke};
+        uint32_t material_page_bound = UINT32_MAX;
+        for (size_t l = 0; l < layers.size(); l++) {
+            const auto &ly = layers[l];
 
-            glow_commands << vcs::bind_texture{emission_shader, "emission_map", 0, white_tex};
-            glow_commands << vcs::bind_sampler{1, texture_sampler};
+            if (l > 0)
+                glow_commands << vcs::clear_depth{};
 
-            glow_commands << vcs::bind_vertex_array{sources[i].array};
-            glow_commands << vcs::draw_elements{draws[i]};
+            if (uniform_blocks)
+                glow_commands << vcs::bind_buffer_range{uniforms.buf, frame_block_binding, ly.frame_block, sizeof(raw_frame)};
+            else
+                glow_commands << vcs::bind_uniform{emission_uniforms.projection_view_matrix, ly.projection * ly.view};
+
+            for (auto bi = ly.first_batch; bi < last_batch(l); bi++) {
+                const auto &b = batches[bi];
+                const auto i = b.draw;
+
+                if (material_blocks)
+                    bind_material_page(glow_commands, material_buffer, material_page_bound, draw_materials[i]);
+
+                if (uniform_blocks && !instanced_draws)
+                    glow_commands << vcs::bind_buffer_range{uniforms.buf, draw_block_binding, b.uniforms, sizeof(raw_object)};
+                else if (!instanced_draws) {
+                    glow_commands << vcs::bind_uniform{emission_uniforms.model_matrix, matrices[i]};
+                    if (material_blocks)
+                        glow_commands << vcs::bind_uniform{emission_uniforms.material_index, material_slot(draw_materials[i])};
+                    else
+                        glow_commands << vcs::bind_uniform{emission_uniforms.emission_color, materials[draw_materials[i]].ke};
+                }
+
+                glow_commands << vcs::bind_texture{emission_uniforms.emission_map, 0, white_tex};
+                glow_commands << vcs::bind_sampler{1, texture_sampler};
+
+                glow_commands << vcs::bind_vertex_array{sources[i].array};
+                if (instanced_draws)
+                    glow_commands << vcs::bind_instances{instance_buffer, sizeof(video::gl::instance_attributes) * b.first_instance};
+                glow_commands << vcs::draw_elements{draws[i], b.instances};
+            }
         }
 
         // vblur
@@ -375,10 +850,10 @@ namespace renderer {
         post_commands << vcs::bind_program{filter_vblur_shader};
 
         const glm::vec2 size = glm::vec2(1.f / blur_framebuffer.width, 1.f / blur_framebuffer.height);
-        post_commands << vcs::bind_uniform{filter_vblur_shader, "size", size};
-        post_commands << vcs::bind_uniform{filter_vblur_shader, "scale", 2.0f};
+        post_commands << vcs::bind_uniform{vblur_uniforms.size, size};
+        post_commands << vcs::bind_uniform{vblur_uniforms.scale, 2.0f};
 
-        post_commands << vcs::bind_texture{filter_vblur_shader, "tex0", 0, glow_map};
+        post_commands << vcs::bind_texture{vblur_uniforms.tex0, 0, glow_map};
         post_commands << vcs::bind_sampler{0, filter_sampler};
 
         post_commands << vcs::bind_vertex_array{fullscreen_quad.array};
@@ -391,10 +866,10 @@ namespace renderer {
 
         post_commands << vcs::bind_program{filter_hblur_shader};
 
-        post_commands << vcs::bind_uniform{filter_hblur_shader, "size", size};
-        post_commands << vcs::bind_uniform{filter_hblur_shader, "scale", 2.0f};
+        post_commands << vcs::bind_uniform{hblur_uniforms.size, size};
+        post_commands << vcs::bind_uniform{hblur_uniforms.scale, 2.0f};
 
-        post_commands << vcs::bind_texture{filter_hblur_shader, "tex0", 0, blur_map};
+        post_commands << vcs::bind_texture{hblur_uniforms.tex0, 0, blur_map};
         post_commands << vcs::bind_sampler{0, filter_sampler};
 
         post_commands << vcs::bind_vertex_array{fullscreen_quad.array};
@@ -410,10 +885,10 @@ namespace renderer {
 
         post_commands << vcs::bind_program{postprocess_shader};
 
-        post_commands << vcs::bind_texture{postprocess_shader, "color_map", 0, color_map};
+        post_commands << vcs::bind_texture{postprocess_uniforms.color_map, 0, color_map};
         post_commands << vcs::bind_sampler{0, filter_sampler};
 
-        post_commands << vcs::bind_texture{postprocess_shader, "glow_map", 1, glow_map};
+        post_commands << vcs::bind_texture{postprocess_uniforms.glow_map, 1, glow_map};
         post_commands << vcs::bind_sampler{1, filter_sampler};
 
         post_commands << vcs::bind_vertex_array{fullscreen_quad.array};
@@ -422,7 +897,20 @@ namespace renderer {
         video::submit_triangles_batch(post_commands, triangles, sprite_shader, texture_sampler);
         video::submit_sprite_batch(post_commands, sprites, sprite_shader, texture_sampler);
 
-        video::present(vi, {&prepare_commands, &skybox_commands, &ambient_commands, &directional_commands, &glow_commands, &post_commands});
+        submitted_passes.clear();
+        submitted_passes.push_back(&prepare_commands);
+        submitted_passes.push_back(&skybox_commands);
+
+        for (size_t l = 0; l < layers.size(); l++) {
+            submitted_passes.push_back(&layer_passes[l]->ambient);
+            submitted_passes.push_back(&layer_passes[l]->directional);
+            submitted_passes.push_back(&layer_passes[l]->particles);
+        }
+
+        submitted_passes.push_back(&glow_commands);
+        submitted_passes.push_back(&post_commands);
+
+        video::present(vi, submitted_passes);
         reset();
     }
 
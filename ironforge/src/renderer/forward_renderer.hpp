@@ -1,6 +1,7 @@
 #pragma once
 
 #include <vector>
+#include <memory>
 
 #include <core/json.hpp>
 #include <video/video.hpp>
@@ -14,15 +15,120 @@ namespace renderer {
     constexpr size_t max_ambient_lights     = 1;
     constexpr size_t max_directional_lights = 1;
     constexpr size_t max_point_lights       = 20;
-    constexpr size_t max_materials          = 20;
+    constexpr size_t max_materials          = 4096; // sort key material bits
+    constexpr size_t material_page          = 256; // 16KB std140 block, minimal guaranteed size
     constexpr size_t max_draws              = 20;
     constexpr size_t max_matrices           = 20;
     constexpr size_t max_sources            = 20;
+    constexpr uint32_t max_particles        = 131072;
+    constexpr size_t max_layers             = 16; // sort key layer bits
 
+    constexpr uint32_t material_block_binding = 0;
+    constexpr uint32_t frame_block_binding    = 1;
+    constexpr uint32_t light_block_binding    = 2;
+    constexpr uint32_t draw_block_binding     = 3;
+    constexpr size_t initial_uniform_ring     = 64 * 1024; // bytes per frame
+
+    // std140 layout of material_block entry in shaders:
+    // ka + transparency, kd + reflectivity, ks + shininess, ke
     struct raw_material {
         glm::vec4 values[4];
     };
 
+    static_assert(sizeof(raw_material) == 64, "raw_material must match std140 layout");
+
+    // std140 frame_block: projection_view, view_position
+    struct raw_frame {
+        glm::mat4 projection_view;
+        glm::vec4 view_position;
+    };
+
+    // std140 light_block, one ambient or directional light
+    struct raw_light {
+        glm::vec4 direction;
+        glm::vec4 la;
+        glm::vec4 ld;
+        glm::vec4 ls;
+    };
+
+    // std140 draw_block, only for draws that aren't instanced
+    struct raw_object {
+        glm::mat4   model;
+        glm::ivec4  material; // x
+    };
+
+    constexpr size_t initial_instances      = 1024;
+
+    // uniform handles of one program resolved at creation, ones program doesn't use stay -1
+    struct program_uniforms {
+        video::gl::uniform_handle   projection_view_matrix;
+        video::gl::uniform_handle   model_matrix;
+        video::gl::uniform_handle   view_position;
+        video::gl::uniform_handle   material_index;
+        video::gl::uniform_handle   ambient_color;
+        video::gl::uniform_handle   ambient_intensity;
+        video::gl::uniform_handle   emission_color;
+        video::gl::uniform_handle   light_direction;
+        video::gl::uniform_handle   light_ld;
+        video::gl::uniform_handle   light_ls;
+        video::gl::uniform_handle   material_kd;
+        video::gl::uniform_handle   material_ks;
+        video::gl::uniform_handle   material_shininess;
+        video::gl::uniform_handle   material_transparency;
+        video::gl::uniform_handle   material_reflectivity;
+        video::gl::uniform_handle   size;
+        video::gl::uniform_handle   scale;
+        video::gl::uniform_handle   ambient_map;
+        video::gl::uniform_handle   diffuse_map;
+        video::gl::uniform_handle   specular_map;
+        video::gl::uniform_handle   gloss_map;
+        video::gl::uniform_handle   normal_map;
+        video::gl::uniform_handle   environment_map;
+        video::gl::uniform_handle   emission_map;
+        video::gl::uniform_handle   cubemap;
+        video::gl::uniform_handle   tex0;
+        video::gl::uniform_handle   color_map;
+        video::gl::uniform_handle   glow_map;
+    };
+
+    // ambient, directional and glow passes draw same opaque set with one program each
+    enum class render_pass : uint32_t {
+        opaque
+    };
+
+    // key bits, most significant first: layer 4, pass 4, program 4, material 12, vertex array 16, view depth 24
+    struct queued_draw {
+        uint64_t    key;
+        uint32_t    index; // into sources, draws, matrices and draw_materials
+    };
+
+    // draws with same source, range and material, instances are consecutive in instance buffer
+    struct draw_batch {
+        uint32_t    draw; // first draw, gives source, range and material
+        uint32_t    first_instance;
+        uint32_t    instances;
+        size_t      uniforms = 0; // draw_block in uniform ring
+    };
+
+    // camera and first appended items of layer, items before next layer belong to it
+    struct render_layer {
+        glm::mat4   projection;
+        glm::mat4   view;
+        uint32_t    first_draw;
+        uint32_t    first_ambient;
+        uint32_t    first_directional;
+        uint32_t    first_particle;
+        size_t      frame_block = 0; // frame_block in uniform ring
+        size_t      first_batch = 0;
+    };
+
+    // lit passes of one layer, depth is cleared before them, so layers don't test against each other
+    struct layer_commands {
+        video::gl::command_buffer   ambient;
+        video::gl::command_buffer   directional;
+        video::gl::command_buffer   particles;
+    };
+
     struct raw_draw {
         video::gl::vertex_array va;
         uint32_t                mode;
@@ -41,9 +147,13 @@ namespace renderer {
         virtual auto append(const phong::ambient_light &light) -> void override;
         virtual auto append(const phong::directional_light &light) -> void override;
         virtual auto append(const phong::point_light &light) -> void override;
-        virtual auto append(const phong::material &material) -> void override;
-        virtual auto append(const video::vertices_source &source, const video::vertices_draw &draw, const glm::mat4 &model) -> void override;
+        virtual auto append(const video::vertices_source &source, const video::vertices_draw &draw, const glm::mat4 &model, const uint32_t material) -> void override;
         virtual auto append(const video::texture &tex, const uint32_t flags) -> void override;
+        virtual auto begin_layer(const glm::mat4 &proj, const glm::mat4 &view) -> void override;
+
+        virtual auto register_material(const phong::material &material) -> uint32_t override;
+        virtual auto update_material(const uint32_t index, const phong::material &material) -> void override;
+        virtual auto append_particles(const uint32_t count) -> video::v3t2c4* override;
 
         virtual auto dispath(video::instance_t &vi, const ui::draw_command_t &c) -> void override;
 
@@ -51,6 +161,8 @@ namespace renderer {
         virtual auto present(video::instance_t &vi, const glm::mat4 &proj, const glm::mat4 &view) -> void override;
         virtual auto presented_texture() -> video::texture override;
 
+        auto build_batches() -> void;
+
         auto draw_text(const video::font_t &font, float _x, float _y, float _w, float _h, const std::string &text, uint32_t _align, uint32_t _color) -> void;
         auto draw_line(float _x0, float _y0, float _x1, float _y1, float _w, uint32_t _color) -> void;
         auto draw_rect(const float _x, const float _y, const float _w, const float _h, const uint32_t _color) -> void;
@@ -62,7 +174,33 @@ namespace renderer {
         std::vector<video::vertices_source>     sources;
         std::vector<video::vertices_draw>       draws; // TODO: use raw_draw
         std::vector<glm::mat4>                  matrices;
+        std::vector<uint32_t>                   draw_materials;
+        std::vector<queued_draw>                draw_queue; // sorted every frame
+        std::vector<queued_draw>                sort_scratch;
+        std::vector<draw_batch>                 batches;
+
+        std::vector<render_layer>               layers; // empty until first begin_layer
+        std::vector<std::unique_ptr<layer_commands>> layer_passes; // grows to most layers seen, reused
+        bool                                    layers_full = false; // limit warning is given once
+        std::vector<video::gl::command_buffer*> submitted_passes;
+
+        std::vector<video::gl::instance_attributes> instances;
+        video::gl::buffer                       instance_buffer;
+        size_t                                  instance_capacity = 0;
+        bool                                    instanced_draws = false; // shaders read model and material per instance
+
+        video::gl::uniform_ring                 uniforms;
+        std::vector<size_t>                     light_blocks; // ambient lights first, then directional
+        bool                                    uniform_blocks = false; // frame, light and draw data from ring
+
+        // registry, never cleared, buffer grows by pages bound one at a time as material_block
         std::vector<phong::material>            materials;
+        std::vector<raw_material>               raw_materials;
+        size_t                                  uploaded_materials = 0;
+        size_t                                  material_capacity = 0;
+        video::gl::buffer                       material_buffer;
+        bool                                    material_blocks = false; // shaders read materials from buffer
+        bool                                    materials_full = false; // limit warning is given once
 
         std::vector<phong::ambient_light>       ambient_lights;
         std::vector<phong::directional_light>   directional_lights;
@@ -99,8 +237,6 @@ namespace renderer {
 
         video::gl::command_buffer               prepare_commands;
         video::gl::command_buffer               post_commands;
-        video::gl::command_buffer               ambient_commands;
-        video::gl::command_buffer               directional_commands;
         //video::gl::command_buffer               point_commands;
         //video::gl::command_buffer               transparent_commands;
         video::gl::command_buffer               glow_commands;
@@ -116,7 +252,16 @@ namespace renderer {
         video::program                          filter_hblur_shader;
         video::program                          skybox_shader;
 
+        program_uniforms                        emission_uniforms;
+        program_uniforms                        ambient_uniforms;
+        program_uniforms                        directional_uniforms;
+        program_uniforms                        postprocess_uniforms;
+        program_uniforms                        vblur_uniforms;
+        program_uniforms                        hblur_uniforms;
+        program_uniforms                        skybox_uniforms;
+
         video::sprite_batch                     sprites;
+        video::sprite_batch                     particles;
         video::program                          sprite_shader;
         video::triangles_batch                  triangles;
     };
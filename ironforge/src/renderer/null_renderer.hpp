@@ -32,19 +32,32 @@ namespace renderer {
             // do nothing
         }
 
-        virtual auto append(const phong::material &material) -> void override {
+        virtual auto append(const video::vertices_source &source, const video::vertices_draw &draw, const glm::mat4 &model, const uint32_t material) -> void override {
+            UNUSED(source), UNUSED(draw), UNUSED(model), UNUSED(material);
+        }
+
+        virtual auto register_material(const phong::material &material) -> uint32_t override {
             UNUSED(material);
-            // do nothing
+            return 0;
         }
 
-        virtual auto append(const video::vertices_source &source, const video::vertices_draw &draw, const glm::mat4 &model) -> void override {
-            UNUSED(source), UNUSED(draw), UNUSED(model);
+        virtual auto update_material(const uint32_t index, const phong::material &material) -> void override {
+            UNUSED(index), UNUSED(material);
+        }
+
+        virtual auto append_particles(const uint32_t count) -> video::v3t2c4* override {
+            UNUSED(count);
+            return nullptr;
         }
 
         virtual auto append(const video::texture &, const uint32_t flags) -> void override {
             (void)flags;
         }
 
+        virtual auto begin_layer(const glm::mat4 &proj, const glm::mat4 &view) -> void override {
+            UNUSED(proj), UNUSED(view);
+        }
+
         auto dispath(video::instance_t &vi, const ui::draw_command_t &c) -> void override {
             UNUSED(vi), UNUSED(c);
         }
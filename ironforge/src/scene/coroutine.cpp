@@ -0,0 +1,169 @@
+#include <algorithm>
+
+#include <core/journal.hpp>
+#include <lua.hpp>
+
+#include "script.hpp"
+#include "coroutine.hpp"
+
+namespace scene {
+    // first value yielded by scheduler functions, plain coroutine.yield resumes next tick
+    enum class wake_kind : int {
+        next_tick,
+        time,
+        event
+    };
+
+    static auto wakes_later(const sleeping_coroutine &a, const sleeping_coroutine &b) -> bool {
+        return a.wake_time > b.wake_time || (a.wake_time == b.wake_time && a.order > b.order);
+    }
+
+    static const char group_key[] = "scene.group";
+
+    static auto get_scheduler(lua_State *L) -> coroutine_scheduler* {
+        lua_getfield(L, LUA_REGISTRYINDEX, group_key);
+        const auto group = static_cast<uint32_t>(lua_tointeger(L, -1));
+        lua_pop(L, 1);
+
+        return bound_coroutines(group);
+    }
+
+    static auto resume(lua_State *L, coroutine_scheduler &cs, const int ref) -> void {
+        using namespace game;
+
+        lua_rawgeti(L, LUA_REGISTRYINDEX, ref);
+        auto co = lua_tothread(L, -1);
+        lua_pop(L, 1);
+
+        // not started coroutine holds function and its arguments
+        const auto nargs = lua_status(co) == LUA_YIELD ? 0 : lua_gettop(co) - 1;
+        const auto status = lua_resume(co, L, nargs);
+
+        if (status == LUA_YIELD) {
+            const auto kind = lua_gettop(co) >= 2 ? static_cast<wake_kind>(lua_tointeger(co, -2)) : wake_kind::next_tick;
+
+            switch (kind) {
+            case wake_kind::time:
+                cs.sleeping.push_back({cs.time + lua_tonumber(co, -1), cs.order++, ref});
+                std::push_heap(cs.sleeping.begin(), cs.sleeping.end(), wakes_later);
+                break;
+            case wake_kind::event:
+                cs.waiting[lua_tostring(co, -1)].push_back(ref);
+                break;
+            default:
+                cs.next_tick.push_back(ref);
+                break;
+            }
+
+            lua_settop(co, 0);
+            return;
+        }
+
+        if (status != LUA_OK)
+            journal::error(journal::_SCENE, "coroutine : %", lua_tostring(co, -1));
+
+        luaL_unref(L, LUA_REGISTRYINDEX, ref);
+    }
+
+    // start(fn, ...) runs fn as coroutine until its first wait
+    static int
+    start(lua_State *L) {
+        luaL_checktype(L, 1, LUA_TFUNCTION);
+
+        auto cs = get_scheduler(L);
+        if (!cs)
+            return luaL_error(L, "%s", "start : no scene bound");
+
+        const auto n = lua_gettop(L);
+
+        auto co = lua_newthread(L);
+        const auto ref = luaL_ref(L, LUA_REGISTRYINDEX);
+
+        lua_xmove(L, co, n);
+        resume(L, *cs, ref);
+
+        return 0;
+    }
+
+    // wait(seconds)
+    static int
+    wait(lua_State *L) {
+        const auto seconds = luaL_checknumber(L, 1);
+
+        lua_pushinteger(L, static_cast<int>(wake_kind::time));
+        lua_pushnumber(L, seconds);
+
+        return lua_yield(L, 2);
+    }
+
+    // wait_until(event), resumed by signal(event)
+    static int
+    wait_until(lua_State *L) {
+        luaL_checkstring(L, 1);
+
+        lua_pushinteger(L, static_cast<int>(wake_kind::event));
+        lua_pushvalue(L, 1);
+
+        return lua_yield(L, 2);
+    }
+
+    // yield() resumes on next update
+    static int
+    yield(lua_State *L) {
+        return lua_yield(L, 0);
+    }
+
+    // signal(event), delivered at sync point when script groups run in parallel
+    static int
+    signal(lua_State *L) {
+        std::string event = luaL_checkstring(L, 1);
+
+        if (auto commands = deferred_script_commands(); commands)
+            commands->push_back([event] (instance_t &) {
+                signal_script_event(event);
+            });
+        else
+            signal_script_event(event);
+
+        return 0;
+    }
+
+    auto init_coroutines(lua_State *L, const uint32_t group) -> void {
+        lua_pushinteger(L, group);
+        lua_setfield(L, LUA_REGISTRYINDEX, group_key);
+
+        lua_register(L, "start", start);
+        lua_register(L, "wait", wait);
+        lua_register(L, "wait_until", wait_until);
+        lua_register(L, "yield", yield);
+        lua_register(L, "signal", signal);
+    }
+
+    auto signal_coroutines(coroutine_scheduler &cs, const std::string &event) -> void {
+        auto it = cs.waiting.find(event);
+        if (it == cs.waiting.end())
+            return;
+
+        cs.runnable.insert(cs.runnable.end(), it->second.begin(), it->second.end());
+        cs.waiting.erase(it);
+    }
+
+    auto resume_coroutines(lua_State *L, coroutine_scheduler &cs, const float dt) -> void {
+        cs.time += static_cast<double>(dt);
+
+        cs.runnable.insert(cs.runnable.end(), cs.next_tick.begin(), cs.next_tick.end());
+        cs.next_tick.clear();
+
+        while (!cs.sleeping.empty() && cs.sleeping.front().wake_time <= cs.time) {
+            std::pop_heap(cs.sleeping.begin(), cs.sleeping.end(), wakes_later);
+            cs.runnable.push_back(cs.sleeping.back().ref);
+            cs.sleeping.pop_back();
+        }
+
+        // signals from resumed coroutines wake waiters in the same update
+        for (size_t i = 0; i < cs.runnable.size(); i++)
+            resume(L, cs, cs.runnable[i]);
+
+        cs.runnable.clear();
+    }
+} // namespace scene
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <unordered_map>
+
+struct lua_State;
+
+namespace scene {
+    struct sleeping_coroutine {
+        double      wake_time;
+        uint64_t    order; // keeps wake order stable for equal times
+        int         ref;
+    };
+
+    // one per scene and Lua state, advances only when its scene steps
+    struct coroutine_scheduler {
+        double                                              time = 0.0;
+        uint64_t                                            order = 0;
+        std::vector<sleeping_coroutine>                     sleeping; // min heap on wake time
+        std::unordered_map<std::string, std::vector<int>>   waiting;
+        std::vector<int>                                    next_tick;
+        std::vector<int>                                    runnable;
+    };
+
+    // registers start, wait, wait_until, yield and signal globals, started coroutines go to bound scene
+    auto init_coroutines(lua_State *L, const uint32_t group) -> void;
+
+    // wakes due sleepers, yielded and signaled coroutines
+    auto resume_coroutines(lua_State *L, coroutine_scheduler &cs, const float dt) -> void;
+    auto signal_coroutines(coroutine_scheduler &cs, const std::string &event) -> void;
+} // namespace scene
@@ -0,0 +1,68 @@
+#include <atomic>
+#include <limits>
+
+#include <utility/thread_pool.hpp>
+#include <scene/volume.hpp>
+
+#include "model.hpp"
+#include "culling.hpp"
+
+namespace scene {
+    auto cull_all_candidates(std::vector<render_candidate> &candidates, const frustum &view_frustum) -> uint32_t {
+        std::atomic<uint32_t> culled{0};
+
+        utils::parallel_for(utils::shared_pool(), candidates.size(), culling_chunk_size, [&] (const size_t begin, const size_t end) {
+            uint32_t chunk_culled = 0;
+
+            for (auto i = begin; i < end; i++) {
+                auto &c = candidates[i];
+
+                // unknown bounds never culled
+                if (!c.model || is_empty(c.model->aabb)) {
+                    c.visible = true;
+                    continue;
+                }
+
+                c.visible = is_visible(view_frustum, transform_bound_box(c.model->aabb, c.transform));
+
+                if (!c.visible)
+                    chunk_culled++;
+            }
+
+            culled.fetch_add(chunk_culled, std::memory_order_relaxed);
+        });
+
+        return culled.load();
+    }
+
+    static auto projected_size(const bound_sphere &sphere, const glm::mat4 &transform, const glm::mat4 &projection, const glm::mat4 &view) -> float {
+        const auto scale = glm::max(glm::length(glm::vec3{transform[0]}), glm::max(glm::length(glm::vec3{transform[1]}), glm::length(glm::vec3{transform[2]})));
+        const auto radius = sphere.radius * scale;
+
+        // orthographic, size not depends on distance
+        if (projection[3][3] == 1.f)
+            return radius * projection[1][1];
+
+        const auto center = view * transform * glm::vec4{sphere.center, 1.f};
+        const auto dist = -center.z;
+
+        if (dist <= radius)
+            return std::numeric_limits<float>::max();
+
+        return radius * projection[1][1] / dist;
+    }
+
+    auto select_all_lods(std::vector<render_candidate> &candidates, const glm::mat4 &projection, const glm::mat4 &view) -> void {
+        utils::parallel_for(utils::shared_pool(), candidates.size(), culling_chunk_size, [&] (const size_t begin, const size_t end) {
+            for (auto i = begin; i < end; i++) {
+                auto &c = candidates[i];
+
+                if (!c.visible || !c.model || !c.component || c.model->lods.empty())
+                    continue;
+
+                c.lod = select_model_lod(*c.model, projected_size(c.model->sphere, c.transform, projection, view), c.component->current_lod);
+                c.component->current_lod = c.lod;
+            }
+        });
+    }
+} // namespace scene
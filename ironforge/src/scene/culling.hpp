@@ -0,0 +1,35 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+
+#include <core/common.hpp>
+#include <core/math.hpp>
+#include <scene/volume.hpp>
+
+namespace scene {
+    struct model_instance;
+    struct model_component;
+
+    constexpr size_t culling_chunk_size = 512; // candidates per job
+
+    struct render_candidate {
+        uint32_t                entity = 0;
+        const model_instance    *model = nullptr;
+        model_component         *component = nullptr;
+        glm::mat4               transform = glm::mat4{1.f};
+        uint32_t                lod = 0;
+        bool                    visible = true;
+    };
+
+    ///
+    /// \brief Test candidates against the view frustum, big lists are split between workers
+    /// \return Number of culled candidates
+    ///
+    auto cull_all_candidates(std::vector<render_candidate> &candidates, const frustum &view_frustum) -> uint32_t;
+
+    ///
+    /// \brief Pick lod for visible candidates from projected bounding sphere size
+    ///
+    auto select_all_lods(std::vector<render_candidate> &candidates, const glm::mat4 &projection, const glm::mat4 &view) -> void;
+} // namespace scene
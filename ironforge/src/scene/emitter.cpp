@@ -0,0 +1,343 @@
+#include <algorithm>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#include <core/journal.hpp>
+#include <utility/thread_pool.hpp>
+#include <scene/instance.hpp>
+#include <renderer/renderer.hpp>
+
+#include "emitter.hpp"
+
+namespace scene {
+    struct particle_job {
+        emitter_instance    *emitter;
+        uint32_t            begin;
+        uint32_t            end;
+        video::v3t2c4       *vertices; // present only
+    };
+
+    // xorshift32
+    static inline auto next_random(uint32_t &state) -> float {
+        state ^= state << 13;
+        state ^= state >> 17;
+        state ^= state << 5;
+
+        return static_cast<float>(state >> 8) * (1.f / 16777216.f);
+    }
+
+    template <typename T>
+    static auto sample_curve(const std::vector<T> &keys, std::array<T, particle_curve_samples> &curve) -> void {
+        for (uint32_t i = 0; i < particle_curve_samples; i++) {
+            if (keys.size() == 1) {
+                curve[i] = keys[0];
+                continue;
+            }
+
+            const auto pos = static_cast<float>(i) / (particle_curve_samples - 1) * static_cast<float>(keys.size() - 1);
+            const auto k = std::min(static_cast<size_t>(pos), keys.size() - 2);
+            const auto f = pos - static_cast<float>(k);
+
+            curve[i] = keys[k] + (keys[k + 1] - keys[k]) * f;
+        }
+    }
+
+    static inline auto curve_index(const float t) -> uint32_t {
+        return static_cast<uint32_t>(std::min(std::max(t, 0.f), 1.f) * (particle_curve_samples - 1));
+    }
+
+    auto create_emitter(const json &info) -> std::optional<emitter_instance> {
+        using namespace game;
+        using namespace glm;
+
+        emitter_instance e;
+
+        if (info.find("rate") != info.end())
+            e.rate = info["rate"].get<float>();
+
+        if (info.find("lifetime") != info.end()) {
+            const auto &lt = info["lifetime"];
+            e.lifetime_min = lt.is_array() ? lt[0].get<float>() : lt.get<float>();
+            e.lifetime_max = lt.is_array() && lt.size() > 1 ? lt[1].get<float>() : e.lifetime_min;
+        }
+
+        if (info.find("size") != info.end())
+            e.size = info["size"].get<float>();
+
+        if (info.find("spread") != info.end())
+            e.spread = info["spread"].get<vec3>();
+
+        if (info.find("velocity_min") != info.end())
+            e.velocity_min = info["velocity_min"].get<vec3>();
+
+        if (info.find("velocity_max") != info.end())
+            e.velocity_max = info["velocity_max"].get<vec3>();
+
+        if (info.find("acceleration") != info.end())
+            e.acceleration = info["acceleration"].get<vec3>();
+
+        if (info.find("enabled") != info.end())
+            e.enabled = info["enabled"].get<bool>();
+
+        if (info.find("seed") != info.end())
+            e.seed = std::max(info["seed"].get<uint32_t>(), 1u);
+
+        if (e.lifetime_min <= 0.f || e.lifetime_max < e.lifetime_min) {
+            journal::warning(journal::_SCENE, "Wrong emitter lifetime % %", e.lifetime_min, e.lifetime_max);
+            return {};
+        }
+
+        std::vector<float> speed_keys;
+        if (info.find("speed") != info.end())
+            for (const auto &k : info["speed"])
+                speed_keys.push_back(k.get<float>());
+
+        std::vector<vec4> color_keys;
+        if (info.find("color") != info.end())
+            for (const auto &k : info["color"])
+                color_keys.push_back(vec4{k[0].get<float>(), k[1].get<float>(), k[2].get<float>(), k.size() > 3 ? k[3].get<float>() : 1.f});
+
+        sample_curve(speed_keys.empty() ? std::vector<float>{1.f} : speed_keys, e.speed_curve);
+        sample_curve(color_keys.empty() ? std::vector<vec4>{vec4{1.f}} : color_keys, e.color_curve);
+
+        const auto max_particles = info.find("max_particles") != info.end() ? info["max_particles"].get<uint32_t>() : default_max_particles;
+
+        auto &p = e.particles;
+        p.capacity = (max_particles + 3) & ~3u;
+
+        for (auto a : {&p.px, &p.py, &p.pz, &p.vx, &p.vy, &p.vz, &p.age, &p.inv_lifetime})
+            a->assign(p.capacity, 0.f);
+
+        journal::info(journal::_SCENE, "Create emitter:\n\trate %\n\tlifetime % %\n\tmax particles %", e.rate, e.lifetime_min, e.lifetime_max, p.capacity);
+
+        return e;
+    }
+
+    static auto emitter_origin(const instance_t &sc, const uint32_t entity) -> glm::vec3 {
+        if (auto it = sc.transforms.find(entity); it != sc.transforms.end())
+            return glm::vec3{it->second.model[3]};
+
+        if (auto it = sc.bodies.find(entity); it != sc.bodies.end())
+            return it->second.current.position;
+
+        return glm::vec3{0.f};
+    }
+
+    // swap with last, order of particles doesn't matter
+    static auto remove_dead(particle_storage &p) -> void {
+        for (uint32_t i = 0; i < p.count;) {
+            if (p.age[i] * p.inv_lifetime[i] < 1.f) {
+                i++;
+                continue;
+            }
+
+            const auto last = --p.count;
+            for (auto a : {&p.px, &p.py, &p.pz, &p.vx, &p.vy, &p.vz, &p.age, &p.inv_lifetime})
+                (*a)[i] = (*a)[last];
+        }
+    }
+
+    static auto spawn(emitter_instance &e, const glm::vec3 &origin, const float dt) -> void {
+        auto &p = e.particles;
+
+        e.spawn_accumulator += e.rate * dt;
+        const auto wanted = static_cast<uint32_t>(e.spawn_accumulator);
+        e.spawn_accumulator -= static_cast<float>(wanted);
+
+        const auto count = std::min(wanted, p.capacity - p.count);
+
+        for (uint32_t k = 0; k < count; k++) {
+            const auto i = p.count++;
+
+            p.px[i] = origin.x + (next_random(e.seed) * 2.f - 1.f) * e.spread.x;
+            p.py[i] = origin.y + (next_random(e.seed) * 2.f - 1.f) * e.spread.y;
+            p.pz[i] = origin.z + (next_random(e.seed) * 2.f - 1.f) * e.spread.z;
+
+            p.vx[i] = e.velocity_min.x + (e.velocity_max.x - e.velocity_min.x) * next_random(e.seed);
+            p.vy[i] = e.velocity_min.y + (e.velocity_max.y - e.velocity_min.y) * next_random(e.seed);
+            p.vz[i] = e.velocity_min.z + (e.velocity_max.z - e.velocity_min.z) * next_random(e.seed);
+
+            p.age[i] = 0.f;
+            p.inv_lifetime[i] = 1.f / (e.lifetime_min + (e.lifetime_max - e.lifetime_min) * next_random(e.seed));
+        }
+    }
+
+    // semi implicit Euler, speed curve scales displacement over particle life
+    static auto simulate(emitter_instance &e, const uint32_t begin, const uint32_t end, const float dt) -> void {
+        auto &p = e.particles;
+        const auto &curve = e.speed_curve;
+
+#if defined(__SSE2__)
+        const auto vdt = _mm_set1_ps(dt);
+        const auto one = _mm_set1_ps(1.f);
+        const auto zero = _mm_setzero_ps();
+        const auto samples = _mm_set1_ps(static_cast<float>(particle_curve_samples - 1));
+        const auto ax = _mm_set1_ps(e.acceleration.x * dt);
+        const auto ay = _mm_set1_ps(e.acceleration.y * dt);
+        const auto az = _mm_set1_ps(e.acceleration.z * dt);
+
+        alignas(16) int32_t index[4];
+
+        for (auto i = begin; i < end; i += 4) {
+            const auto age = _mm_add_ps(_mm_loadu_ps(&p.age[i]), vdt);
+            _mm_storeu_ps(&p.age[i], age);
+
+            const auto t = _mm_max_ps(_mm_min_ps(_mm_mul_ps(age, _mm_loadu_ps(&p.inv_lifetime[i])), one), zero);
+            _mm_store_si128(reinterpret_cast<__m128i*>(index), _mm_cvttps_epi32(_mm_mul_ps(t, samples)));
+
+            const auto step = _mm_mul_ps(_mm_set_ps(curve[index[3]], curve[index[2]], curve[index[1]], curve[index[0]]), vdt);
+
+            const auto vx = _mm_add_ps(_mm_loadu_ps(&p.vx[i]), ax);
+            const auto vy = _mm_add_ps(_mm_loadu_ps(&p.vy[i]), ay);
+            const auto vz = _mm_add_ps(_mm_loadu_ps(&p.vz[i]), az);
+
+            _mm_storeu_ps(&p.vx[i], vx);
+            _mm_storeu_ps(&p.vy[i], vy);
+            _mm_storeu_ps(&p.vz[i], vz);
+
+            _mm_storeu_ps(&p.px[i], _mm_add_ps(_mm_loadu_ps(&p.px[i]), _mm_mul_ps(vx, step)));
+            _mm_storeu_ps(&p.py[i], _mm_add_ps(_mm_loadu_ps(&p.py[i]), _mm_mul_ps(vy, step)));
+            _mm_storeu_ps(&p.pz[i], _mm_add_ps(_mm_loadu_ps(&p.pz[i]), _mm_mul_ps(vz, step)));
+        }
+#else
+        const auto a = e.acceleration * dt;
+
+        for (auto i = begin; i < end; i++) {
+            p.age[i] += dt;
+
+            const auto step = curve[curve_index(p.age[i] * p.inv_lifetime[i])] * dt;
+
+            p.vx[i] += a.x;
+            p.vy[i] += a.y;
+            p.vz[i] += a.z;
+
+            p.px[i] += p.vx[i] * step;
+            p.py[i] += p.vy[i] * step;
+            p.pz[i] += p.vz[i] * step;
+        }
+#endif
+    }
+
+    // whole lanes, tail of last lane is padding inside capacity
+    static auto make_jobs(std::vector<particle_job> &jobs, emitter_instance &e, video::v3t2c4 *vertices) -> void {
+        const auto lanes = (e.particles.count + 3) & ~3u;
+
+        for (uint32_t begin = 0; begin < lanes; begin += particle_chunk_size)
+            jobs.push_back({&e, begin, std::min<uint32_t>(begin + particle_chunk_size, lanes), vertices});
+    }
+
+    auto update_all_emitters(instance_t &sc, const float dt) -> void {
+        if (dt <= 0.f)
+            return;
+
+        const auto step = std::min(dt, max_particle_step);
+
+        std::vector<particle_job> jobs;
+
+        for (auto &[ix, e] : sc.emitters) {
+            remove_dead(e.particles);
+
+            if (e.enabled)
+                spawn(e, emitter_origin(sc, ix), step);
+
+            make_jobs(jobs, e, nullptr);
+        }
+
+        utils::parallel_for(utils::shared_pool(), jobs.size(), 1, [&jobs, step] (const size_t begin, const size_t end) {
+            for (auto i = begin; i < end; i++)
+                simulate(*jobs[i].emitter, jobs[i].begin, jobs[i].end, step);
+        });
+    }
+
+    static inline auto write_quad(video::v3t2c4 *q, const float x, const float y, const float z, const float hx, const float hy, const glm::vec4 &color) -> void {
+        using namespace glm;
+
+        q[0] = {vec3{x - hx, y + hy, z}, vec2{0.f, 0.f}, color};
+        q[1] = {vec3{x + hx, y + hy, z}, vec2{1.f, 0.f}, color};
+        q[2] = {vec3{x + hx, y - hy, z}, vec2{1.f, 1.f}, color};
+        q[3] = {vec3{x - hx, y - hy, z}, vec2{0.f, 1.f}, color};
+    }
+
+    // projects particles to camera facing quads in normalized device coordinates, depth is kept
+    // for depth test against scene, particles behind camera become degenerate quads
+    static auto project(const particle_job &job, const glm::mat4 &vp, const glm::vec2 &scale) -> void {
+        const auto &e = *job.emitter;
+        const auto &p = e.particles;
+        const auto end = std::min(job.end, p.count);
+
+        constexpr float near_w = 1e-3f;
+
+        alignas(16) float cx[4], cy[4], cz[4], cw[4];
+
+        for (auto i = job.begin; i < end; i += 4) {
+#if defined(__SSE2__)
+            const auto x = _mm_loadu_ps(&p.px[i]);
+            const auto y = _mm_loadu_ps(&p.py[i]);
+            const auto z = _mm_loadu_ps(&p.pz[i]);
+
+            const auto row = [&x, &y, &z, &vp] (const int r) {
+                return _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(vp[0][r]), x), _mm_mul_ps(_mm_set1_ps(vp[1][r]), y)),
+                                  _mm_add_ps(_mm_mul_ps(_mm_set1_ps(vp[2][r]), z), _mm_set1_ps(vp[3][r])));
+            };
+
+            _mm_store_ps(cx, row(0));
+            _mm_store_ps(cy, row(1));
+            _mm_store_ps(cz, row(2));
+            _mm_store_ps(cw, row(3));
+#else
+            for (uint32_t k = 0; k < 4; k++) {
+                const auto c = vp * glm::vec4{p.px[i + k], p.py[i + k], p.pz[i + k], 1.f};
+                cx[k] = c.x;
+                cy[k] = c.y;
+                cz[k] = c.z;
+                cw[k] = c.w;
+            }
+#endif
+            const auto lanes = std::min(4u, end - i);
+            for (uint32_t k = 0; k < lanes; k++) {
+                auto q = job.vertices + (i + k) * 4;
+
+                if (cw[k] <= near_w) {
+                    write_quad(q, 0.f, 0.f, 0.f, 0.f, 0.f, glm::vec4{0.f});
+                    continue;
+                }
+
+                const auto inv_w = 1.f / cw[k];
+                const auto color = e.color_curve[curve_index(p.age[i + k] * p.inv_lifetime[i + k])];
+
+                write_quad(q, cx[k] * inv_w, cy[k] * inv_w, cz[k] * inv_w, e.size * scale.x * inv_w, e.size * scale.y * inv_w, color);
+            }
+        }
+    }
+
+    auto present_all_emitters(instance_t &sc, const glm::mat4 &projection, const glm::mat4 &view, std::unique_ptr<renderer::instance> &render) -> uint32_t {
+        const auto vp = projection * view;
+        const auto scale = glm::vec2{projection[0][0], projection[1][1]};
+
+        std::vector<particle_job> jobs;
+        uint32_t presented = 0;
+
+        for (auto &[ix, e] : sc.emitters) {
+            (void)ix;
+
+            if (e.particles.count == 0)
+                continue;
+
+            auto vertices = render->append_particles(e.particles.count);
+            if (!vertices)
+                continue;
+
+            make_jobs(jobs, e, vertices);
+            presented += e.particles.count;
+        }
+
+        utils::parallel_for(utils::shared_pool(), jobs.size(), 1, [&jobs, &vp, &scale] (const size_t begin, const size_t end) {
+            for (auto i = begin; i < end; i++)
+                project(jobs[i], vp, scale);
+        });
+
+        return presented;
+    }
+} // namespace scene
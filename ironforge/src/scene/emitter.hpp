@@ -1,12 +1,65 @@
 #pragma once
 
+#include <array>
+#include <vector>
+#include <memory>
+#include <cstdint>
+#include <optional>
 #include <functional>
 
+#include <core/math.hpp>
+#include <core/json.hpp>
+
+namespace renderer {
+    struct instance;
+}
 
 namespace scene {
+    struct instance_type;
+    typedef instance_type instance_t;
+
+    constexpr uint32_t particle_curve_samples = 32;
+    constexpr uint32_t default_max_particles = 10000;
+    constexpr size_t particle_chunk_size = 4096; // particles per job, multiple of four
+    constexpr float max_particle_step = 0.1f;
+
+    // SoA, capacity is multiple of four so SIMD loops run over whole lanes
+    struct particle_storage {
+        std::vector<float>  px, py, pz;
+        std::vector<float>  vx, vy, vz;
+        std::vector<float>  age;
+        std::vector<float>  inv_lifetime;
+        uint32_t            count = 0;
+        uint32_t            capacity = 0;
+    };
+
     struct emitter_instance {
-        emitter_instance( ) = default;
+        float       rate = 100.f; // particles per second
+        float       lifetime_min = 1.f;
+        float       lifetime_max = 1.f;
+        float       size = 0.05f; // half extent in world units
+        glm::vec3   spread = glm::vec3{0.f}; // spawn box half extent around entity
+        glm::vec3   velocity_min = glm::vec3{0.f};
+        glm::vec3   velocity_max = glm::vec3{0.f, 1.f, 0.f};
+        glm::vec3   acceleration = glm::vec3{0.f};
+        bool        enabled = true;
+
+        // sampled over normalized age
+        std::array<float, particle_curve_samples>       speed_curve;
+        std::array<glm::vec4, particle_curve_samples>   color_curve;
+
+        float               spawn_accumulator = 0.f;
+        uint32_t            seed = 1;
+        particle_storage    particles;
     };
 
     using emitter_ref = std::reference_wrapper<emitter_instance>;
+
+    auto create_emitter(const json &info) -> std::optional<emitter_instance>;
+
+    ///
+    /// \brief Spawns, simulates and removes particles, particles are visual only and advanced by frame time
+    ///
+    auto update_all_emitters(instance_t &sc, const float dt) -> void;
+    auto present_all_emitters(instance_t &sc, const glm::mat4 &projection, const glm::mat4 &view, std::unique_ptr<renderer::instance> &render) -> uint32_t;
 } // namespace scene
@@ -6,6 +6,10 @@
 
 namespace scene {
     auto create_entity(assets::instance_t &asset, video::instance_t &vi, instance_t &sc, const json &info) -> uint32_t {
+        return create_entity(asset, vi, sc, info, sc);
+    }
+
+    auto create_entity(assets::instance_t &asset, video::instance_t &vi, instance_t &sc, const json &info, const instance_t &shared) -> uint32_t {
         using namespace std;
         using namespace game;
 
@@ -20,7 +24,9 @@ namespace scene {
 
         const auto parent_name = info.find("parent") != info.end() ? info["parent"].get<string>() : string{};
 
-        const auto parent_ix = find_entity_by_name(sc, parent_name);
+        auto parent_ix = find_entity_by_name(sc, parent_name);
+        if (parent_ix == 0 && &shared != &sc)
+            parent_ix = find_entity_by_name(shared, parent_name);
         const auto renderable = info.find("renderable") != info.end() ? info["renderable"].get<bool>() : false;
         //const auto bool movable = info.find("movable") != info.end() ? info["movable"].get<bool>() : false;
 
@@ -47,9 +53,15 @@ namespace scene {
         }
 
         if (info.find("model") != info.end()) {
-            const auto m = get_model(sc, info["model"].get<string>());
+            const auto m = get_model(shared, info["model"].get<string>());
             if (m)
-                sc.models[ix] = m.value();
+                sc.models[ix] = model_component{m.value(), 0};
+        }
+
+        if (info.find("occluder") != info.end()) {
+            const auto o = create_occluder(asset, info["occluder"]);
+            if (o)
+                sc.occluders[ix] = o.value();
         }
 
         if (info.find("light") != info.end()) {
@@ -58,11 +70,17 @@ namespace scene {
                 sc.lights[ix] = l.value();
         }
 
+        if (info.find("emitter") != info.end()) {
+            auto em = create_emitter(info["emitter"]);
+            if (em)
+                sc.emitters[ix] = std::move(em.value());
+        }
+
         if (info.find("materials") != info.end()) {
             const auto mats = info["materials"];
             if (mats.size() != 0) {
                 const auto mat_name = mats[0].get<string>();
-                const auto m = get_material(sc, mat_name);
+                const auto m = get_material(shared, mat_name);
                 if (m)
                     sc.materials[ix] = m.value();
             }
@@ -75,17 +93,19 @@ namespace scene {
         }
 
         if (info.find("input") != info.end()) {
-            const auto in = create_input(ix, info["input"], sc.input_sources);
+            const auto in = create_input(ix, info["input"], shared.input_sources);
 
-            if (in)
+            if (in) {
                 sc.inputs[ix] = in.value();
+                sc.input_dispatch.dirty = true;
+            }
         }
 
         return ix;
     }
 
     // TODO: optional
-    auto find_entity_by_name(instance_t &sc, const std::string &name) -> uint32_t {
+    auto find_entity_by_name(const instance_t &sc, const std::string &name) -> uint32_t {
         if (name.empty())
             return 0;
 
@@ -139,6 +159,7 @@ namespace scene {
         if ( input_it != sc.inputs.end() ) {
             res |= true;
             sc.inputs.erase( input_it );
+            sc.input_dispatch.dirty = true;
         }
 
         auto transform_it = sc.transforms.find( entity_id );
@@ -159,6 +180,12 @@ namespace scene {
             sc.lights.erase( light_it );
         }
 
+        auto occluder_it = sc.occluders.find( entity_id );
+        if ( occluder_it != sc.occluders.end() ) {
+            res |= true;
+            sc.occluders.erase( occluder_it );
+        }
+
         return res;
     }
 
@@ -175,7 +202,7 @@ namespace scene {
     auto get_entity_material( instance_t &inst, const uint32_t entity_id ) -> std::optional<material_ref> {
         auto it = inst.materials.find( entity_id );
         if ( it != inst.materials.end( ) )
-            return std::ref( it->second );
+            return std::ref( inst.material_storage[it->second] );
 
         return {};
     }
@@ -183,7 +210,7 @@ namespace scene {
     auto get_entity_model( instance_t &inst, const uint32_t entity_id ) -> std::optional<model_ref> {
         auto it = inst.models.find( entity_id );
         if ( it != inst.models.end() )
-            return std::ref( it->second );
+            return std::ref( inst.model_storage[it->second.handle] );
 
         return {};
     }
@@ -244,4 +271,12 @@ namespace scene {
         return {};
     }
 
+    auto get_entity_occluder( instance_t &inst, const uint32_t entity_id ) -> std::optional<occluder_ref> {
+        auto it = inst.occluders.find( entity_id );
+        if ( it != inst.occluders.end() )
+            return std::ref( it->second );
+
+        return {};
+    }
+
 } // namespace scene
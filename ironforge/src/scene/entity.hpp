@@ -19,8 +19,10 @@ namespace scene {
     typedef instance_type instance_t;
 
     auto create_entity(assets::instance_t &asset, video::instance_t &vi, instance_t &sc, const json &info) -> uint32_t;
+    // components go to sc, models, materials, inputs and parents not found in sc are looked up in shared
+    auto create_entity(assets::instance_t &asset, video::instance_t &vi, instance_t &sc, const json &info, const instance_t &shared) -> uint32_t;
 
-    auto find_entity_by_name(instance_t &sc, const std::string &name) -> uint32_t;
+    auto find_entity_by_name(const instance_t &sc, const std::string &name) -> uint32_t;
 
     auto remove_entity( instance_t &sc, const uint32_t entity_id ) -> bool;
 
@@ -34,5 +36,6 @@ namespace scene {
     auto get_entity_transform( instance_t &inst, const uint32_t entity_id ) -> std::optional<transform_ref>;
     auto get_entity_emitter( instance_t &inst, const uint32_t entity_id ) -> std::optional<emitter_ref>;
     auto get_entity_light( instance_t &inst, const uint32_t entity_id ) -> std::optional<light_ref>;
+    auto get_entity_occluder( instance_t &inst, const uint32_t entity_id ) -> std::optional<occluder_ref>;
 
 } // namespace scene
@@ -0,0 +1,223 @@
+#include <algorithm>
+#include <utility>
+
+#include <core/journal.hpp>
+#include <scene/instance.hpp>
+
+#include "event.hpp"
+
+namespace scene {
+    static std::atomic<uint64_t> bus_counter{1};
+    // unique over all buses, scenes share Lua states that keep handlers by id
+    static std::atomic<subscription_id> subscription_counter{1};
+
+    // ring of calling thread in last used bus, most threads publish into one scene
+    struct producer_slot {
+        uint64_t    bus_id = 0;
+        event_ring  *ring = nullptr;
+    };
+
+    static thread_local producer_slot last_producer;
+    static thread_local std::unordered_map<uint64_t, event_ring*> producer_rings;
+
+    event_bus::event_bus() : id{bus_counter++} {
+        for (auto &r : rings)
+            r.store(nullptr, std::memory_order_relaxed);
+    }
+
+    event_bus::~event_bus() {
+        for (auto &r : rings)
+            delete r.load(std::memory_order_acquire);
+    }
+
+    event_bus::event_bus(const event_bus &other) : event_bus{} {
+        subscriptions = other.subscriptions;
+    }
+
+    event_bus::event_bus(event_bus &&other) noexcept : event_bus{} {
+        *this = std::move(other);
+    }
+
+    event_bus& event_bus::operator=(const event_bus &other) {
+        if (this != &other) {
+            subscriptions = other.subscriptions;
+        }
+
+        return *this;
+    }
+
+    // producer threads cache rings by bus id, so moved rings keep their id
+    event_bus& event_bus::operator=(event_bus &&other) noexcept {
+        if (this == &other)
+            return *this;
+
+        for (size_t i = 0; i < rings.size(); i++)
+            rings[i].store(other.rings[i].exchange(rings[i].load()));
+
+        id = std::exchange(other.id, id);
+        claimed_rings = other.claimed_rings.exchange(claimed_rings.load());
+        dropped = other.dropped.load();
+        subscriptions = std::move(other.subscriptions);
+        batch = std::move(other.batch);
+
+        return *this;
+    }
+
+    static auto producer_ring(event_bus &bus) -> event_ring* {
+        if (last_producer.bus_id == bus.id)
+            return last_producer.ring;
+
+        auto &ring = producer_rings[bus.id];
+        if (!ring) {
+            const auto index = bus.claimed_rings.fetch_add(1, std::memory_order_relaxed);
+            if (index >= max_event_producers) {
+                producer_rings.erase(bus.id);
+                return nullptr;
+            }
+
+            ring = new event_ring;
+            bus.rings[index].store(ring, std::memory_order_release);
+        }
+
+        last_producer = {bus.id, ring};
+
+        return ring;
+    }
+
+    auto publish_event(event_bus &bus, const entity_event &ev) -> bool {
+        auto ring = producer_ring(bus);
+        if (!ring) {
+            bus.dropped.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+
+        const auto head = ring->head.load(std::memory_order_relaxed);
+        if (head - ring->tail.load(std::memory_order_acquire) >= event_ring_capacity) {
+            bus.dropped.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+
+        ring->events[head & (event_ring_capacity - 1)] = ev;
+        ring->head.store(head + 1, std::memory_order_release);
+
+        return true;
+    }
+
+    auto publish_event(event_bus &bus, const event_type type, const uint32_t entity, const uint32_t sender, const float value) -> bool {
+        return publish_event(bus, entity_event{type, entity, sender, {value, 0.f, 0.f, 0.f}});
+    }
+
+    auto reserve_subscription(event_bus &bus) -> subscription_id {
+        (void)bus;
+        return subscription_counter.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    auto subscribe(event_bus &bus, const event_type type, const uint32_t entity, event_callback callback, const subscription_id id) -> subscription_id {
+        const auto sid = id != 0 ? id : reserve_subscription(bus);
+
+        bus.subscriptions[type].push_back({sid, entity, std::move(callback)});
+
+        return sid;
+    }
+
+    auto unsubscribe(event_bus &bus, const subscription_id id) -> bool {
+        for (auto &[type, subs] : bus.subscriptions) {
+            (void)type;
+
+            auto it = std::find_if(subs.begin(), subs.end(), [id] (const event_subscription &s) {
+                return s.id == id;
+            });
+
+            if (it == subs.end())
+                continue;
+
+            // vectors may be walked by dispatch_events right now
+            if (bus.delivering) {
+                it->callback = nullptr;
+                bus.compact = true;
+            } else
+                subs.erase(it);
+
+            return true;
+        }
+
+        return false;
+    }
+
+    static auto drain(event_bus &bus) -> void {
+        const auto count = std::min(bus.claimed_rings.load(std::memory_order_acquire), max_event_producers);
+
+        for (uint32_t i = 0; i < count; i++) {
+            auto ring = bus.rings[i].load(std::memory_order_acquire);
+            if (!ring)
+                continue; // claimed but not yet published
+
+            const auto head = ring->head.load(std::memory_order_acquire);
+            auto tail = ring->tail.load(std::memory_order_relaxed);
+
+            for (; tail != head; tail++)
+                bus.batch.push_back(ring->events[tail & (event_ring_capacity - 1)]);
+
+            ring->tail.store(tail, std::memory_order_release);
+        }
+    }
+
+    static auto deliver(instance_t &sc, event_bus &bus, const entity_event &ev, const event_type type) -> void {
+        const auto it = bus.subscriptions.find(type);
+        if (it == bus.subscriptions.end())
+            return;
+
+        // subscribing from handler may grow vector, new subscriptions start with next event
+        const auto count = it->second.size();
+        for (size_t i = 0; i < count; i++) {
+            const auto &s = bus.subscriptions[type][i];
+            if (s.callback && (s.entity == any_entity || s.entity == ev.entity)) {
+                const auto callback = s.callback;
+                callback(sc, ev);
+            }
+        }
+    }
+
+    auto dispatch_events(instance_t &sc, event_bus &bus) -> size_t {
+        using namespace game;
+
+        if (bus.delivering)
+            return 0;
+
+        bus.delivering = true;
+
+        size_t delivered = 0;
+        for (uint32_t round = 0; round < max_event_rounds; round++) {
+            bus.batch.clear();
+            drain(bus);
+
+            if (bus.batch.empty())
+                break;
+
+            for (const auto &ev : bus.batch) {
+                deliver(sc, bus, ev, ev.type);
+                deliver(sc, bus, ev, any_event);
+            }
+
+            delivered += bus.batch.size();
+        }
+
+        bus.delivering = false;
+
+        if (bus.compact) {
+            for (auto &[type, subs] : bus.subscriptions) {
+                (void)type;
+                subs.erase(std::remove_if(subs.begin(), subs.end(), [] (const event_subscription &s) {
+                    return !s.callback;
+                }), subs.end());
+            }
+
+            bus.compact = false;
+        }
+
+        if (const auto dropped = bus.dropped.exchange(0, std::memory_order_relaxed); dropped > 0)
+            journal::warning(journal::_SCENE, "Dropped % events", dropped);
+
+        return delivered;
+    }
+} // namespace scene
@@ -0,0 +1,89 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <utility/hash.hpp>
+
+namespace scene {
+    struct instance_type;
+    typedef instance_type instance_t;
+
+    using event_type = uint64_t; // hash of event name
+
+    struct entity_event {
+        event_type  type;
+        uint32_t    entity; // subject, subscriptions filter on it
+        uint32_t    sender; // 0 for systems
+        float       values[4];
+    };
+
+    constexpr event_type any_event = 0;
+    constexpr uint32_t any_entity = 0;
+
+    constexpr uint32_t event_ring_capacity = 4096; // power of two
+    constexpr uint32_t max_event_producers = 32; // threads publishing into one bus
+    constexpr uint32_t max_event_rounds = 4; // events published by handlers are delivered in same batch
+
+    // single producer, single consumer
+    struct event_ring {
+        alignas(64) std::atomic<uint32_t>   head{0}; // written by producer thread
+        alignas(64) std::atomic<uint32_t>   tail{0}; // written by delivering thread
+        std::array<entity_event, event_ring_capacity> events;
+    };
+
+    using event_callback = std::function<void(instance_t &, const entity_event &)>;
+    using subscription_id = uint32_t;
+
+    struct event_subscription {
+        subscription_id id;
+        uint32_t        entity;
+        event_callback  callback; // empty when unsubscribed during delivery
+    };
+
+    ///
+    /// \brief Typed entity events, publish from any thread, delivered in batches by dispatch_events
+    ///
+    struct event_bus {
+        event_bus();
+        ~event_bus();
+
+        // pending events stay with the source, only subscriptions are copied
+        event_bus(const event_bus &other);
+        event_bus(event_bus &&other) noexcept;
+        event_bus& operator=(const event_bus &other);
+        event_bus& operator=(event_bus &&other) noexcept;
+
+        uint64_t                                        id; // identifies bus in per-thread ring cache
+        std::array<std::atomic<event_ring*>, max_event_producers> rings;
+        std::atomic<uint32_t>                           claimed_rings{0};
+        std::atomic<uint64_t>                           dropped{0};
+
+        std::unordered_map<event_type, std::vector<event_subscription>> subscriptions; // any_event included
+        std::vector<entity_event>                       batch;
+        bool                                            delivering = false;
+        bool                                            compact = false;
+    };
+
+    inline auto make_event_type(const std::string &name) -> event_type {
+        const auto h = utils::xxhash64(name);
+        return h != any_event ? h : 1;
+    }
+
+    // lock free, false when ring of calling thread is full or there are too many producer threads
+    auto publish_event(event_bus &bus, const entity_event &ev) -> bool;
+    auto publish_event(event_bus &bus, const event_type type, const uint32_t entity, const uint32_t sender = 0, const float value = 0.f) -> bool;
+
+    // delivering thread only, id may be reserved earlier with reserve_subscription
+    auto subscribe(event_bus &bus, const event_type type, const uint32_t entity, event_callback callback, const subscription_id id = 0) -> subscription_id;
+    auto reserve_subscription(event_bus &bus) -> subscription_id;
+    auto unsubscribe(event_bus &bus, const subscription_id id) -> bool;
+
+    // drains all rings and calls matching subscriptions, type specific first then any_event
+    auto dispatch_events(instance_t &sc, event_bus &bus) -> size_t;
+} // namespace scene
@@ -34,63 +34,91 @@ namespace scene {
         return true;
     }
 
+    auto build_input_dispatch(scene::instance_t &s) -> void {
+        auto &dispatch = s.input_dispatch;
+
+        dispatch.handlers.clear();
+        dispatch.generation = script_classes_generation();
+        dispatch.dirty = false;
+
+        for (const auto &[ix, input] : s.inputs) {
+            (void)ix;
+
+            const auto script_it = s.scripts.find(input.entity);
+            if (script_it == s.scripts.end())
+                continue;
+
+            const auto &script = script_it->second;
+
+            const auto append = [&dispatch, &script, entity = input.entity] (const input_trigger trigger, const int32_t code, const std::string &fn_name) {
+                if (fn_name.empty())
+                    return;
+
+                const auto fn_ref = resolve_script_fn(script, fn_name);
+                if (fn_ref == invalid_script_ref)
+                    return;
+
+                dispatch.handlers[input_dispatch_key(trigger, code)].push_back({entity, fn_ref, fn_name, make_event_type(fn_name)});
+            };
+
+            for (const auto &action : input.actions) {
+                if (action.key != SDLK_UNKNOWN) {
+                    append(input_trigger::key_down, action.key, action.key_down);
+                    append(input_trigger::key_up, action.key, action.key_up);
+                }
+
+                if (action.cbutton != SDL_CONTROLLER_BUTTON_INVALID) {
+                    append(input_trigger::button_down, action.cbutton, action.key_down);
+                    append(input_trigger::button_up, action.cbutton, action.key_up);
+                }
+
+                if (action.caxis != SDL_CONTROLLER_AXIS_INVALID)
+                    append(input_trigger::axis_motion, action.caxis, action.caxis_motion);
+            }
+        }
+    }
+
+    template <typename... Args>
+    static auto dispatch_input(scene::instance_t &s, const input_trigger trigger, const int32_t code, Args... args) -> void {
+        auto &dispatch = s.input_dispatch;
+
+        if (dispatch.dirty || dispatch.generation != script_classes_generation())
+            build_input_dispatch(s);
+
+        const auto it = dispatch.handlers.find(input_dispatch_key(trigger, code));
+        if (it == dispatch.handlers.end())
+            return;
+
+        for (const auto &h : it->second) {
+            if (auto script_it = s.scripts.find(h.entity); script_it != s.scripts.end())
+                call_script_fn(script_it->second, h.fn_ref, h.fn_name.c_str(), args...);
+
+            publish_event(s.events, h.event, h.entity, 0, static_cast<float>(args)...);
+        }
+    }
+
     auto process_input_events(scene::instance_t &s, const SDL_Event &e) -> void {
         using namespace game;
 
         switch (e.type) {
         case SDL_KEYDOWN:
-            for (const auto &[ix, input] : s.inputs) {
-                (void)ix;
-
-                for(const auto &action : input.actions)
-                    if (e.key.keysym.sym == action.key)
-                        if (!action.key_down.empty())
-                            call_fn(&(s.get_script(input.entity)), action.key_down.c_str());
-            }
+            dispatch_input(s, input_trigger::key_down, e.key.keysym.sym);
             break;
         case SDL_KEYUP:
-            for (const auto &[ix, input] : s.inputs) {
-                (void)ix;
-
-                for(const auto &action : input.actions)
-                    if (e.key.keysym.sym == action.key)
-                        if (!action.key_up.empty())
-                            call_fn(&(s.get_script(input.entity)), action.key_up.c_str());
-            }
+            dispatch_input(s, input_trigger::key_up, e.key.keysym.sym);
             break;
         case SDL_CONTROLLERBUTTONDOWN:
-            for (const auto &[ix, input] : s.inputs) {
-                (void)ix;
-
-                for(const auto &action : input.actions)
-                    if (e.cbutton.button == action.cbutton)
-                        if (!action.key_down.empty())
-                            call_fn(&(s.get_script(input.entity)), action.key_down.c_str());
-            }
+            dispatch_input(s, input_trigger::button_down, e.cbutton.button);
 
             journal::debug(journal::_INPUT, "button=% state=%", e.cbutton.button, e.cbutton.state);
             break;
         case SDL_CONTROLLERBUTTONUP:
-            for (const auto &[ix, input] : s.inputs) {
-                (void)ix;
-
-                for(const auto &action : input.actions)
-                    if (e.cbutton.button == action.cbutton)
-                        if (!action.key_up.empty())
-                            call_fn(&(s.get_script(input.entity)), action.key_up.c_str());
-            }
+            dispatch_input(s, input_trigger::button_up, e.cbutton.button);
 
             journal::debug(journal::_INPUT, "button=% state=%", e.cbutton.button, e.cbutton.state);
             break;
         case SDL_CONTROLLERAXISMOTION:
-            for (const auto &[ix, input] : s.inputs) {
-                (void)ix;
-
-                for(const auto &action : input.actions)
-                    if (e.caxis.axis == action.caxis)
-                        if (!action.caxis_motion.empty())
-                            call_with_args(&(s.get_script(input.entity)), action.caxis_motion.c_str(), (float)e.caxis.value / INT16_MAX);
-            }
+            dispatch_input(s, input_trigger::axis_motion, e.caxis.axis, static_cast<float>(e.caxis.value) / INT16_MAX);
             break;
         }
     }
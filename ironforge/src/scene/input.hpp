@@ -6,6 +6,7 @@
 #include <memory>
 #include <optional>
 #include <functional>
+#include <unordered_map>
 
 #include <core/json.hpp>
 
@@ -39,8 +40,37 @@ namespace scene {
 
     using input_ref = std::reference_wrapper<input_instance>;
 
+    enum class input_trigger : uint8_t {
+        key_down,
+        key_up,
+        button_down,
+        button_up,
+        axis_motion
+    };
+
+    struct input_handler {
+        uint32_t        entity;
+        int32_t         fn_ref; // script class function
+        std::string     fn_name;
+        uint64_t        event; // action published to event bus under function name
+    };
+
+    // handlers keyed by trigger and key, button or axis code
+    struct input_dispatch_table {
+        std::unordered_map<uint64_t, std::vector<input_handler>> handlers;
+        uint64_t        generation = 0; // script classes generation handlers were resolved for
+        bool            dirty = true;
+    };
+
+    constexpr auto input_dispatch_key(const input_trigger trigger, const int32_t code) -> uint64_t {
+        return (static_cast<uint64_t>(trigger) << 32) | static_cast<uint32_t>(code);
+    }
+
     [[nodiscard]] auto create_input(const uint32_t entity, const json &info, const std::unordered_map<std::string, std::vector<input_action>> &sources) -> std::optional<input_instance>;
 
     auto create_input_source(scene::instance_t &s, const std::string &name, const std::vector<input_action> &actions) -> bool;
     auto process_input_events(scene::instance_t &s, const SDL_Event &e) -> void;
+
+    // set dirty when inputs are added or removed
+    auto build_input_dispatch(scene::instance_t &s) -> void;
 } // namespace scene
@@ -14,7 +14,12 @@ namespace scene {
         transforms.reserve(initial_transform);
         emitters.reserve(initial_emitter);
         lights.reserve(initial_light);
+        occluders.reserve(initial_occluder);
         input_sources.reserve(max_input_sources);
+
+        model_storage.reserve(initial_model);
+        material_storage.reserve(initial_material);
+        material_storage.emplace_back(); // default_material
     }
 
     auto instance_type::current_camera() -> instance_t::camera_t& {
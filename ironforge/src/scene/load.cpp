@@ -8,28 +8,10 @@
 #include <scene/instance.hpp>
 
 namespace scene {
-    auto load(assets::instance_t &asset, video::instance_t &vi, const std::string &path, const bool directly) -> load_result {
+    auto load_resources(assets::instance_t &asset, video::instance_t &vi, instance_t &sc, const json &j) -> void {
         using namespace std;
         using namespace game;
 
-        auto scene_contents = directly ? assets::get_text_absolute( asset, path ) : assets::get_text( asset, path );
-
-        if (!scene_contents)
-            return make_error_code(errc::load_scene);
-
-        journal::debug(journal::_SCENE, "Load scene %", path);
-
-        auto contents = scene_contents.value();
-
-        auto j = json::parse(contents);
-
-        instance_t sc;
-
-        const auto name = j.find("name") != j.end() ? j["name"].get<string>() : "unknown";
-        const auto version = j.find("version") != j.end() ? j["version"].get<string>() : "unknown";
-
-        journal::info(journal::_SCENE, "Create scene :\n\tname '%'\n\tversion: %", name, version);
-
         if (j.find("textures") != j.end()) {
             for (const auto &tex_info : j["textures"]) {
                 video::create_texture(asset, vi, tex_info);
@@ -89,10 +71,33 @@ namespace scene {
                         meshes.push_back(m.value());
                 }
 
+                vector<model_lod> lods;
+                if (md.find("lods") != md.end()) {
+                    lods.reserve(md["lods"].size());
+                    for (auto &ld : md["lods"]) {
+                        model_lod lod;
+                        lod.screen_size = ld.find("screen_size") != ld.end() ? ld["screen_size"].get<float>() : 0.f;
+
+                        if (ld.find("meshes") != ld.end())
+                            for (auto &msh : ld["meshes"]) {
+                                auto m = video::create_mesh(asset, vi, msh);
+                                if (m)
+                                    lod.meshes.push_back(m.value());
+                            }
+
+                        if (lod.meshes.empty()) {
+                            journal::warning(journal::_SCENE, "Model '%' lod not contain meshes", model_name);
+                            continue;
+                        }
+
+                        lods.push_back(lod);
+                    }
+                }
+
                 if (!meshes.empty()) {
-                    auto m = create_model(meshes);
+                    auto m = create_model(meshes, lods);
                     if (m)
-                        sc.all_models.emplace(model_name, m.value());
+                        cache_model(sc, model_name, m.value());
                 }
             }
         }
@@ -134,6 +139,51 @@ namespace scene {
             }
         }
 
+        if (j.find("prefabs") != j.end()) {
+            for (auto &pf : j["prefabs"]) {
+                auto p = create_prefab(asset, sc, pf);
+                if (!p)
+                    continue;
+
+                const auto prefab_name = p.value().name;
+                if (!sc.prefabs.emplace(prefab_name, std::move(p.value())).second)
+                    journal::info(journal::_SCENE, "Dublicate '%' prefab", prefab_name);
+            }
+        }
+    }
+
+    auto load(assets::instance_t &asset, video::instance_t &vi, const std::string &path, const bool directly) -> load_result {
+        using namespace std;
+        using namespace game;
+
+        auto scene_contents = directly ? assets::get_text_absolute( asset, path ) : assets::get_text( asset, path );
+
+        if (!scene_contents)
+            return make_error_code(errc::load_scene);
+
+        journal::debug(journal::_SCENE, "Load scene %", path);
+
+        auto contents = scene_contents.value();
+
+        auto j = json::parse(contents);
+
+        instance_t sc;
+
+        const auto name = j.find("name") != j.end() ? j["name"].get<string>() : "unknown";
+        const auto version = j.find("version") != j.end() ? j["version"].get<string>() : "unknown";
+
+        journal::info(journal::_SCENE, "Create scene :\n\tname '%'\n\tversion: %", name, version);
+
+        load_resources(asset, vi, sc, j);
+
+        if (j.find("streaming") != j.end()) {
+            if (auto ws = create_world_streaming(asset, j["streaming"]); ws)
+                sc.streaming = std::make_shared<world_streaming>(std::move(ws.value()));
+        }
+
+        sc.time_scale = j.find("time_scale") != j.end() ? j["time_scale"].get<float>() : 1.f;
+        sc.visible = j.find("visible") != j.end() ? j["visible"].get<bool>() : true;
+
         json root_info;
         root_info["name"] = "root";
 
@@ -1,3 +1,10 @@
+#include <cstring>
+#include <optional>
+#include <unordered_map>
+#include <vector>
+
+#include <glm/gtc/type_ptr.hpp>
+
 #include <core/journal.hpp>
 #include <core/game.hpp>
 #include <scene/scene.hpp>
@@ -8,9 +15,17 @@
 
 static scene::instance_t* g_instance;
 
+// applies scene write now or at sync point when script groups run in parallel
+template <typename Fn>
+static auto write_scene(Fn &&fn) -> void {
+    if (auto commands = scene::deferred_script_commands(); commands)
+        commands->push_back(std::forward<Fn>(fn));
+    else
+        fn(*g_instance);
+}
+
 static int
 set_entity_velocity(lua_State *L) {
-    using namespace game;
     using namespace glm;
 
     const auto e = static_cast<uint32_t>(luaL_checkinteger(L, 1));
@@ -19,56 +34,481 @@ set_entity_velocity(lua_State *L) {
     const float y = luaL_checknumber(L, 3);
     const float z = luaL_checknumber(L, 4);
 
-    journal::debug(journal::_SCENE, "% id=% x=% y=% z=%", __FUNCTION__, e, x, y, z);
+    if (g_instance->bodies.find(e) == g_instance->bodies.end())
+        return luaL_error(L, "entity %d has no body", e);
+
+    write_scene([e, velocity = vec3{x, y, z}] (scene::instance_t &sc) {
+        if (auto it = sc.bodies.find(e); it != sc.bodies.end())
+            it->second.current.velocity = velocity;
+    });
+
+    return 0;
+}
+
+static int
+get_entity_velocity(lua_State *L) {
+    const auto e = static_cast<uint32_t>(luaL_checkinteger(L, 1));
+
+    auto it = g_instance->bodies.find(e);
+    if (it == g_instance->bodies.end())
+        return luaL_error(L, "entity %d has no body", e);
+
+    const auto &velocity = it->second.current.velocity;
+
+    lua_pushnumber(L, velocity.x);
+    lua_pushnumber(L, velocity.y);
+    lua_pushnumber(L, velocity.z);
+
+    return 3;
+}
+
+// typed float array userdata, filled and consumed by batched component functions
+static const char float_array_meta[] = "scene.float_array";
+
+struct float_array {
+    uint32_t count;
+    uint32_t width;
+    uint32_t capacity; // in elements
+};
 
-    auto& body = g_instance->get_body(e);
-    body.current.velocity = vec3{x, y, z};
+static inline auto array_data(float_array *a) -> float* {
+    return reinterpret_cast<float*>(a + 1);
+}
+
+static auto new_array(lua_State *L, const uint32_t count, const uint32_t width) -> float_array* {
+    auto a = static_cast<float_array*>(lua_newuserdata(L, sizeof(float_array) + sizeof(float) * count * width));
+    a->count = count;
+    a->width = width;
+    a->capacity = count;
+
+    luaL_setmetatable(L, float_array_meta);
+
+    return a;
+}
+
+// reuses array at index when it fits, so per tick queries don't allocate
+static auto push_array(lua_State *L, const int index, const uint32_t count, const uint32_t width) -> float_array* {
+    auto a = static_cast<float_array*>(luaL_testudata(L, index, float_array_meta));
+    if (a && a->width == width && a->capacity >= count) {
+        a->count = count;
+        lua_pushvalue(L, index);
+        return a;
+    }
+
+    return new_array(L, count, width);
+}
+
+static inline auto check_entities(lua_State *L, const int index) -> uint32_t {
+    luaL_checktype(L, index, LUA_TTABLE);
+    return static_cast<uint32_t>(lua_rawlen(L, index));
+}
+
+static inline auto get_entity(lua_State *L, const int index, const uint32_t i) -> uint32_t {
+    lua_rawgeti(L, index, static_cast<int>(i + 1));
+    const auto e = static_cast<uint32_t>(lua_tointeger(L, -1));
+    lua_pop(L, 1);
+
+    return e;
+}
+
+template <typename Fn>
+static auto get_components(lua_State *L, const uint32_t width, Fn &&fn) -> int {
+    const auto count = check_entities(L, 1);
+    auto out = array_data(push_array(L, 2, count, width));
+
+    for (uint32_t i = 0; i < count; i++)
+        fn(get_entity(L, 1, i), out + i * width);
+
+    return 1;
+}
+
+// second argument is either array with at least as many elements as entities or x, y, z for all of them
+template <typename Fn>
+static auto set_components(lua_State *L, Fn &&fn) -> int {
+    using namespace glm;
 
-    /*auto &sc = game::current_scene();
-    auto body = sc->get_body(e);
+    const auto count = check_entities(L, 1);
 
-    body->current.velocity = glm::vec3{x, y, z};*/
+    const float *in = nullptr;
+    vec3 broadcast{0.f};
+
+    if (auto a = static_cast<float_array*>(luaL_testudata(L, 2, float_array_meta)); a) {
+        if (a->width != 3 || a->count < count)
+            return luaL_argerror(L, 2, "array too small");
+
+        in = array_data(a);
+    } else {
+        const float x = luaL_checknumber(L, 2);
+        const float y = luaL_checknumber(L, 3);
+        const float z = luaL_checknumber(L, 4);
+
+        broadcast = vec3{x, y, z};
+    }
+
+    const auto value = [in, broadcast] (const uint32_t i) {
+        return in ? vec3{in[i * 3], in[i * 3 + 1], in[i * 3 + 2]} : broadcast;
+    };
+
+    auto commands = scene::deferred_script_commands();
+    if (!commands) {
+        for (uint32_t i = 0; i < count; i++)
+            fn(*g_instance, get_entity(L, 1, i), value(i));
+
+        return 0;
+    }
+
+    // Lua array may change before sync point, so values are copied
+    std::vector<std::pair<uint32_t, vec3>> values;
+    values.reserve(count);
+    for (uint32_t i = 0; i < count; i++)
+        values.push_back({get_entity(L, 1, i), value(i)});
+
+    commands->push_back([values = std::move(values), fn] (scene::instance_t &sc) {
+        for (const auto &[e, v] : values)
+            fn(sc, e, v);
+    });
 
     return 0;
 }
 
+static inline auto write_vec3(float *out, const glm::vec3 &v) -> void {
+    out[0] = v.x;
+    out[1] = v.y;
+    out[2] = v.z;
+}
+
+// scene.get_positions(entities [, out]) -> array
 static int
-get_entity_velocity(lua_State *L) {
-    using namespace game;
+get_positions(lua_State *L) {
+    return get_components(L, 3, [] (const uint32_t e, float *out) {
+        auto it = g_instance->bodies.find(e);
+        write_vec3(out, it != g_instance->bodies.end() ? it->second.current.position : glm::vec3{0.f});
+    });
+}
 
-    const auto e = static_cast<uint32_t>(luaL_checkinteger(L, 1));
+// scene.get_velocities(entities [, out]) -> array
+static int
+get_velocities(lua_State *L) {
+    return get_components(L, 3, [] (const uint32_t e, float *out) {
+        auto it = g_instance->bodies.find(e);
+        write_vec3(out, it != g_instance->bodies.end() ? it->second.current.velocity : glm::vec3{0.f});
+    });
+}
+
+// scene.get_transforms(entities [, out]) -> array of column major 4x4 matrices
+static int
+get_transforms(lua_State *L) {
+    return get_components(L, 16, [] (const uint32_t e, float *out) {
+        auto it = g_instance->transforms.find(e);
+        const auto model = it != g_instance->transforms.end() ? it->second.model : glm::mat4{1.f};
+        memcpy(out, glm::value_ptr(model), sizeof(float) * 16);
+    });
+}
 
-    const auto body = g_instance->get_body(e);
+// scene.set_positions(entities, array | x, y, z)
+static int
+set_positions(lua_State *L) {
+    return set_components(L, [] (scene::instance_t &sc, const uint32_t e, const glm::vec3 &v) {
+        if (auto it = sc.bodies.find(e); it != sc.bodies.end())
+            it->second.current.position = v;
+    });
+}
+
+// scene.set_velocities(entities, array | x, y, z)
+static int
+set_velocities(lua_State *L) {
+    return set_components(L, [] (scene::instance_t &sc, const uint32_t e, const glm::vec3 &v) {
+        if (auto it = sc.bodies.find(e); it != sc.bodies.end())
+            it->second.current.velocity = v;
+    });
+}
 
-    const auto x = body.current.velocity.x;
-    const auto y = body.current.velocity.y;
-    const auto z = body.current.velocity.z;
+// scene.array(count [, width = 3]) -> array
+static int
+make_array(lua_State *L) {
+    const auto count = static_cast<uint32_t>(luaL_checkinteger(L, 1));
+    const auto width = static_cast<uint32_t>(luaL_optinteger(L, 2, 3));
 
-    journal::debug(journal::_SCENE, "% id=% x=% y=% z=%", __FUNCTION__, e, x, y, z);
+    if (width == 0)
+        return luaL_argerror(L, 2, "zero width");
 
-    lua_pushnumber(L, x);
-    lua_pushnumber(L, y);
-    lua_pushnumber(L, z);
+    auto a = new_array(L, count, width);
+    memset(array_data(a), 0, sizeof(float) * count * width);
 
-    /*auto &sc = game::current_scene();
-    auto body = sc->get_body(e);
+    return 1;
+}
 
-    const auto x = body->current.velocity.x;
-    const auto y = body->current.velocity.y;
-    const auto z = body->current.velocity.z;
+// array:get(i) -> width values
+static int
+array_get(lua_State *L) {
+    auto a = static_cast<float_array*>(luaL_checkudata(L, 1, float_array_meta));
+    const auto i = static_cast<uint32_t>(luaL_checkinteger(L, 2) - 1);
 
-    journal::debug(journal::_SCENE, "%1 id=%2 x=%3 y=%4 z=%5", __FUNCTION__, x, y, z);
+    if (i >= a->count)
+        return luaL_argerror(L, 2, "out of range");
 
-    lua_pushnumber(L, x);
-    lua_pushnumber(L, y);
-    lua_pushnumber(L, z);*/
+    const auto values = array_data(a) + i * a->width;
+    for (uint32_t j = 0; j < a->width; j++)
+        lua_pushnumber(L, values[j]);
 
-    return 3;
+    return static_cast<int>(a->width);
+}
+
+// array:set(i, ...)
+static int
+array_set(lua_State *L) {
+    auto a = static_cast<float_array*>(luaL_checkudata(L, 1, float_array_meta));
+    const auto i = static_cast<uint32_t>(luaL_checkinteger(L, 2) - 1);
+
+    if (i >= a->count)
+        return luaL_argerror(L, 2, "out of range");
+
+    auto values = array_data(a) + i * a->width;
+    for (uint32_t j = 0; j < a->width; j++)
+        values[j] = static_cast<float>(luaL_checknumber(L, static_cast<int>(j + 3)));
+
+    return 0;
+}
+
+static int
+array_len(lua_State *L) {
+    auto a = static_cast<float_array*>(luaL_checkudata(L, 1, float_array_meta));
+    lua_pushinteger(L, a->count);
+
+    return 1;
+}
+
+// scene.spawn_prefab(name, count [, x, y, z]) -> first entity, count
+// ids are taken now, from parallel script groups entities appear at sync point
+static int
+spawn_prefab(lua_State *L) {
+    using namespace glm;
+
+    const auto name = luaL_checkstring(L, 1);
+    const auto requested = luaL_checkinteger(L, 2);
+    luaL_argcheck(L, requested > 0 && requested <= scene::max_prefab_spawn, 2, "count out of range");
+
+    const auto count = static_cast<uint32_t>(requested);
+
+    const auto it = g_instance->prefabs.find(name);
+    if (it == g_instance->prefabs.end())
+        return luaL_error(L, "prefab '%s' not found", name);
+
+    std::optional<vec3> position;
+
+    if (lua_gettop(L) >= 5) {
+        const float x = luaL_checknumber(L, 3);
+        const float y = luaL_checknumber(L, 4);
+        const float z = luaL_checknumber(L, 5);
+
+        position = vec3{x, y, z};
+    }
+
+    const auto range = scene::reserve_entities(*g_instance, count);
+
+    write_scene([prefab_name = std::string{name}, range, position] (scene::instance_t &sc) {
+        const auto &prefab = sc.prefabs.at(prefab_name);
+
+        if (!position) {
+            scene::spawn_prefab(sc, prefab, range, {});
+            return;
+        }
+
+        auto state = prefab.body ? prefab.body.value().current : physics::body_state{};
+        state.position = position.value();
+
+        scene::spawn_prefab(sc, prefab, range, std::vector<physics::body_state>(range.count, state));
+    });
+
+    lua_pushinteger(L, range.first);
+    lua_pushinteger(L, range.count);
+
+    return 2;
+}
+
+// Lua handlers by subscription id, captured callbacks stay valid in copies of the bus
+static const char subscriptions_key[] = "scene.subscriptions";
+
+static auto push_subscriptions(lua_State *L) -> void {
+    lua_getfield(L, LUA_REGISTRYINDEX, subscriptions_key);
+    if (lua_type(L, -1) == LUA_TTABLE)
+        return;
+
+    lua_pop(L, 1);
+    lua_newtable(L);
+    lua_pushvalue(L, -1);
+    lua_setfield(L, LUA_REGISTRYINDEX, subscriptions_key);
+}
+
+static auto call_subscription(lua_State *L, const scene::subscription_id id, const scene::entity_event &ev) -> void {
+    const auto top = lua_gettop(L);
+
+    push_subscriptions(L);
+    lua_rawgeti(L, -1, static_cast<int>(id));
+
+    if (lua_type(L, -1) == LUA_TFUNCTION) {
+        lua_pushinteger(L, ev.entity);
+        lua_pushinteger(L, ev.sender);
+        for (const auto v : ev.values)
+            lua_pushnumber(L, v);
+
+        if (lua_pcall(L, 6, 0, 0) != 0)
+            game::journal::error(game::journal::_SCENE, "call event handler % : %", id, lua_tostring(L, -1));
+    }
+
+    lua_settop(L, top);
+}
+
+// scene.subscribe(event, entity | 0, fn(entity, sender, v1, v2, v3, v4)) -> id
+static int
+subscribe(lua_State *L) {
+    const auto type = scene::make_event_type(luaL_checkstring(L, 1));
+    const auto entity = static_cast<uint32_t>(luaL_checkinteger(L, 2));
+    luaL_checktype(L, 3, LUA_TFUNCTION);
+
+    const auto id = scene::reserve_subscription(g_instance->events);
+
+    push_subscriptions(L);
+    lua_pushvalue(L, 3);
+    lua_rawseti(L, -2, static_cast<int>(id));
+    lua_pop(L, 1);
+
+    write_scene([L, type, entity, id] (scene::instance_t &sc) {
+        scene::subscribe(sc.events, type, entity, [L, id] (scene::instance_t &, const scene::entity_event &ev) {
+            call_subscription(L, id, ev);
+        }, id);
+    });
+
+    lua_pushinteger(L, id);
+
+    return 1;
+}
+
+// scene.unsubscribe(id)
+static int
+unsubscribe(lua_State *L) {
+    const auto id = static_cast<scene::subscription_id>(luaL_checkinteger(L, 1));
+
+    push_subscriptions(L);
+    lua_pushnil(L);
+    lua_rawseti(L, -2, static_cast<int>(id));
+    lua_pop(L, 1);
+
+    write_scene([id] (scene::instance_t &sc) {
+        scene::unsubscribe(sc.events, id);
+    });
+
+    return 0;
+}
+
+// scene.publish(event, entity [, sender, v1, v2, v3, v4]) -> published
+static int
+publish(lua_State *L) {
+    scene::entity_event ev;
+    ev.type = scene::make_event_type(luaL_checkstring(L, 1));
+    ev.entity = static_cast<uint32_t>(luaL_checkinteger(L, 2));
+    ev.sender = static_cast<uint32_t>(luaL_optinteger(L, 3, 0));
+
+    for (int i = 0; i < 4; i++)
+        ev.values[i] = static_cast<float>(luaL_optnumber(L, i + 4, 0.0));
+
+    // ring buffer of calling thread, safe from parallel script groups
+    lua_pushboolean(L, scene::publish_event(g_instance->events, ev));
+
+    return 1;
+}
+
+// timers fire with systems, maybe concurrently with other scenes, so callback only publishes
+// event and Lua handler is called by dispatch_events as usual subscription
+static const auto timer_event = scene::make_event_type("timer");
+
+// scene.timer(seconds, fn(id, 0, elapsed) [, periodic]) -> id
+static int
+create_timer(lua_State *L) {
+    const auto seconds = static_cast<float>(luaL_checknumber(L, 1));
+    luaL_checktype(L, 2, LUA_TFUNCTION);
+    const auto periodic = lua_toboolean(L, 3) != 0;
+
+    luaL_argcheck(L, seconds > 0.f, 1, "interval must be positive");
+
+    const auto id = scene::reserve_subscription(g_instance->events);
+
+    push_subscriptions(L);
+    lua_pushvalue(L, 2);
+    lua_rawseti(L, -2, static_cast<int>(id));
+    lua_pop(L, 1);
+
+    write_scene([L, id, seconds, periodic] (scene::instance_t &sc) {
+        scene::subscribe(sc.events, timer_event, id, [L, id, periodic] (scene::instance_t &s, const scene::entity_event &ev) {
+            call_subscription(L, id, ev);
+
+            if (periodic)
+                return;
+
+            scene::unsubscribe(s.events, id);
+            s.script_timers.erase(id);
+
+            push_subscriptions(L);
+            lua_pushnil(L);
+            lua_rawseti(L, -2, static_cast<int>(id));
+            lua_pop(L, 1);
+        }, id);
+
+        const auto type = periodic ? scene::timer_type::periodic : scene::timer_type::once;
+        sc.script_timers[id] = scene::create_timer(sc.timers, {type, seconds, [id] (scene::instance_t &s, scene::timer_instance &t) {
+            scene::publish_event(s.events, timer_event, id, 0, t.value);
+        }});
+    });
+
+    lua_pushinteger(L, id);
+
+    return 1;
+}
+
+// scene.cancel_timer(id)
+static int
+cancel_timer(lua_State *L) {
+    const auto id = static_cast<scene::subscription_id>(luaL_checkinteger(L, 1));
+
+    push_subscriptions(L);
+    lua_pushnil(L);
+    lua_rawseti(L, -2, static_cast<int>(id));
+    lua_pop(L, 1);
+
+    write_scene([id] (scene::instance_t &sc) {
+        if (const auto it = sc.script_timers.find(id); it != sc.script_timers.end()) {
+            scene::delete_timer(sc.timers, it->second);
+            sc.script_timers.erase(it);
+        }
+
+        scene::unsubscribe(sc.events, id);
+    });
+
+    return 0;
 }
 
 static const struct luaL_Reg scene_functions[] = {
     {"get_entity_velocity", get_entity_velocity},
     {"set_entity_velocity", set_entity_velocity},
+    {"spawn_prefab", spawn_prefab},
+    {"get_positions", get_positions},
+    {"get_velocities", get_velocities},
+    {"get_transforms", get_transforms},
+    {"set_positions", set_positions},
+    {"set_velocities", set_velocities},
+    {"array", make_array},
+    {"subscribe", subscribe},
+    {"unsubscribe", unsubscribe},
+    {"publish", publish},
+    {"timer", create_timer},
+    {"cancel_timer", cancel_timer},
+    {NULL, NULL}
+};
+
+static const struct luaL_Reg float_array_functions[] = {
+    {"get", array_get},
+    {"set", array_set},
+    {"__len", array_len},
     {NULL, NULL}
 };
 
@@ -76,6 +516,12 @@ namespace bindings {
     auto init(scene::instance_t& sc, lua_State *L) -> int32_t {
         g_instance = &sc;
 
+        luaL_newmetatable(L, float_array_meta);
+        luaL_setfuncs(L, float_array_functions, 0);
+        lua_pushvalue(L, -1);
+        lua_setfield(L, -2, "__index");
+        lua_pop(L, 1);
+
         luaL_newlib(L, scene_functions);
         lua_setglobal(L, "scene");
 
@@ -85,4 +531,8 @@ namespace bindings {
 
         return 0;
     }
+
+    auto bind(scene::instance_t &sc) -> void {
+        g_instance = &sc;
+    }
 } // namespace bindings
@@ -5,4 +5,6 @@
 
 namespace bindings {
     auto init(scene::instance_t &sc, lua_State *L) -> int32_t;
+    // same functions for another scene, states stay as they are
+    auto bind(scene::instance_t &sc) -> void;
 } // namespace bindings
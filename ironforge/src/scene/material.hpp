@@ -25,9 +25,13 @@ namespace scene {
         renderer::phong::material m0; // TODO: array of materials?
         std::string name = {};
         uint64_t name_hash = 0;
+        uint32_t render_index = 0; // index in renderer material registry
     };
 
     using material_ref = std::reference_wrapper<material_instance>;
+    using material_handle = uint32_t; // index in scene material storage
+
+    constexpr material_handle default_material = 0;
 
     auto create_material(video::instance_t &vi, const json &info) -> std::optional<material_instance>;
 } // namespace scene
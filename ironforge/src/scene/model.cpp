@@ -58,16 +58,57 @@ namespace scene {
 //        return mi;
 //    }
 
-    auto create_model(const std::vector<video::mesh> &meshes) -> std::optional<model_instance> {
+    auto create_model(const std::vector<video::mesh> &meshes, const std::vector<model_lod> &lods) -> std::optional<model_instance> {
         if (meshes.empty())
             return {};
 
         model_instance model;
+        model.meshes.reserve(meshes.size());
+
+        model.aabb.min = meshes.front().bounds.min;
+        model.aabb.max = meshes.front().bounds.max;
 
         for (const auto &m : meshes) {
+            model.aabb.min = glm::min(model.aabb.min, m.bounds.min);
+            model.aabb.max = glm::max(model.aabb.max, m.bounds.max);
+
             model.meshes.push_back(m);
         }
 
+        // sphere around the merged box that still encloses every mesh sphere
+        model.sphere.center = (model.aabb.min + model.aabb.max) * 0.5f;
+        for (const auto &m : meshes)
+            model.sphere.radius = glm::max(model.sphere.radius, glm::distance(model.sphere.center, m.bounds.center) + m.bounds.radius);
+
+        for (const auto &l : lods)
+            if (!l.meshes.empty())
+                model.lods.push_back(l);
+
+        std::sort(model.lods.begin(), model.lods.end(), [] (const model_lod &a, const model_lod &b) {
+            return a.screen_size > b.screen_size;
+        });
+
         return model;
     }
+
+    auto select_model_lod(const model_instance &model, const float screen_size, const uint32_t current) -> uint32_t {
+        const auto levels = static_cast<uint32_t>(model.lods.size());
+        auto lod = std::min(current, levels);
+
+        // switch only after leaving the band around threshold, avoid popping on the edge
+        while (lod < levels && screen_size < model.lods[lod].screen_size * (1.f - lod_hysteresis))
+            lod++;
+
+        while (lod > 0 && screen_size > model.lods[lod - 1].screen_size * (1.f + lod_hysteresis))
+            lod--;
+
+        return lod;
+    }
+
+    auto get_lod_meshes(const model_instance &model, const uint32_t lod) -> const std::vector<video::mesh>& {
+        if (lod == 0 || model.lods.empty())
+            return model.meshes;
+
+        return model.lods[std::min<size_t>(lod, model.lods.size()) - 1].meshes;
+    }
 } // namespace scene
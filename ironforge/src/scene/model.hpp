@@ -15,15 +15,33 @@ namespace scene {
 //        bound_sphere visible_bound;
 //    };
 
+    constexpr float lod_hysteresis = 0.1f; // relative band around lod switch size
+
+    struct model_lod {
+        float                       screen_size = 0.f; // used while projected size below this, fraction of screen height
+        std::vector<video::mesh>    meshes;
+    };
+
     struct model_instance {
         bound_box                   aabb;
         bound_sphere                sphere;
 
-        std::vector<video::mesh>    meshes;
+        std::vector<video::mesh>    meshes; // full detail, lod 0
+        std::vector<model_lod>      lods;   // coarser levels, lod 1..n
+    };
+
+    using model_handle = uint32_t; // index in scene model storage
+
+    // per entity part, model itself is shared
+    struct model_component {
+        model_handle                handle = 0;
+        uint32_t                    current_lod = 0;
     };
 
     using model_ref = std::reference_wrapper<model_instance>;
 
     //auto create_model(const std::string &name, const std::vector<mesh_info> &meshes) -> model_instance;
-    auto create_model(const std::vector<video::mesh> &meshes) -> std::optional<model_instance>;
+    auto create_model(const std::vector<video::mesh> &meshes, const std::vector<model_lod> &lods = {}) -> std::optional<model_instance>;
+    auto select_model_lod(const model_instance &model, const float screen_size, const uint32_t current) -> uint32_t;
+    auto get_lod_meshes(const model_instance &model, const uint32_t lod) -> const std::vector<video::mesh>&;
 } // namespace scene
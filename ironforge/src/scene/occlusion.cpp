@@ -0,0 +1,320 @@
+#include <atomic>
+#include <limits>
+#include <cmath>
+#include <cstdlib>
+#include <algorithm>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#include <core/journal.hpp>
+#include <utility/thread_pool.hpp>
+#include <video/video.hpp>
+
+#include "model.hpp"
+#include "culling.hpp"
+#include "occlusion.hpp"
+
+namespace scene {
+    constexpr float occlusion_min_w = 1e-4f;
+    constexpr float occlusion_far = std::numeric_limits<float>::max();
+
+    auto make_box_occluder(const bound_box &box) -> occluder_instance {
+        occluder_instance occ;
+
+        occ.positions.reserve(8);
+        for (uint32_t i = 0; i < 8; i++)
+            occ.positions.emplace_back(i & 1 ? box.max.x : box.min.x, i & 2 ? box.max.y : box.min.y, i & 4 ? box.max.z : box.min.z);
+
+        occ.indices = {
+            0, 2, 1, 1, 2, 3, // -z
+            4, 5, 6, 5, 7, 6, // +z
+            0, 1, 4, 1, 5, 4, // -y
+            2, 6, 3, 3, 6, 7, // +y
+            0, 4, 2, 2, 4, 6, // -x
+            1, 3, 5, 3, 7, 5  // +x
+        };
+
+        return occ;
+    }
+
+    auto create_occluder(assets::instance_t &asset, const json &info) -> std::optional<occluder_instance> {
+        using namespace game;
+
+        // model bounds are larger than geometry and would hide what is visible through it
+        if (!info.is_object()) {
+            journal::warning(journal::_SCENE, "%", "Occluder requires mesh or box inside geometry");
+            return {};
+        }
+
+        if (info.find("box") != info.end()) {
+            const auto &box = info["box"];
+            if (box.find("min") == box.end() || box.find("max") == box.end()) {
+                journal::warning(journal::_SCENE, "%", "Box occluder requires min and max");
+                return {};
+            }
+
+            const bound_box b{box["min"].get<glm::vec3>(), box["max"].get<glm::vec3>()};
+            if (is_empty(b)) {
+                journal::warning(journal::_SCENE, "%", "Box occluder is empty");
+                return {};
+            }
+
+            return make_box_occluder(b);
+        }
+
+        auto vsi = video::create_vertices_info(asset, info);
+        if (!vsi) {
+            journal::warning(journal::_SCENE, "%", "Can't create occluder vertices");
+            return {};
+        }
+
+        occluder_instance occ;
+        const auto res = video::read_triangles(vsi.value().data, vsi.value().desc, occ.positions, occ.indices);
+
+        // occluder keeps its own copy, generated data not needed anymore
+        free(vsi.value().data.vertices);
+        free(vsi.value().data.indices);
+
+        if (!res || occ.indices.empty())
+            return {};
+
+        return occ;
+    }
+
+    static auto setup_triangle(const glm::vec4 &c0, const glm::vec4 &c1, const glm::vec4 &c2, occlusion_triangle &t) -> bool {
+        // near plane crossing triangles are skipped, it only makes occlusion weaker
+        if (c0.w < occlusion_min_w || c1.w < occlusion_min_w || c2.w < occlusion_min_w)
+            return false;
+
+        const auto to_screen = [] (const glm::vec4 &c) {
+            return glm::vec3{(c.x / c.w * 0.5f + 0.5f) * occlusion_width, (c.y / c.w * 0.5f + 0.5f) * occlusion_height, c.z / c.w};
+        };
+
+        auto v0 = to_screen(c0);
+        auto v1 = to_screen(c1);
+        auto v2 = to_screen(c2);
+
+        auto area = (v1.x - v0.x) * (v2.y - v0.y) - (v1.y - v0.y) * (v2.x - v0.x);
+        if (std::fabs(area) < 1e-6f)
+            return false;
+
+        // both sides are rasterized
+        if (area < 0.f) {
+            std::swap(v1, v2);
+            area = -area;
+        }
+
+        t.min_x = std::max(0, static_cast<int32_t>(std::floor(std::min({v0.x, v1.x, v2.x}))));
+        t.max_x = std::min(occlusion_width - 1, static_cast<int32_t>(std::ceil(std::max({v0.x, v1.x, v2.x}))));
+        t.min_y = std::max(0, static_cast<int32_t>(std::floor(std::min({v0.y, v1.y, v2.y}))));
+        t.max_y = std::min(occlusion_height - 1, static_cast<int32_t>(std::ceil(std::max({v0.y, v1.y, v2.y}))));
+
+        if (t.min_x > t.max_x || t.min_y > t.max_y)
+            return false;
+
+        const glm::vec3 *v[3] = {&v0, &v1, &v2};
+        for (int i = 0; i < 3; i++) {
+            const auto &p = *v[i];
+            const auto &q = *v[(i + 1) % 3];
+
+            t.a[i] = p.y - q.y;
+            t.b[i] = q.x - p.x;
+            t.c[i] = -(t.a[i] * p.x + t.b[i] * p.y);
+        }
+
+        // edge 1 -> 2 is barycentric weight of v0, 2 -> 0 of v1, 0 -> 1 of v2
+        const auto dz1 = (v1.z - v0.z) / area;
+        const auto dz2 = (v2.z - v0.z) / area;
+
+        t.za = t.a[2] * dz1 + t.a[0] * dz2;
+        t.zb = t.b[2] * dz1 + t.b[0] * dz2;
+        t.zc = v0.z + t.c[2] * dz1 + t.c[0] * dz2;
+
+        return true;
+    }
+
+    static auto rasterize_rows(occlusion_buffer &ob, const int32_t y_begin, const int32_t y_end) -> void {
+        for (const auto &t : ob.triangles) {
+            const auto y0 = std::max(t.min_y, y_begin);
+            const auto y1 = std::min(t.max_y, y_end - 1);
+            if (y0 > y1)
+                continue;
+
+            const auto x0 = t.min_x & ~3;
+
+            for (auto y = y0; y <= y1; y++) {
+                const auto py = static_cast<float>(y) + 0.5f;
+                auto row = ob.depth.data() + y * occlusion_width;
+
+#if defined(__SSE2__)
+                const auto zero = _mm_setzero_ps();
+                const auto e0_row = _mm_set1_ps(t.b[0] * py + t.c[0]);
+                const auto e1_row = _mm_set1_ps(t.b[1] * py + t.c[1]);
+                const auto e2_row = _mm_set1_ps(t.b[2] * py + t.c[2]);
+                const auto z_row = _mm_set1_ps(t.zb * py + t.zc);
+                const auto a0 = _mm_set1_ps(t.a[0]);
+                const auto a1 = _mm_set1_ps(t.a[1]);
+                const auto a2 = _mm_set1_ps(t.a[2]);
+                const auto za = _mm_set1_ps(t.za);
+
+                // width is multiple of four, pixels out of triangle bounds fail edge test
+                for (auto x = x0; x <= t.max_x; x += 4) {
+                    const auto fx = static_cast<float>(x) + 0.5f;
+                    const auto px = _mm_add_ps(_mm_set1_ps(fx), _mm_set_ps(3.f, 2.f, 1.f, 0.f));
+
+                    const auto e0 = _mm_add_ps(_mm_mul_ps(a0, px), e0_row);
+                    const auto e1 = _mm_add_ps(_mm_mul_ps(a1, px), e1_row);
+                    const auto e2 = _mm_add_ps(_mm_mul_ps(a2, px), e2_row);
+
+                    const auto inside = _mm_and_ps(_mm_and_ps(_mm_cmpge_ps(e0, zero), _mm_cmpge_ps(e1, zero)), _mm_cmpge_ps(e2, zero));
+                    if (_mm_movemask_ps(inside) == 0)
+                        continue;
+
+                    const auto z = _mm_add_ps(_mm_mul_ps(za, px), z_row);
+                    const auto d = _mm_loadu_ps(row + x);
+                    const auto nd = _mm_min_ps(d, z);
+
+                    _mm_storeu_ps(row + x, _mm_or_ps(_mm_and_ps(inside, nd), _mm_andnot_ps(inside, d)));
+                }
+#else
+                for (auto x = x0; x <= t.max_x; x++) {
+                    const auto px = static_cast<float>(x) + 0.5f;
+
+                    if (t.a[0] * px + t.b[0] * py + t.c[0] < 0.f ||
+                        t.a[1] * px + t.b[1] * py + t.c[1] < 0.f ||
+                        t.a[2] * px + t.b[2] * py + t.c[2] < 0.f)
+                        continue;
+
+                    row[x] = std::min(row[x], t.za * px + t.zb * py + t.zc);
+                }
+#endif
+            }
+        }
+    }
+
+    auto rasterize_occluders(occlusion_buffer &ob, const std::vector<occluder_draw> &occluders, const glm::mat4 &view_projection) -> void {
+        ob.depth.assign(static_cast<size_t>(occlusion_width * occlusion_height), occlusion_far);
+
+        ob.offsets.resize(occluders.size() + 1);
+        ob.offsets[0] = 0;
+        for (size_t i = 0; i < occluders.size(); i++)
+            ob.offsets[i + 1] = ob.offsets[i] + occluders[i].occluder->indices.size() / 3;
+
+        ob.triangles.resize(ob.offsets.back());
+
+        utils::parallel_for(utils::shared_pool(), occluders.size(), occlusion_chunk_size, [&] (const size_t begin, const size_t end) {
+            std::vector<glm::vec4> clip;
+
+            for (auto i = begin; i < end; i++) {
+                const auto &occ = *occluders[i].occluder;
+                const auto mvp = view_projection * occluders[i].transform;
+
+                clip.resize(occ.positions.size());
+                for (size_t k = 0; k < occ.positions.size(); k++)
+                    clip[k] = mvp * glm::vec4{occ.positions[k], 1.f};
+
+                auto out = ob.offsets[i];
+                for (size_t k = 0; k + 2 < occ.indices.size(); k += 3, out++) {
+                    auto &t = ob.triangles[out];
+
+                    if (!setup_triangle(clip[occ.indices[k]], clip[occ.indices[k + 1]], clip[occ.indices[k + 2]], t)) {
+                        t.min_x = 1;
+                        t.max_x = 0;
+                        t.min_y = 1;
+                        t.max_y = 0;
+                    }
+                }
+            }
+        });
+
+        // rejected triangles have empty bounds and never touch a row
+        constexpr auto tiles = static_cast<size_t>(occlusion_height / occlusion_tile_height);
+
+        utils::parallel_for(utils::shared_pool(), tiles, 1, [&ob] (const size_t begin, const size_t end) {
+            for (auto tile = begin; tile < end; tile++) {
+                const auto y = static_cast<int32_t>(tile) * occlusion_tile_height;
+                rasterize_rows(ob, y, y + occlusion_tile_height);
+            }
+        });
+    }
+
+    static auto is_occluded(const occlusion_buffer &ob, const bound_box &box, const glm::mat4 &mvp) -> bool {
+        auto min_x = std::numeric_limits<float>::max();
+        auto min_y = std::numeric_limits<float>::max();
+        auto max_x = std::numeric_limits<float>::lowest();
+        auto max_y = std::numeric_limits<float>::lowest();
+        auto min_z = std::numeric_limits<float>::max();
+
+        for (uint32_t i = 0; i < 8; i++) {
+            const auto c = mvp * glm::vec4{i & 1 ? box.max.x : box.min.x, i & 2 ? box.max.y : box.min.y, i & 4 ? box.max.z : box.min.z, 1.f};
+
+            // crossing near plane, treat as visible
+            if (c.w < occlusion_min_w)
+                return false;
+
+            const auto x = (c.x / c.w * 0.5f + 0.5f) * occlusion_width;
+            const auto y = (c.y / c.w * 0.5f + 0.5f) * occlusion_height;
+
+            min_x = std::min(min_x, x);
+            max_x = std::max(max_x, x);
+            min_y = std::min(min_y, y);
+            max_y = std::max(max_y, y);
+            min_z = std::min(min_z, c.z / c.w);
+        }
+
+        const auto x0 = std::max(0, static_cast<int32_t>(std::floor(min_x)));
+        const auto x1 = std::min(occlusion_width - 1, static_cast<int32_t>(std::ceil(max_x)));
+        const auto y0 = std::max(0, static_cast<int32_t>(std::floor(min_y)));
+        const auto y1 = std::min(occlusion_height - 1, static_cast<int32_t>(std::ceil(max_y)));
+
+        if (x0 > x1 || y0 > y1)
+            return false;
+
+        for (auto y = y0; y <= y1; y++) {
+            const auto row = ob.depth.data() + y * occlusion_width;
+            auto x = x0;
+
+#if defined(__SSE2__)
+            const auto z = _mm_set1_ps(min_z);
+            for (; x + 3 <= x1; x += 4)
+                if (_mm_movemask_ps(_mm_cmpge_ps(_mm_loadu_ps(row + x), z)) != 0)
+                    return false;
+#endif
+
+            for (; x <= x1; x++)
+                if (row[x] >= min_z)
+                    return false;
+        }
+
+        return true;
+    }
+
+    auto cull_occluded_candidates(const occlusion_buffer &ob, std::vector<render_candidate> &candidates, const glm::mat4 &view_projection) -> uint32_t {
+        if (ob.triangles.empty())
+            return 0;
+
+        std::atomic<uint32_t> occluded{0};
+
+        utils::parallel_for(utils::shared_pool(), candidates.size(), occlusion_chunk_size, [&] (const size_t begin, const size_t end) {
+            uint32_t chunk_occluded = 0;
+
+            for (auto i = begin; i < end; i++) {
+                auto &c = candidates[i];
+
+                if (!c.visible || !c.model || is_empty(c.model->aabb))
+                    continue;
+
+                if (is_occluded(ob, c.model->aabb, view_projection * c.transform)) {
+                    c.visible = false;
+                    chunk_occluded++;
+                }
+            }
+
+            occluded.fetch_add(chunk_occluded, std::memory_order_relaxed);
+        });
+
+        return occluded.load();
+    }
+} // namespace scene
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include <optional>
+#include <functional>
+
+#include <core/common.hpp>
+#include <core/math.hpp>
+#include <core/json.hpp>
+#include <scene/volume.hpp>
+
+namespace assets {
+    struct instance_type;
+    typedef instance_type instance_t;
+} // namespace assets
+
+namespace scene {
+    struct model_instance;
+    struct render_candidate;
+
+    constexpr int32_t occlusion_width = 256;
+    constexpr int32_t occlusion_height = 128;
+    constexpr int32_t occlusion_tile_height = 16; // rows per raster job
+    constexpr size_t occlusion_chunk_size = 64; // occluders or candidates per job
+
+    struct occluder_instance {
+        std::vector<glm::vec3>  positions;
+        std::vector<uint32_t>   indices;
+    };
+
+    using occluder_ref = std::reference_wrapper<occluder_instance>;
+
+    struct occluder_draw {
+        const occluder_instance *occluder = nullptr;
+        glm::mat4               transform = glm::mat4{1.f};
+    };
+
+    // screen space triangle, edge and depth equations in form a * x + b * y + c
+    struct occlusion_triangle {
+        int32_t     min_x, max_x;
+        int32_t     min_y, max_y;
+        float       a[3], b[3], c[3];
+        float       za, zb, zc;
+    };
+
+    struct occlusion_buffer {
+        std::vector<float>              depth;
+        std::vector<occlusion_triangle> triangles;
+        std::vector<size_t>             offsets;
+    };
+
+    ///
+    /// \brief Occluder from mesh description or authored box, both must lie inside geometry they stand for
+    ///
+    auto create_occluder(assets::instance_t &asset, const json &info) -> std::optional<occluder_instance>;
+    auto make_box_occluder(const bound_box &box) -> occluder_instance;
+
+    ///
+    /// \brief Clear and rasterize occluders into low resolution depth, rows are split between workers
+    ///
+    auto rasterize_occluders(occlusion_buffer &ob, const std::vector<occluder_draw> &occluders, const glm::mat4 &view_projection) -> void;
+
+    ///
+    /// \brief Test visible candidates bounds against occlusion depth
+    /// \return Number of occluded candidates
+    ///
+    auto cull_occluded_candidates(const occlusion_buffer &ob, std::vector<render_candidate> &candidates, const glm::mat4 &view_projection) -> uint32_t;
+} // namespace scene
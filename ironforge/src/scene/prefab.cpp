@@ -0,0 +1,137 @@
+#include <mutex>
+
+#include <core/journal.hpp>
+#include <scene/instance.hpp>
+#include <scene/scene.hpp>
+
+#include "prefab.hpp"
+
+namespace scene {
+    auto create_prefab(assets::instance_t &asset, instance_t &sc, const json &info) -> std::optional<prefab_instance> {
+        using namespace std;
+        using namespace game;
+
+        prefab_instance p;
+        p.name = info.find("name") != info.end() ? info["name"].get<string>() : string{};
+        p.renderable = info.find("renderable") != info.end() ? info["renderable"].get<bool>() : false;
+
+        if (p.name.empty()) {
+            journal::warning(journal::_SCENE, "%", "Prefab without name");
+            return {};
+        }
+
+        if (info.find("body") != info.end())
+            p.body = create_body(info["body"]);
+
+        if (info.find("model") != info.end()) {
+            p.model = get_model(sc, info["model"].get<string>());
+            if (!p.model)
+                journal::warning(journal::_SCENE, "Prefab '%' model '%' not found", p.name, info["model"].get<string>());
+        }
+
+        if (info.find("materials") != info.end() && info["materials"].size() != 0) {
+            p.material = get_material(sc, info["materials"][0].get<string>());
+            if (!p.material)
+                journal::warning(journal::_SCENE, "Prefab '%' material '%' not found", p.name, info["materials"][0].get<string>());
+        }
+
+        if (info.find("light") != info.end())
+            p.light = create_light(info["light"]);
+
+        // module is loaded once, spawned entities get a copy with own entity id
+        if (info.find("script") != info.end())
+            p.script = create_script(asset, 0, info["script"]);
+
+        if (info.find("camera") != info.end() || info.find("input") != info.end() || info.find("occluder") != info.end())
+            journal::warning(journal::_SCENE, "Prefab '%' cameras, inputs and occluders are not spawned", p.name);
+
+        journal::info(journal::_SCENE, "Create prefab '%'", p.name);
+
+        return p;
+    }
+
+    static std::mutex reserve_mutex;
+
+    auto reserve_entities(instance_t &sc, const uint32_t count) -> entity_range {
+        std::lock_guard<std::mutex> lock(reserve_mutex);
+
+        const entity_range range{sc.current_entity_id, count};
+        sc.current_entity_id += count;
+
+        return range;
+    }
+
+    static auto spawn(instance_t &sc, const prefab_instance &prefab, const entity_range &range, const uint32_t parent, const physics::body_state *states) -> entity_range {
+        using namespace game;
+
+        const auto count = range.count;
+
+        const auto has_body = prefab.body || states;
+
+        if (has_body)
+            sc.bodies.reserve(sc.bodies.size() + count);
+        if (prefab.renderable)
+            sc.transforms.reserve(sc.transforms.size() + count);
+        if (prefab.model)
+            sc.models.reserve(sc.models.size() + count);
+        if (prefab.material)
+            sc.materials.reserve(sc.materials.size() + count);
+        if (prefab.light)
+            sc.lights.reserve(sc.lights.size() + count);
+        if (prefab.script)
+            sc.scripts.reserve(sc.scripts.size() + count);
+
+        const auto body = prefab.body ? prefab.body.value() : body_instance{};
+
+        for (uint32_t i = 0; i < count; i++) {
+            const auto ix = range.first + i;
+
+            if (has_body) {
+                auto &b = sc.bodies.emplace(ix, body).first->second;
+                if (states)
+                    b.current = b.previous = b.state = states[i];
+            }
+
+            if (prefab.renderable)
+                sc.transforms.emplace(ix, transform_instance{ix, parent, glm::mat4{1.f}});
+
+            if (prefab.model)
+                sc.models.emplace(ix, model_component{prefab.model.value(), 0});
+
+            if (prefab.material)
+                sc.materials.emplace(ix, prefab.material.value());
+
+            if (prefab.light)
+                sc.lights.emplace(ix, prefab.light.value());
+
+            if (prefab.script)
+                sc.scripts.emplace(ix, prefab.script.value()).first->second.entity = ix;
+        }
+
+        journal::debug(journal::_SCENE, "Spawn % '%' from %", count, prefab.name, range.first);
+
+        return range;
+    }
+
+    auto spawn_prefab(instance_t &sc, const prefab_instance &prefab, const uint32_t count, const uint32_t parent) -> entity_range {
+        return spawn(sc, prefab, reserve_entities(sc, count), parent, nullptr);
+    }
+
+    auto spawn_prefab(instance_t &sc, const prefab_instance &prefab, const std::vector<physics::body_state> &states, const uint32_t parent) -> entity_range {
+        return spawn(sc, prefab, reserve_entities(sc, static_cast<uint32_t>(states.size())), parent, states.data());
+    }
+
+    auto spawn_prefab(instance_t &sc, const prefab_instance &prefab, const entity_range &range, const std::vector<physics::body_state> &states, const uint32_t parent) -> entity_range {
+        return spawn(sc, prefab, range, parent, states.size() == range.count ? states.data() : nullptr);
+    }
+
+    auto spawn_prefab(instance_t &sc, const std::string &name, const uint32_t count, const uint32_t parent) -> std::optional<entity_range> {
+        const auto it = sc.prefabs.find(name);
+        if (it == sc.prefabs.end()) {
+            game::journal::warning(game::journal::_SCENE, "Prefab '%' not found", name);
+            return {};
+        }
+
+        return spawn(sc, it->second, reserve_entities(sc, count), parent, nullptr);
+    }
+} // namespace scene
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <optional>
+
+#include <core/json.hpp>
+
+#include "model.hpp"
+#include "material.hpp"
+#include "physics.hpp"
+#include "light.hpp"
+#include "script.hpp"
+
+namespace assets {
+    struct instance_type;
+    typedef instance_type instance_t;
+} // namespace assets
+
+namespace scene {
+    struct instance_type;
+    typedef instance_type instance_t;
+
+    ///
+    /// \brief Entity template compiled once, meshes and materials are shared by handle
+    ///
+    struct prefab_instance {
+        std::string                         name;
+        bool                                renderable = false;
+        std::optional<model_handle>         model;
+        std::optional<material_handle>      material;
+        std::optional<body_instance>        body;
+        std::optional<light_instance>       light;
+        std::optional<script_instance>      script;
+    };
+
+    struct entity_range {
+        uint32_t    first = 0;
+        uint32_t    count = 0;
+    };
+
+    constexpr uint32_t max_prefab_spawn = 65536; // per call from scripts
+
+    ///
+    /// \brief Compile prefab from the same description as scene nodes, models and materials must be loaded
+    ///
+    auto create_prefab(assets::instance_t &asset, instance_t &sc, const json &info) -> std::optional<prefab_instance>;
+
+    ///
+    /// \brief Spawn count entities with consecutive ids, storage is reserved once for the whole batch
+    ///
+    auto spawn_prefab(instance_t &sc, const prefab_instance &prefab, const uint32_t count, const uint32_t parent = 0) -> entity_range;
+
+    ///
+    /// \brief Spawn one entity per body state, prefab body is overridden
+    ///
+    auto spawn_prefab(instance_t &sc, const prefab_instance &prefab, const std::vector<physics::body_state> &states, const uint32_t parent = 0) -> entity_range;
+
+    auto spawn_prefab(instance_t &sc, const std::string &name, const uint32_t count, const uint32_t parent = 0) -> std::optional<entity_range>;
+
+    // takes ids now for spawn done later, safe from parallel script groups
+    auto reserve_entities(instance_t &sc, const uint32_t count) -> entity_range;
+
+    ///
+    /// \brief Spawn into ids taken by reserve_entities, body states are optional
+    ///
+    auto spawn_prefab(instance_t &sc, const prefab_instance &prefab, const entity_range &range, const std::vector<physics::body_state> &states, const uint32_t parent = 0) -> entity_range;
+} // namespace scene
@@ -0,0 +1,299 @@
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <mutex>
+#include <unordered_map>
+
+#include <SDL2/SDL_rwops.h>
+#include <core/journal.hpp>
+#include <lua.hpp>
+
+#include "profiler.hpp"
+
+namespace scene {
+    using profile_clock = std::chrono::steady_clock;
+
+    static auto elapsed_ms(const profile_clock::time_point start) -> double {
+        return std::chrono::duration<double, std::milli>{profile_clock::now() - start}.count();
+    }
+
+    static std::atomic<bool> profiling{false};
+    static std::atomic<int> profiling_interval{default_profiler_interval};
+
+    // written from parallel script groups
+    static std::mutex profile_mutex;
+    static std::unordered_map<std::string, script_profile_entry> function_entries;
+    static std::unordered_map<uint32_t, entity_profile_entry> entity_entries;
+    static std::unordered_map<std::string, uint64_t> stack_samples;
+    static std::vector<lua_State*> profiled_states;
+    static script_profile totals;
+
+    static auto frame_name(lua_State *L, lua_Debug &ar) -> std::string {
+        lua_getinfo(L, "Sn", &ar);
+
+        char text[128];
+        if (ar.name)
+            snprintf(text, sizeof text, "%s@%s:%d", ar.name, ar.short_src, ar.linedefined);
+        else if (ar.what && ar.what[0] == 'm')
+            snprintf(text, sizeof text, "main@%s", ar.short_src);
+        else
+            snprintf(text, sizeof text, "?@%s:%d", ar.short_src, ar.linedefined);
+
+        return text;
+    }
+
+    static void
+    sample_hook(lua_State *L, lua_Debug *) {
+        std::string frames[max_profile_depth];
+        size_t depth = 0;
+
+        lua_Debug ar;
+        while (depth < max_profile_depth && lua_getstack(L, static_cast<int>(depth), &ar)) {
+            frames[depth] = frame_name(L, ar);
+            depth++;
+        }
+
+        if (depth == 0)
+            return;
+
+        std::string stack;
+        for (size_t i = depth; i > 0; i--) {
+            stack += frames[i - 1];
+            if (i > 1)
+                stack += ';';
+        }
+
+        std::lock_guard<std::mutex> lock{profile_mutex};
+        stack_samples[stack]++;
+        totals.samples++;
+    }
+
+    static auto set_hook(lua_State *L, const bool enable) -> void {
+        if (enable)
+            lua_sethook(L, sample_hook, LUA_MASKCOUNT, profiling_interval.load());
+        else
+            lua_sethook(L, nullptr, 0, 0);
+    }
+
+    auto enable_script_profiler(const bool enable, const int interval) -> void {
+        profiling_interval = std::max(interval, 1);
+        profiling = enable;
+
+        std::lock_guard<std::mutex> lock{profile_mutex};
+        for (auto L : profiled_states)
+            set_hook(L, enable);
+    }
+
+    auto script_profiler_enabled() -> bool {
+        return profiling.load(std::memory_order_relaxed);
+    }
+
+    auto reset_script_profile() -> void {
+        std::lock_guard<std::mutex> lock{profile_mutex};
+
+        function_entries.clear();
+        entity_entries.clear();
+        stack_samples.clear();
+        totals = {};
+    }
+
+    auto get_script_profile() -> script_profile {
+        std::lock_guard<std::mutex> lock{profile_mutex};
+
+        auto profile = totals;
+
+        profile.functions.reserve(function_entries.size());
+        for (const auto &[name, e] : function_entries)
+            profile.functions.push_back(e);
+
+        profile.entities.reserve(entity_entries.size());
+        for (const auto &[entity, e] : entity_entries)
+            profile.entities.push_back(e);
+
+        std::sort(profile.functions.begin(), profile.functions.end(), [] (const auto &a, const auto &b) {
+            return a.total_ms > b.total_ms;
+        });
+
+        std::sort(profile.entities.begin(), profile.entities.end(), [] (const auto &a, const auto &b) {
+            return a.total_ms > b.total_ms;
+        });
+
+        return profile;
+    }
+
+    auto get_script_profile_info() -> std::string {
+        const auto profile = get_script_profile();
+
+        char text[256];
+        auto n = snprintf(text, sizeof text, "Scripts %.3f ms\nScripts GC %.3f ms",
+                          profile.last_update_ms, profile.updates ? profile.gc_ms / profile.updates : 0.0);
+
+        // three most expensive functions, average per update
+        for (size_t i = 0; i < std::min<size_t>(profile.functions.size(), 3) && n > 0 && static_cast<size_t>(n) < sizeof text; i++) {
+            const auto &f = profile.functions[i];
+            n += snprintf(text + n, sizeof text - static_cast<size_t>(n), "\n%s %.3f ms", f.name.c_str(), profile.updates ? f.total_ms / profile.updates : f.total_ms);
+        }
+
+        return text;
+    }
+
+    auto dump_script_profile(const std::string &path) -> bool {
+        using namespace game;
+
+        std::string folded;
+        {
+            std::lock_guard<std::mutex> lock{profile_mutex};
+            for (const auto &[stack, count] : stack_samples) {
+                folded += stack;
+                folded += ' ';
+                folded += std::to_string(count);
+                folded += '\n';
+            }
+        }
+
+        auto f = SDL_RWFromFile(path.c_str(), "wb");
+        if (!f) {
+            journal::warning(journal::_SCENE, "Can't write profile '%'", path);
+            return false;
+        }
+
+        const auto written = SDL_RWwrite(f, folded.data(), 1, folded.size());
+        SDL_RWclose(f);
+
+        return written == folded.size();
+    }
+
+    // profiler.start([interval]), profiler.stop(), profiler.reset(), profiler.dump(path)
+    static int
+    profiler_start(lua_State *L) {
+        enable_script_profiler(true, static_cast<int>(luaL_optinteger(L, 1, default_profiler_interval)));
+
+        return 0;
+    }
+
+    static int
+    profiler_stop(lua_State *) {
+        enable_script_profiler(false);
+
+        return 0;
+    }
+
+    static int
+    profiler_reset(lua_State *) {
+        reset_script_profile();
+
+        return 0;
+    }
+
+    static int
+    profiler_dump(lua_State *L) {
+        lua_pushboolean(L, dump_script_profile(luaL_checkstring(L, 1)));
+
+        return 1;
+    }
+
+    // profiler.report() -> array of {name, calls, total_ms, max_ms}, most expensive first
+    static int
+    profiler_report(lua_State *L) {
+        const auto profile = get_script_profile();
+
+        lua_createtable(L, static_cast<int>(profile.functions.size()), 0);
+
+        for (size_t i = 0; i < profile.functions.size(); i++) {
+            const auto &f = profile.functions[i];
+
+            lua_createtable(L, 0, 4);
+            lua_pushstring(L, f.name.c_str());
+            lua_setfield(L, -2, "name");
+            lua_pushinteger(L, static_cast<lua_Integer>(f.calls));
+            lua_setfield(L, -2, "calls");
+            lua_pushnumber(L, f.total_ms);
+            lua_setfield(L, -2, "total_ms");
+            lua_pushnumber(L, f.max_ms);
+            lua_setfield(L, -2, "max_ms");
+
+            lua_rawseti(L, -2, static_cast<int>(i + 1));
+        }
+
+        return 1;
+    }
+
+    static const struct luaL_Reg profiler_functions[] = {
+        {"start", profiler_start},
+        {"stop", profiler_stop},
+        {"reset", profiler_reset},
+        {"dump", profiler_dump},
+        {"report", profiler_report},
+        {NULL, NULL}
+    };
+
+    auto register_profiled_state(lua_State *L) -> void {
+        luaL_newlib(L, profiler_functions);
+        lua_setglobal(L, "profiler");
+
+        std::lock_guard<std::mutex> lock{profile_mutex};
+        profiled_states.push_back(L);
+
+        if (profiling)
+            set_hook(L, true);
+    }
+
+    auto release_profiled_state(lua_State *L) -> void {
+        std::lock_guard<std::mutex> lock{profile_mutex};
+        profiled_states.erase(std::remove(profiled_states.begin(), profiled_states.end(), L), profiled_states.end());
+    }
+
+    profile_scope::profile_scope(const std::string &_table, const char *_fn, const uint32_t *_entities, const size_t _count)
+        : table{_table}, fn{_fn}, entities{_entities}, count{_count}, active{script_profiler_enabled()} {
+        if (active)
+            start = profile_clock::now();
+    }
+
+    profile_scope::~profile_scope() {
+        if (!active)
+            return;
+
+        const auto ms = elapsed_ms(start);
+
+        auto name = table;
+        name += '.';
+        name += fn;
+
+        std::lock_guard<std::mutex> lock{profile_mutex};
+
+        auto &f = function_entries[name];
+        if (f.name.empty())
+            f.name = std::move(name);
+        f.calls++;
+        f.total_ms += ms;
+        f.max_ms = std::max(f.max_ms, ms);
+
+        for (size_t i = 0; i < count; i++) {
+            auto &e = entity_entries[entities[i]];
+            e.entity = entities[i];
+            e.calls++;
+            e.total_ms += ms / static_cast<double>(count);
+        }
+    }
+
+    // collector runs incrementally inside calls too, explicit step gives comparable cost per update
+    auto profile_gc_step(lua_State *L) -> void {
+        if (!script_profiler_enabled())
+            return;
+
+        const auto start = profile_clock::now();
+        lua_gc(L, LUA_GCSTEP, 0);
+        const auto ms = elapsed_ms(start);
+
+        std::lock_guard<std::mutex> lock{profile_mutex};
+        totals.gc_steps++;
+        totals.gc_ms += ms;
+    }
+
+    auto profile_update(const double ms) -> void {
+        std::lock_guard<std::mutex> lock{profile_mutex};
+        totals.updates++;
+        totals.update_ms += ms;
+        totals.last_update_ms = ms;
+    }
+} // namespace scene
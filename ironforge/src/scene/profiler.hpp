@@ -0,0 +1,69 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+struct lua_State;
+
+namespace scene {
+    constexpr int default_profiler_interval = 1000; // VM instructions between samples
+    constexpr size_t max_profile_depth = 32;
+
+    struct script_profile_entry {
+        std::string name; // Class.function
+        uint64_t    calls = 0;
+        double      total_ms = 0.0;
+        double      max_ms = 0.0;
+    };
+
+    struct entity_profile_entry {
+        uint32_t    entity = 0;
+        uint64_t    calls = 0;
+        double      total_ms = 0.0;
+    };
+
+    struct script_profile {
+        std::vector<script_profile_entry>   functions; // most expensive first
+        std::vector<entity_profile_entry>   entities;  // most expensive first
+        uint64_t                            updates = 0;
+        double                              update_ms = 0.0; // total of all updates
+        double                              last_update_ms = 0.0;
+        uint64_t                            gc_steps = 0;
+        double                              gc_ms = 0.0;
+        uint64_t                            samples = 0;
+    };
+
+    auto enable_script_profiler(const bool enable, const int interval = default_profiler_interval) -> void;
+    auto script_profiler_enabled() -> bool;
+    auto reset_script_profile() -> void;
+    auto get_script_profile() -> script_profile;
+    auto get_script_profile_info() -> std::string; // short text for stats overlay
+
+    // folded stacks of hook samples, one "outer;inner count" line per stack
+    auto dump_script_profile(const std::string &path) -> bool;
+
+    // states are profiled from registration until release, registers profiler Lua library
+    auto register_profiled_state(lua_State *L) -> void;
+    auto release_profiled_state(lua_State *L) -> void;
+
+    // exact timing of one script call, time of batched call is split between its entities
+    struct profile_scope {
+        profile_scope(const std::string &table, const char *fn, const uint32_t *entities, const size_t count);
+        ~profile_scope();
+
+        profile_scope(profile_scope const&) = delete;
+        profile_scope& operator=(profile_scope const&) = delete;
+
+        const std::string                       &table;
+        const char                              *fn;
+        const uint32_t                          *entities;
+        size_t                                  count;
+        bool                                    active;
+        std::chrono::steady_clock::time_point   start;
+    };
+
+    auto profile_gc_step(lua_State *L) -> void;
+    auto profile_update(const double ms) -> void;
+} // namespace scene
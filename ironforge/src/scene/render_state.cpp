@@ -0,0 +1,107 @@
+#include <algorithm>
+
+#include <scene/instance.hpp>
+
+#include "render_state.hpp"
+
+namespace scene {
+    // entries are assigned in place, so vectors inside components keep their capacity
+    template <typename Map, typename Vector>
+    static auto gather(const Map &components, Vector &out) -> void {
+        out.resize(components.size());
+
+        size_t i = 0;
+        for (const auto &[ix, c] : components) {
+            out[i].first = ix;
+            out[i].second = c;
+            i++;
+        }
+    }
+
+    template <typename Vector, typename Map, typename Assign>
+    static auto scatter(const Vector &in, Map &components, Assign &&assign) -> void {
+        for (const auto &[ix, c] : in) {
+            auto [it, inserted] = components.try_emplace(ix, c);
+            if (!inserted)
+                assign(it->second, c);
+        }
+
+        // every published entity is present now, so extra ones were removed by simulation
+        if (components.size() == in.size())
+            return;
+
+        std::vector<uint32_t> keys(in.size());
+        std::transform(in.begin(), in.end(), keys.begin(), [] (const auto &p) {
+            return p.first;
+        });
+        std::sort(keys.begin(), keys.end());
+
+        for (auto it = components.begin(); it != components.end();)
+            it = std::binary_search(keys.begin(), keys.end(), it->first) ? std::next(it) : components.erase(it);
+    }
+
+    template <typename Vector, typename Map>
+    static auto scatter(const Vector &in, Map &components) -> void {
+        scatter(in, components, [] (auto &dst, const auto &src) {
+            dst = src;
+        });
+    }
+
+    auto publish_render_state(render_exchange &ex, const instance_t &sc, const uint64_t tick, const uint64_t time, const float accumulator) -> void {
+        auto &rs = ex.states[ex.write_index];
+
+        rs.tick = tick;
+        rs.time = time;
+        rs.accumulator = accumulator;
+        rs.current_camera_index = sc.current_camera_index;
+
+        gather(sc.bodies, rs.bodies);
+        gather(sc.transforms, rs.transforms);
+        gather(sc.cameras, rs.cameras);
+        gather(sc.lights, rs.lights);
+        gather(sc.models, rs.models);
+        gather(sc.materials, rs.materials);
+        gather(sc.emitters, rs.emitters);
+        gather(sc.occluders, rs.occluders);
+
+        ex.write_index = ex.middle.exchange(ex.write_index | render_exchange::fresh_bit, std::memory_order_acq_rel) & render_exchange::index_mask;
+    }
+
+    auto acquire_render_state(render_exchange &ex) -> const render_state& {
+        if (ex.middle.load(std::memory_order_relaxed) & render_exchange::fresh_bit)
+            ex.read_index = ex.middle.exchange(ex.read_index, std::memory_order_acq_rel) & render_exchange::index_mask;
+
+        return ex.states[ex.read_index];
+    }
+
+    auto apply_render_state(instance_t &sc, const render_state &rs) -> void {
+        sc.current_camera_index = rs.current_camera_index;
+
+        scatter(rs.bodies, sc.bodies);
+        scatter(rs.transforms, sc.transforms);
+        scatter(rs.cameras, sc.cameras);
+        scatter(rs.lights, sc.lights);
+        scatter(rs.materials, sc.materials);
+
+        // lod is chosen by render side
+        scatter(rs.models, sc.models, [] (model_component &dst, const model_component &src) {
+            dst.handle = src.handle;
+        });
+
+        // simulation doesn't run particles, keep ones already spawned
+        scatter(rs.emitters, sc.emitters, [] (emitter_instance &dst, const emitter_instance &src) {
+            auto particles = std::move(dst.particles);
+            const auto spawn_accumulator = dst.spawn_accumulator;
+            const auto seed = dst.seed;
+
+            dst = src;
+            dst.particles = std::move(particles);
+            dst.spawn_accumulator = spawn_accumulator;
+            dst.seed = seed;
+        });
+
+        // occluder geometry doesn't change after creation
+        scatter(rs.occluders, sc.occluders, [] (occluder_instance &, const occluder_instance &) {
+        });
+    }
+} // namespace scene
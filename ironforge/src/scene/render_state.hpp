@@ -0,0 +1,63 @@
+#pragma once
+
+#include <atomic>
+#include <vector>
+#include <cstdint>
+
+#include "physics.hpp"
+#include "transform.hpp"
+#include "camera.hpp"
+#include "light.hpp"
+#include "model.hpp"
+#include "material.hpp"
+#include "emitter.hpp"
+#include "occlusion.hpp"
+
+namespace scene {
+    struct instance_type;
+    typedef instance_type instance_t;
+
+    ///
+    /// \brief Render relevant part of scene published by simulation thread
+    ///
+    struct render_state {
+        uint64_t                                            tick = 0;
+        uint64_t                                            time = 0; // performance counter at publish
+        float                                               accumulator = 0.f; // not simulated time left at publish
+        uint32_t                                            current_camera_index = 0;
+        std::vector<std::pair<uint32_t, body_instance>>      bodies;
+        std::vector<std::pair<uint32_t, transform_instance>> transforms;
+        std::vector<std::pair<uint32_t, camera_instance>>    cameras;
+        std::vector<std::pair<uint32_t, light_instance>>     lights;
+        std::vector<std::pair<uint32_t, model_component>>    models;
+        std::vector<std::pair<uint32_t, material_handle>>    materials;
+        std::vector<std::pair<uint32_t, emitter_instance>>   emitters; // without particles, they live on render side
+        std::vector<std::pair<uint32_t, occluder_instance>>  occluders;
+    };
+
+    ///
+    /// \brief Lock free triple buffer, writer and reader always own one state each, third one is exchanged
+    ///
+    struct render_exchange {
+        static constexpr uint32_t index_mask = 3;
+        static constexpr uint32_t fresh_bit = 4;
+
+        render_state            states[3];
+        std::atomic<uint32_t>   middle{2};
+        uint32_t                write_index = 0;
+        uint32_t                read_index = 1;
+    };
+
+    auto publish_render_state(render_exchange &ex, const instance_t &sc, const uint64_t tick, const uint64_t time, const float accumulator) -> void;
+
+    ///
+    /// \brief Latest published state, the same state is returned until writer publishes a new one
+    ///
+    auto acquire_render_state(render_exchange &ex) -> const render_state&;
+
+    ///
+    /// \brief Copy state into render side scene, entities missing from state are removed,
+    /// render side parts (particles, lod, occluder geometry) are kept for existing ones
+    ///
+    auto apply_render_state(instance_t &sc, const render_state &rs) -> void;
+} // namespace scene
@@ -0,0 +1,264 @@
+#include <core/journal.hpp>
+#include <utility/thread_pool.hpp>
+#include <scene/instance.hpp>
+
+#include "rewind.hpp"
+
+namespace scene {
+    constexpr size_t body_state_floats = sizeof(physics::body_state) / sizeof(float);
+
+    static_assert(sizeof(physics::body_state) == body_state_floats * sizeof(float), "body_state must be packed floats");
+    static_assert(body_state_floats <= 16, "Field mask is 16 bit");
+
+    static auto write_varint(std::vector<uint8_t> &out, uint32_t value) -> void {
+        while (value >= 0x80) {
+            out.push_back(static_cast<uint8_t>(value | 0x80));
+            value >>= 7;
+        }
+
+        out.push_back(static_cast<uint8_t>(value));
+    }
+
+    static auto read_varint(const uint8_t *&ptr, const uint8_t *end, uint32_t &value) -> bool {
+        value = 0;
+
+        for (uint32_t shift = 0; shift < 35 && ptr < end; shift += 7) {
+            const auto b = *ptr++;
+            value |= static_cast<uint32_t>(b & 0x7f) << shift;
+
+            if (!(b & 0x80))
+                return true;
+        }
+
+        return false;
+    }
+
+    static auto to_bits(const physics::body_state &state, uint32_t (&bits)[body_state_floats]) -> void {
+        memcpy(bits, &state, sizeof state);
+    }
+
+    // nearby floats share sign, exponent and high mantissa, so xor keeps only low bits and varint stays short
+    static auto encode_tick(const rewind_capture &capture, const rewind_buffer::states_t &reference, std::vector<uint8_t> &out) -> void {
+        out.clear();
+        write_varint(out, static_cast<uint32_t>(capture.bodies.size()));
+
+        uint32_t prev[body_state_floats], curr[body_state_floats];
+
+        for (const auto &[entity, state] : capture.bodies) {
+            const auto it = reference.find(entity);
+            if (it != reference.end())
+                to_bits(it->second, prev);
+            else
+                memset(prev, 0, sizeof prev);
+
+            to_bits(state, curr);
+
+            uint16_t mask = 0;
+            for (size_t i = 0; i < body_state_floats; i++)
+                if (prev[i] != curr[i])
+                    mask |= static_cast<uint16_t>(1u << i);
+
+            write_varint(out, entity);
+            write_varint(out, mask);
+
+            for (size_t i = 0; i < body_state_floats; i++)
+                if (mask & (1u << i))
+                    write_varint(out, prev[i] ^ curr[i]);
+        }
+    }
+
+    static auto decode_tick(const rewind_frame &frame, rewind_buffer::states_t &states) -> bool {
+        auto ptr = frame.data.data();
+        const auto end = ptr + frame.data.size();
+
+        uint32_t num = 0;
+        if (!read_varint(ptr, end, num))
+            return false;
+
+        rewind_buffer::states_t next;
+        next.reserve(num);
+
+        uint32_t bits[body_state_floats];
+
+        for (uint32_t b = 0; b < num; b++) {
+            uint32_t entity = 0, mask = 0;
+            if (!read_varint(ptr, end, entity) || !read_varint(ptr, end, mask))
+                return false;
+
+            const auto it = frame.keyframe ? states.end() : states.find(entity);
+            if (it != states.end())
+                to_bits(it->second, bits);
+            else
+                memset(bits, 0, sizeof bits);
+
+            for (size_t i = 0; i < body_state_floats; i++)
+                if (mask & (1u << i)) {
+                    uint32_t x = 0;
+                    if (!read_varint(ptr, end, x))
+                        return false;
+                    bits[i] ^= x;
+                }
+
+            physics::body_state state;
+            memcpy(&state, bits, sizeof state);
+            next.emplace(entity, state);
+        }
+
+        states = std::move(next);
+
+        return true;
+    }
+
+    static auto encode_pending(rewind_buffer &rb) -> void {
+        std::unique_lock<std::mutex> lock(rb.mutex);
+
+        while (!rb.pending.empty()) {
+            auto capture = std::move(rb.pending.front());
+            rb.pending.erase(rb.pending.begin());
+
+            auto &frame = rb.frames[rb.head];
+            frame.tick = capture.tick;
+            frame.keyframe = rb.since_keyframe == 0;
+
+            if (frame.keyframe)
+                rb.encoded.clear();
+
+            // only encoder touches frames and reference state while it's running
+            lock.unlock();
+
+            encode_tick(capture, rb.encoded, frame.data);
+
+            rb.encoded.clear();
+            for (const auto &[entity, state] : capture.bodies)
+                rb.encoded.emplace(entity, state);
+
+            lock.lock();
+
+            rb.head = (rb.head + 1) % rb.frames.size();
+            rb.count = std::min(rb.count + 1, rb.frames.size());
+            rb.since_keyframe = (rb.since_keyframe + 1) % rb.keyframe_interval;
+
+            capture.bodies.clear();
+            rb.free_captures.push_back(std::move(capture));
+        }
+
+        rb.encoding = false;
+        rb.idle.notify_all();
+    }
+
+    rewind_buffer::rewind_buffer(const size_t capacity, const uint32_t interval) {
+        frames.resize(std::max<size_t>(capacity, 1));
+        keyframe_interval = std::max<uint32_t>(interval, 1);
+    }
+
+    rewind_buffer::~rewind_buffer() {
+        flush_rewind(*this);
+    }
+
+    auto record_tick(rewind_buffer &rb, const instance_t &sc, const uint64_t tick) -> void {
+        std::lock_guard<std::mutex> lock(rb.mutex);
+
+        rewind_capture capture;
+        if (!rb.free_captures.empty()) {
+            capture = std::move(rb.free_captures.back());
+            rb.free_captures.pop_back();
+        }
+
+        capture.tick = tick;
+        capture.bodies.reserve(sc.bodies.size());
+        for (const auto &[ix, b] : sc.bodies)
+            capture.bodies.emplace_back(ix, b.current);
+
+        rb.pending.push_back(std::move(capture));
+
+        if (!rb.encoding) {
+            rb.encoding = true;
+            utils::shared_pool().enqueue([&rb] {
+                encode_pending(rb);
+            });
+        }
+    }
+
+    auto flush_rewind(rewind_buffer &rb) -> void {
+        std::unique_lock<std::mutex> lock(rb.mutex);
+        rb.idle.wait(lock, [&rb] {
+            return !rb.encoding;
+        });
+    }
+
+    // index of the oldest keyframe still in the ring, older deltas can't be decoded
+    static auto oldest_keyframe(const rewind_buffer &rb) -> std::optional<size_t> {
+        const auto size = rb.frames.size();
+        const auto tail = (rb.head + size - rb.count) % size;
+
+        for (size_t i = 0; i < rb.count; i++) {
+            const auto ix = (tail + i) % size;
+            if (rb.frames[ix].keyframe)
+                return i;
+        }
+
+        return {};
+    }
+
+    auto available_rewind_ticks(rewind_buffer &rb) -> uint32_t {
+        flush_rewind(rb);
+
+        std::lock_guard<std::mutex> lock(rb.mutex);
+        const auto first = oldest_keyframe(rb);
+        if (!first)
+            return 0;
+
+        return static_cast<uint32_t>(rb.count - first.value() - 1);
+    }
+
+    auto rewind(rewind_buffer &rb, instance_t &sc, const uint32_t ticks) -> std::optional<uint64_t> {
+        using namespace game;
+
+        flush_rewind(rb);
+
+        std::lock_guard<std::mutex> lock(rb.mutex);
+
+        const auto first = oldest_keyframe(rb);
+        if (!first || ticks > rb.count - first.value() - 1) {
+            journal::warning(journal::_SCENE, "Can't rewind % ticks", ticks);
+            return {};
+        }
+
+        const auto size = rb.frames.size();
+        const auto tail = (rb.head + size - rb.count) % size;
+        const auto target = rb.count - 1 - ticks; // position from tail
+
+        // nearest keyframe not after target
+        auto start = target;
+        while (!rb.frames[(tail + start) % size].keyframe)
+            start--;
+
+        rewind_buffer::states_t states, previous;
+        for (auto i = start; i <= target; i++) {
+            previous = states;
+            if (!decode_tick(rb.frames[(tail + i) % size], states)) {
+                journal::error(journal::_SCENE, "%", "Corrupted rewind frame");
+                return {};
+            }
+        }
+
+        for (auto &[ix, b] : sc.bodies) {
+            const auto it = states.find(ix);
+            if (it == states.end())
+                continue;
+
+            b.current = it->second;
+
+            const auto prev_it = previous.find(ix);
+            b.previous = prev_it != previous.end() ? prev_it->second : it->second;
+        }
+
+        // drop rewound history, continue encoding from restored tick
+        rb.head = (tail + target + 1) % size;
+        rb.count = target + 1;
+        rb.since_keyframe = static_cast<uint32_t>((target - start + 1) % rb.keyframe_interval);
+        rb.encoded = std::move(states);
+
+        return rb.frames[(tail + target) % size].tick;
+    }
+} // namespace scene
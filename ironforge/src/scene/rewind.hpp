@@ -0,0 +1,70 @@
+#pragma once
+
+#include <vector>
+#include <mutex>
+#include <optional>
+#include <unordered_map>
+#include <condition_variable>
+
+#include "physics.hpp"
+
+namespace scene {
+    struct instance_type;
+    typedef instance_type instance_t;
+
+    constexpr size_t rewind_default_capacity = 2500; // 5 seconds of timesteps
+    constexpr uint32_t rewind_default_keyframe_interval = 250;
+
+    struct rewind_frame {
+        uint64_t                tick = 0;
+        bool                    keyframe = false;
+        std::vector<uint8_t>    data;
+    };
+
+    struct rewind_capture {
+        uint64_t                tick = 0;
+        std::vector<std::pair<uint32_t, physics::body_state>> bodies;
+    };
+
+    ///
+    /// \brief Ring of per tick body state deltas, bits of changed fields are xor'ed with previous tick
+    /// and encoded by a worker, simulation thread only copies bodies
+    ///
+    struct rewind_buffer {
+        using states_t = std::unordered_map<uint32_t, physics::body_state>;
+
+        explicit rewind_buffer(const size_t capacity = rewind_default_capacity, const uint32_t keyframe_interval = rewind_default_keyframe_interval);
+        ~rewind_buffer();
+
+        rewind_buffer(const rewind_buffer &) = delete;
+        rewind_buffer& operator=(const rewind_buffer &) = delete;
+
+        std::vector<rewind_frame>   frames;
+        size_t                      head = 0; // next frame to write
+        size_t                      count = 0;
+        uint32_t                    keyframe_interval = rewind_default_keyframe_interval;
+        uint32_t                    since_keyframe = 0;
+        states_t                    encoded; // state of last encoded tick
+
+        std::mutex                  mutex;
+        std::condition_variable     idle;
+        std::vector<rewind_capture> pending;
+        std::vector<rewind_capture> free_captures;
+        bool                        encoding = false;
+    };
+
+    auto record_tick(rewind_buffer &rb, const instance_t &sc, const uint64_t tick) -> void;
+
+    ///
+    /// \brief Wait until all recorded ticks are encoded
+    ///
+    auto flush_rewind(rewind_buffer &rb) -> void;
+
+    auto available_rewind_ticks(rewind_buffer &rb) -> uint32_t;
+
+    ///
+    /// \brief Restore bodies to the state recorded ticks before the last one, later history is dropped
+    /// \return Restored tick
+    ///
+    auto rewind(rewind_buffer &rb, instance_t &sc, const uint32_t ticks) -> std::optional<uint64_t>;
+} // namespace scene
@@ -1,4 +1,5 @@
 #include <algorithm>
+#include <chrono>
 #include <iterator>
 
 #include <core/common.hpp>
@@ -10,72 +11,237 @@
 #include <renderer/renderer.hpp>
 #include <video/debug.hpp>
 
+#include "profiler.hpp"
+
 namespace scene {
     auto cleanup_all(std::vector<instance_t> &scenes) -> void {
         for (auto &s : scenes) {
             physics::cleanup_all(s);
+            cleanup_all_timers(s.timers);
+            s.script_timers.clear();
+
+            if (s.streaming)
+                wait_streaming(*s.streaming);
         }
     }
 
     auto update(instance_t &sc, const float dt) -> void {
+        update_systems(sc, dt);
+        update_scripts(sc, dt);
+    }
+
+    auto update_systems(instance_t &sc, const float dt) -> void {
         physics::integrate_all(sc, dt);
+        update_all_timers(sc.timers, sc, dt);
+    }
+
+    auto update_scripts(instance_t &sc, const float dt) -> void {
+        bind_scripts(sc);
+
+        dispatch_events(sc, sc.events);
         update_all_scripts(sc, dt);
-        video::stats_update(dt);
+        dispatch_events(sc, sc.events);
     }
 
     auto process_event(instance_t &sc, const SDL_Event &ev) -> void {
+        bind_scripts(sc);
+
         process_input_events(sc, ev);
     }
 
-    auto present(video::instance_t &vi, instance_t &sc, std::unique_ptr<renderer::instance> &render, const float interpolation) -> void {
+    // lights, models and particles of one layer, seen by its own camera
+    static auto present_layer(instance_t &sc, const camera_instance &cam, std::unique_ptr<renderer::instance> &render) -> void {
         using namespace glm;
         using namespace game;
 
-        video::stats_clear();
-
-        interpolate_all(sc, interpolation);
-        scene::present_all_cameras(sc, vi.aspect_ratio);
-        render->append(sc.skybox, renderer::SKYBOX_TEXTURE_BIT);
         scene::present_all_lights(sc, render);
-        scene::present_all_transforms(sc, [&sc, &render] (uint32_t entity, const glm::mat4 &model) {
-            const auto &mdl = sc.models[entity];
 
-            for (const auto &msh : mdl.meshes) {
-                const auto &mt = sc.materials[entity];
+        // storage only grows, new materials are registered, reused slots are repacked
+        for (; sc.registered_materials < sc.material_storage.size(); sc.registered_materials++) {
+            auto &mt = sc.material_storage[sc.registered_materials];
+            mt.render_index = render->register_material(mt.m0);
+        }
+
+        // index 0 is renderer fallback for full registry, such slot tries to register again
+        for (const auto handle : sc.updated_materials) {
+            auto &mt = sc.material_storage[handle];
+            if (mt.render_index != 0)
+                render->update_material(mt.render_index, mt.m0);
+            else
+                mt.render_index = render->register_material(mt.m0);
+        }
 
-                render->append(mt.m0);
-                render->append(msh.source, msh.draw, model);
-            }
+        sc.updated_materials.clear();
+
+        sc.render_candidates.clear();
+        sc.occluder_draws.clear();
+        scene::present_all_transforms(sc, [&sc] (uint32_t entity, const glm::mat4 &model) {
+            if (auto it = sc.models.find(entity); it != sc.models.end())
+                sc.render_candidates.push_back({entity, &sc.model_storage[it->second.handle], &it->second, model, 0, true});
+
+            if (auto it = sc.occluders.find(entity); it != sc.occluders.end())
+                sc.occluder_draws.push_back({&it->second, model});
         });
 
+        const auto view_projection = cam.projection * cam.view;
+        video::stats_add_culled(cull_all_candidates(sc.render_candidates, make_frustum(view_projection)));
+
+        if (!sc.occluder_draws.empty()) {
+            rasterize_occluders(sc.occlusion, sc.occluder_draws, view_projection);
+            video::stats_add_occluded(cull_occluded_candidates(sc.occlusion, sc.render_candidates, view_projection));
+        }
+        select_all_lods(sc.render_candidates, cam.projection, cam.view);
+
+        for (const auto &c : sc.render_candidates) {
+            if (!c.visible)
+                continue;
+
+            video::stats_add_lod(c.lod);
+
+            const auto mt_it = sc.materials.find(c.entity);
+            const auto material = sc.material_storage[mt_it != sc.materials.end() ? mt_it->second : default_material].render_index;
+
+            for (const auto &msh : get_lod_meshes(*c.model, c.lod))
+                render->append(msh.source, msh.draw, c.transform, material);
+        }
+
+        // particles are visual only, so they are simulated here and work with render side scene copy too
+        const auto now = std::chrono::steady_clock::now();
+        if (sc.last_present != std::chrono::steady_clock::time_point{})
+            update_all_emitters(sc, std::chrono::duration<float>{now - sc.last_present}.count() * sc.time_scale);
+        sc.last_present = now;
+
+        present_all_emitters(sc, cam.projection, cam.view, render);
+
+        video::stats_add_particles_time(std::chrono::duration<float, std::milli>{std::chrono::steady_clock::now() - now}.count());
+    }
+
+    auto present(video::instance_t &vi, const std::vector<scene_layer> &layers, std::unique_ptr<renderer::instance> &render) -> void {
+        using namespace glm;
+        using namespace game;
+
+        if (layers.empty())
+            return;
+
+        video::stats_clear();
+
+        for (const auto &l : layers)
+            interpolate_all(*l.scene, l.interpolation);
+
+        for (const auto &l : layers)
+            scene::present_all_cameras(*l.scene, vi.aspect_ratio);
+
+        auto &main = *layers.front().scene;
+        render->append(main.skybox, renderer::SKYBOX_TEXTURE_BIT);
+
+        const auto &cam = main.current_camera();
+
+        // each layer is drawn over previous ones after depth clear
+        for (const auto &l : layers) {
+            const auto &layer_cam = l.scene->current_camera();
+
+            render->begin_layer(layer_cam.projection, layer_cam.view);
+            present_layer(*l.scene, layer_cam, render);
+        }
+
         video::stats::begin(vi.stats_info);
         video::debug_text(vi, render, -0.48f, 0.42f, vi.stats_info.info, 0x1a1a1aff);
         video::debug_text(vi, render, -0.48f, 0.24f, video::video_stats.info, 0x1a1a1aff);
 
-        render->present(vi, sc.current_camera().projection, sc.current_camera().view);
+        if (script_profiler_enabled())
+            video::debug_text(vi, render, -0.48f, 0.06f, get_script_profile_info(), 0x1a1a1aff);
+
+        render->present(vi, cam.projection, cam.view);
 
         video::stats::end(vi.stats_info);
     }
 
-    auto cache_model(instance_t &sc, const std::string &name, const model_instance &m) -> bool {
+    auto present(video::instance_t &vi, instance_t &sc, std::unique_ptr<renderer::instance> &render, const float interpolation) -> void {
+        present(vi, std::vector<scene_layer>{{&sc, interpolation}}, render);
+    }
+
+    auto cache_model(instance_t &sc, const std::string &name, const model_instance &m) -> std::optional<model_handle> {
         if (sc.all_models.find(name) != sc.all_models.end())
-            return false;
+            return {};
+
+        if (!sc.free_models.empty()) {
+            const auto handle = sc.free_models.back();
+            sc.free_models.pop_back();
 
-        sc.all_models.emplace(name, m);
+            sc.model_storage[handle] = m;
+            sc.all_models.emplace(name, handle);
+
+            return handle;
+        }
 
-        return true;
+        const auto handle = static_cast<model_handle>(sc.model_storage.size());
+        sc.model_storage.push_back(m);
+        sc.all_models.emplace(name, handle);
+
+        return handle;
     }
 
-    auto cache_material(instance_t &sc, const std::string &name, const material_instance &m) -> bool {
+    auto release_model(video::instance_t &vi, instance_t &sc, const std::string &name) -> void {
+        auto it = sc.all_models.find(name);
+        if (it == sc.all_models.end())
+            return;
+
+        auto &m = sc.model_storage[it->second];
+
+        for (auto &msh : m.meshes)
+            video::destroy_mesh(vi, msh);
+
+        for (auto &lod : m.lods)
+            for (auto &msh : lod.meshes)
+                video::destroy_mesh(vi, msh);
+
+        m = model_instance{};
+
+        sc.free_models.push_back(it->second);
+        sc.all_models.erase(it);
+    }
+
+    auto release_material(instance_t &sc, const std::string &name) -> void {
+        auto it = sc.all_materials.find(name);
+        if (it == sc.all_materials.end())
+            return;
+
+        if (it->second != default_material)
+            sc.free_materials.push_back(it->second);
+
+        sc.all_materials.erase(it);
+    }
+
+    auto cache_material(instance_t &sc, const std::string &name, const material_instance &m) -> std::optional<material_handle> {
         if (sc.all_materials.find(name) != sc.all_materials.end())
-            return false;
+            return {};
+
+        // renderer slot of reused material is repacked instead of registering new one
+        if (!sc.free_materials.empty()) {
+            const auto handle = sc.free_materials.back();
+            sc.free_materials.pop_back();
+
+            auto &mt = sc.material_storage[handle];
+            const auto render_index = mt.render_index;
+
+            mt = m;
+            mt.render_index = render_index;
+            sc.all_materials.emplace(name, handle);
+
+            if (handle < sc.registered_materials)
+                sc.updated_materials.push_back(handle);
+
+            return handle;
+        }
 
-        sc.all_materials.emplace(name, m);
+        const auto handle = static_cast<material_handle>(sc.material_storage.size());
+        sc.material_storage.push_back(m);
+        sc.all_materials.emplace(name, handle);
 
-        return true;
+        return handle;
     }
 
-    auto get_model(instance_t &sc, const std::string &name) -> std::optional<model_instance> {
+    auto get_model(const instance_t &sc, const std::string &name) -> std::optional<model_handle> {
         auto it = sc.all_models.find(name);
         if (it == sc.all_models.end())
             return {};
@@ -83,7 +249,7 @@ namespace scene {
         return (*it).second;
     }
 
-    auto get_material(instance_t &sc, const std::string &name) -> std::optional<material_instance> {
+    auto get_material(const instance_t &sc, const std::string &name) -> std::optional<material_handle> {
         if (auto it = sc.all_materials.find(name); it != sc.all_materials.end())
             return (*it).second;
 
@@ -1,13 +1,54 @@
+#include <cmath>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
 #include <core/journal.hpp>
 #include <core/assets.hpp>
 #include <scene/scene.hpp>
+#include <scene/instance.hpp>
+#include <utility/thread_pool.hpp>
 #include <lua.hpp>
 
 #include "script.hpp"
+#include "snapshot.hpp"
+#include "coroutine.hpp"
+#include "profiler.hpp"
 #include "lua_bindings.hpp"
 
 namespace scene {
-    static lua_State *lua_state;
+    // class tables and their _update resolved once to registry references
+    struct script_class {
+        std::string             name;
+        int                     table_ref = LUA_NOREF;
+        int                     update_ref = LUA_NOREF;
+        std::vector<uint32_t>   entities; // gathered every update
+        std::unordered_map<std::string, int> functions; // resolved on demand, LUA_NOREF when missing
+    };
+
+    // independent Lua state, updated by one task at a time
+    struct script_group {
+        script_group() = default;
+        script_group(script_group const&) = delete;
+        script_group& operator=(script_group const&) = delete;
+
+        ~script_group() {
+            if (state) {
+                release_profiled_state(state);
+                lua_close(state);
+            }
+        }
+
+        lua_State                                   *state = nullptr;
+        std::vector<script_class>                   classes;
+        std::unordered_map<std::string, uint32_t>   class_names;
+        std::vector<script_command>                 commands; // deferred scene writes
+    };
+
+    static std::vector<std::unique_ptr<script_group>> script_groups;
+    static uint64_t classes_generation = 0;
+    static instance_t *bound_instance = nullptr;
+    static thread_local std::vector<script_command> *deferred_commands = nullptr;
 
     static void
     lua_clear_stack(lua_State *L) {
@@ -15,42 +56,132 @@ namespace scene {
         lua_pop(L, n);
     }
 
-    inline void push() {
+    static auto create_group() -> bool {
+        using namespace game;
+
+        auto g = std::make_unique<script_group>();
+
+        if ((g->state = luaL_newstate()) == nullptr) {
+            journal::error(journal::_SCENE, "%", "Can't init LUA");
+
+            return false;
+        }
+
+        luaL_openlibs(g->state);
+        init_coroutines(g->state, static_cast<uint32_t>(script_groups.size()));
+        register_profiled_state(g->state);
+
+        if (bound_instance)
+            bindings::init(*bound_instance, g->state);
+
+        script_groups.push_back(std::move(g));
+
+        return true;
     }
 
-    inline void push(const int value) {
-        lua_pushinteger(lua_state, value);
+    static auto get_group(const uint32_t index) -> script_group* {
+        while (index >= script_groups.size() && index < max_script_groups)
+            if (!create_group())
+                return nullptr;
+
+        return index < script_groups.size() ? script_groups[index].get() : nullptr;
     }
 
-    inline void push(const double value) {
-        lua_pushnumber(lua_state, value);
+    // pushes class table of the script, falls back to global lookup for unresolved scripts
+    static auto push_class_table(const script_group &g, const script_instance *sc) -> bool {
+        auto L = g.state;
+
+        if (sc->class_index < g.classes.size())
+            lua_rawgeti(L, LUA_REGISTRYINDEX, g.classes[sc->class_index].table_ref);
+        else
+            lua_getglobal(L, sc->table.c_str());
+
+        if (lua_type(L, -1) != LUA_TTABLE) {
+            game::journal::error(game::journal::_SCENE, "% not found", sc->table.c_str());
+            lua_pop(L, 1);
+            return false;
+        }
+
+        return true;
     }
 
-    inline void push(const float value) {
-        lua_pushnumber(lua_state, value);
+    static auto resolve_class(script_group &g, const std::string &table) -> uint32_t {
+        auto L = g.state;
+
+        auto [it, inserted] = g.class_names.emplace(table, static_cast<uint32_t>(g.classes.size()));
+        if (inserted)
+            g.classes.emplace_back().name = table;
+
+        // module is executed again for every script, newest table wins as with global lookup
+        auto &cl = g.classes[it->second];
+        luaL_unref(L, LUA_REGISTRYINDEX, cl.table_ref);
+        luaL_unref(L, LUA_REGISTRYINDEX, cl.update_ref);
+
+        for (const auto &[fn, ref] : cl.functions)
+            luaL_unref(L, LUA_REGISTRYINDEX, ref);
+
+        cl.functions.clear();
+        classes_generation++;
+
+        lua_getglobal(L, table.c_str());
+        lua_getfield(L, -1, "_update");
+
+        if (lua_type(L, -1) == LUA_TFUNCTION)
+            cl.update_ref = luaL_ref(L, LUA_REGISTRYINDEX);
+        else {
+            cl.update_ref = LUA_NOREF;
+            lua_pop(L, 1);
+        }
+
+        cl.table_ref = luaL_ref(L, LUA_REGISTRYINDEX);
+
+        return it->second;
+    }
+
+    // state which defines class table, snapshots address scripts by table name only
+    static auto find_class_state(const std::string &table) -> lua_State* {
+        for (const auto &g : script_groups)
+            if (g->class_names.find(table) != g->class_names.end())
+                return g->state;
+
+        return script_groups.empty() ? nullptr : script_groups.front()->state;
+    }
+
+    inline void push(lua_State *) {
+    }
+
+    inline void push(lua_State *L, const int value) {
+        lua_pushinteger(L, value);
+    }
+
+    inline void push(lua_State *L, const double value) {
+        lua_pushnumber(L, value);
+    }
+
+    inline void push(lua_State *L, const float value) {
+        lua_pushnumber(L, value);
     }
 
     template <typename T, typename... Ts>
-    inline void push(const T&& value, const Ts&&... values) {
-        push(value);
-        push(values...);
+    inline void push(lua_State *L, const T&& value, const Ts&&... values) {
+        push(L, value);
+        push(L, values...);
     }
 
     template<typename Arg, typename... Args>
     auto call_with_args(const script_instance *sc, const char *fn_name,  Arg&& arg, Args&&... args) -> int32_t {
         const int num_args = sizeof...(Args);
 
-        lua_State *L = lua_state;
-
-        if (!L)
+        if (sc->group >= script_groups.size())
             return -1;
 
-        lua_getglobal(L, sc->table.c_str());
+        const auto &g = *script_groups[sc->group];
+        lua_State *L = g.state;
 
-        if (lua_type(L, -1) != LUA_TTABLE) {
-            game::journal::error(game::journal::_SCENE, "% not found", sc->table.c_str());
+        const auto top = lua_gettop(L);
+
+        if (!push_class_table(g, sc))
             return -1;
-        }
 
         lua_getfield(L, -1, fn_name);
 
@@ -58,15 +189,18 @@ namespace scene {
             lua_pushvalue(L, -2);
             lua_pushinteger(L, sc->entity);
 
-            push(arg, std::forward<Args>(args)...);
+            push(L, arg, std::forward<Args>(args)...);
+
+            profile_scope scope{sc->table, fn_name, &sc->entity, 1};
 
             if (lua_pcall(L, num_args + 3, 0, 0) != 0) {
-                game::journal::error(game::journal::_SCENE, "call function '%' : %", "_init", lua_tostring(L, -1));
+                game::journal::error(game::journal::_SCENE, "call function '%' : %", fn_name, lua_tostring(L, -1));
+                lua_settop(L, top);
                 return -1;
             }
         }
 
-        lua_clear_stack(L);
+        lua_settop(L, top);
 
         return 0;
     }
@@ -74,10 +208,11 @@ namespace scene {
     auto call_fn(const script_instance *sc, const char *fn_name) -> int32_t {
         using namespace game;
 
-        if (!sc)
+        if (!sc || sc->group >= script_groups.size())
             return -1;
 
-        lua_State *L = lua_state;
+        const auto &g = *script_groups[sc->group];
+        lua_State *L = g.state;
 
         if (sc->table.empty()) {
             journal::error(journal::_SCENE, "%", "No class name");
@@ -85,12 +220,10 @@ namespace scene {
             return -1;
         }
 
-        lua_getglobal(L, sc->table.c_str());
+        const auto top = lua_gettop(L);
 
-        if (lua_type(L, -1) != LUA_TTABLE) {
-            journal::error(journal::_SCENE, "% not found", sc->table.c_str());
+        if (!push_class_table(g, sc))
             return -1;
-        }
 
         lua_getfield(L, -1, fn_name);
 
@@ -98,34 +231,109 @@ namespace scene {
             lua_pushvalue(L, -2);
             lua_pushinteger(L, sc->entity);
 
+            profile_scope scope{sc->table, fn_name, &sc->entity, 1};
+
             if (lua_pcall(L, 2, 0, 0) != 0) {
-                journal::error(journal::_SCENE, "call function '%' : %", "_init", lua_tostring(L, -1));
+                journal::error(journal::_SCENE, "call function '%' : %", fn_name, lua_tostring(L, -1));
+                lua_settop(L, top);
                 return -1;
             }
         }
 
+        lua_settop(L, top);
+
         return 0;
     }
 
-    auto reset_scripts_engine() -> bool {
-        using namespace game;
+    auto resolve_script_fn(const script_instance &sc, const std::string &fn_name) -> int32_t {
+        if (sc.group >= script_groups.size() || sc.class_index >= script_groups[sc.group]->classes.size())
+            return invalid_script_ref;
 
-        if (lua_state)
-            lua_close(lua_state);
+        auto L = script_groups[sc.group]->state;
+        auto &cl = script_groups[sc.group]->classes[sc.class_index];
 
-        if ((lua_state = luaL_newstate()) == nullptr) {
-            journal::error(journal::_SCENE, "%", "Can't init LUA");
+        if (auto it = cl.functions.find(fn_name); it != cl.functions.end())
+            return it->second;
 
-            return false;
+        lua_rawgeti(L, LUA_REGISTRYINDEX, cl.table_ref);
+        lua_getfield(L, -1, fn_name.c_str());
+
+        auto ref = LUA_NOREF;
+        if (lua_type(L, -1) == LUA_TFUNCTION)
+            ref = luaL_ref(L, LUA_REGISTRYINDEX);
+        else
+            lua_pop(L, 1);
+
+        lua_pop(L, 1);
+
+        cl.functions.emplace(fn_name, ref);
+
+        return ref;
+    }
+
+    auto script_classes_generation() -> uint64_t {
+        return classes_generation;
+    }
+
+    template <typename... Args>
+    static auto call_resolved(const script_instance &sc, const int32_t fn_ref, const char *fn_name, Args&&... args) -> int32_t {
+        if (fn_ref == invalid_script_ref || sc.group >= script_groups.size() || sc.class_index >= script_groups[sc.group]->classes.size())
+            return -1;
+
+        auto L = script_groups[sc.group]->state;
+        const auto top = lua_gettop(L);
+
+        lua_rawgeti(L, LUA_REGISTRYINDEX, fn_ref);
+        lua_rawgeti(L, LUA_REGISTRYINDEX, script_groups[sc.group]->classes[sc.class_index].table_ref);
+        lua_pushinteger(L, sc.entity);
+
+        push(L, std::forward<Args>(args)...);
+
+        profile_scope scope{sc.table, fn_name, &sc.entity, 1};
+
+        if (lua_pcall(L, static_cast<int>(sizeof...(Args)) + 2, 0, 0) != 0) {
+            game::journal::error(game::journal::_SCENE, "call function '%' : %", fn_name, lua_tostring(L, -1));
+            lua_settop(L, top);
+            return -1;
         }
 
-        luaL_openlibs(lua_state);
+        lua_settop(L, top);
 
-        return true;
+        return 0;
+    }
+
+    auto call_script_fn(const script_instance &sc, const int32_t fn_ref, const char *fn_name) -> int32_t {
+        return call_resolved(sc, fn_ref, fn_name);
+    }
+
+    auto call_script_fn(const script_instance &sc, const int32_t fn_ref, const char *fn_name, const float arg) -> int32_t {
+        return call_resolved(sc, fn_ref, fn_name, arg);
+    }
+
+    auto reset_scripts_engine() -> bool {
+        script_groups.clear();
+        classes_generation++;
+
+        return create_group();
     }
 
     auto setup_bindings(instance_t &sc) -> void {
-        bindings::init(sc, lua_state);
+        bound_instance = &sc;
+
+        for (auto &g : script_groups)
+            bindings::init(sc, g->state);
+    }
+
+    auto bind_scripts(instance_t &sc) -> void {
+        if (bound_instance == &sc)
+            return;
+
+        bound_instance = &sc;
+        bindings::bind(sc);
+    }
+
+    auto deferred_script_commands() -> std::vector<script_command>* {
+        return deferred_commands;
     }
 
     auto create_script(assets::instance_t &asset, const uint32_t entity, const json &info) -> std::optional<script_instance> {
@@ -135,22 +343,25 @@ namespace scene {
         const auto name = info["name"].get<string>();
         const auto source = name;
         const auto class_name = info["class"].get<string>();
+        const auto group = info.find("group") != info.end() ? info["group"].get<uint32_t>() : 0u;
 
         journal::debug(journal::_SCENE, "Create script %", name);
 
         auto text_data = assets::get_text(asset, name);
 
-        auto L = lua_state;
+        auto g = get_group(group);
 
-        if (!L) {
-            journal::critical(journal::_SCENE, "%", "Lua VM not accessable");
+        if (!g) {
+            journal::critical(journal::_SCENE, "Lua VM for group % not accessable", group);
 
             return {};
         }
 
+        auto L = g->state;
+
         if (!text_data || luaL_dostring(L, text_data.value().c_str())) {
             journal::error(journal::_SCENE, "% %", "Could not load module", name);
-            lua_close(L);
+            lua_clear_stack(L);
 
             return {};
         }
@@ -162,7 +373,7 @@ namespace scene {
 
         if (luaL_dostring(L, text)) {
             journal::error(journal::_SCENE, "%s", "Could set module");
-            lua_close(L);
+            lua_clear_stack(L);
 
             return {};
         }
@@ -174,16 +385,526 @@ namespace scene {
         si.name = name;
         si.source = source;
         si.table = class_name;
+        si.group = group;
+        si.class_index = resolve_class(*g, class_name);
 
         return si;
     }
 
+    auto find_script_class(const uint32_t group, const std::string &table) -> uint32_t {
+        if (group >= script_groups.size())
+            return invalid_script_class;
+
+        const auto &names = script_groups[group]->class_names;
+        const auto it = names.find(table);
+
+        return it != names.end() ? it->second : invalid_script_class;
+    }
+
+    static auto update_group(script_group &g, coroutine_scheduler &cs, const float dt) -> void {
+        using namespace game;
+
+        lua_State *L = g.state;
+        const auto top = lua_gettop(L);
+
+        for (const auto &cl : g.classes) {
+            if (cl.entities.empty())
+                continue;
+
+            lua_rawgeti(L, LUA_REGISTRYINDEX, cl.update_ref);
+            lua_rawgeti(L, LUA_REGISTRYINDEX, cl.table_ref);
+
+            lua_createtable(L, static_cast<int>(cl.entities.size()), 0);
+            for (size_t i = 0; i < cl.entities.size(); i++) {
+                lua_pushinteger(L, cl.entities[i]);
+                lua_rawseti(L, -2, static_cast<int>(i + 1));
+            }
+
+            lua_pushnumber(L, dt);
+
+            {
+                profile_scope scope{cl.name, "_update", cl.entities.data(), cl.entities.size()};
+
+                if (lua_pcall(L, 3, 0, 0) != 0)
+                    journal::error(journal::_SCENE, "call function '%' : %", "_update", lua_tostring(L, -1));
+            }
+
+            lua_settop(L, top);
+        }
+
+        resume_coroutines(L, cs, dt);
+        profile_gc_step(L);
+    }
+
+    static auto update_groups(instance_t &sc, const float dt) -> void {
+        // groups don't share Lua state, scene writes wait for sync point below
+        utils::parallel_for(utils::shared_pool(), script_groups.size(), 1, [&sc, dt] (const size_t begin, const size_t end) {
+            for (size_t i = begin; i < end; i++) {
+                deferred_commands = &script_groups[i]->commands;
+                update_group(*script_groups[i], sc.coroutines[i], dt);
+                deferred_commands = nullptr;
+            }
+        });
+
+        for (auto &g : script_groups) {
+            for (auto &c : g->commands)
+                c(sc);
+
+            g->commands.clear();
+        }
+    }
+
     auto update_all_scripts(instance_t &sc, const float dt) -> void {
+        const auto profiling = script_profiler_enabled();
+        const auto start = std::chrono::steady_clock::now();
+
+        for (auto &g : script_groups)
+            for (auto &cl : g->classes)
+                cl.entities.clear();
+
         for (const auto &[ix, s] : sc.scripts) {
             (void)ix;
-            if (s.flags & static_cast<uint32_t>(script_flags::call_update))
-                call_with_args(&s, "_update", dt);
+            if (s.group >= script_groups.size())
+                continue;
+
+            auto &classes = script_groups[s.group]->classes;
+            if (s.class_index < classes.size() && classes[s.class_index].update_ref != LUA_NOREF)
+                classes[s.class_index].entities.push_back(s.entity);
+        }
+
+        // sized here, parallel groups must not grow it
+        if (sc.coroutines.size() < script_groups.size())
+            sc.coroutines.resize(script_groups.size());
+
+        if (script_groups.size() == 1)
+            update_group(*script_groups.front(), sc.coroutines.front(), dt);
+        else
+            update_groups(sc, dt);
+
+        if (profiling)
+            profile_update(std::chrono::duration<double, std::milli>{std::chrono::steady_clock::now() - start}.count());
+    }
+
+    auto signal_script_event(const std::string &event) -> void {
+        if (!bound_instance)
+            return;
+
+        for (auto &cs : bound_instance->coroutines)
+            signal_coroutines(cs, event);
+    }
+
+    auto bound_coroutines(const uint32_t group) -> coroutine_scheduler* {
+        if (!bound_instance || group >= script_groups.size())
+            return nullptr;
+
+        if (bound_instance->coroutines.size() < script_groups.size())
+            bound_instance->coroutines.resize(script_groups.size());
+
+        return &bound_instance->coroutines[group];
+    }
+
+    enum class state_value : uint8_t {
+        end,
+        number,
+        boolean,
+        string,
+        table,
+        integer,
+        mixed, // table with functions or other unsaved fields, merged into live table on restore
+        reference // table written before, by order of first appearance, class table is 0
+    };
+
+    constexpr int max_state_depth = 32;
+
+    using state_ids = std::unordered_map<const void*, uint32_t>;
+
+    static auto is_data_type(const int type) -> bool {
+        return type == LUA_TNUMBER || type == LUA_TBOOLEAN || type == LUA_TSTRING || type == LUA_TTABLE;
+    }
+
+    static auto is_state_value(lua_State *L, const int index, const int depth, const state_ids &ids) -> bool {
+        const auto type = lua_type(L, index);
+        if (type != LUA_TTABLE)
+            return type == LUA_TNUMBER || type == LUA_TBOOLEAN || type == LUA_TSTRING;
+
+        return depth < max_state_depth || ids.find(lua_topointer(L, index)) != ids.end();
+    }
+
+    static auto has_unsaved_fields(lua_State *L, const int index) -> bool {
+        const auto t = lua_absindex(L, index);
+
+        lua_pushnil(L);
+        while (lua_next(L, t)) {
+            const auto key_type = lua_type(L, -2);
+            if ((key_type != LUA_TNUMBER && key_type != LUA_TSTRING) || !is_data_type(lua_type(L, -1))) {
+                lua_pop(L, 2);
+                return true;
+            }
+
+            lua_pop(L, 1);
+        }
+
+        return false;
+    }
+
+    static auto write_state_table(lua_State *L, const int index, const int depth, state_ids &ids, snapshot_writer &w) -> void;
+
+    static auto write_state_value(lua_State *L, const int index, const int depth, state_ids &ids, snapshot_writer &w) -> void {
+        switch (lua_type(L, index)) {
+        case LUA_TNUMBER:
+            if (lua_isinteger(L, index)) {
+                w.write(state_value::integer);
+                w.write(static_cast<int64_t>(lua_tointeger(L, index)));
+            } else {
+                w.write(state_value::number);
+                w.write(static_cast<double>(lua_tonumber(L, index)));
+            }
+            break;
+        case LUA_TBOOLEAN:
+            w.write(state_value::boolean);
+            w.write(static_cast<uint8_t>(lua_toboolean(L, index)));
+            break;
+        case LUA_TSTRING: {
+            size_t len = 0;
+            const auto str = lua_tolstring(L, index, &len);
+            w.write(state_value::string);
+            w.write(static_cast<uint32_t>(len));
+            w.write_bytes(str, len);
+            break;
+        }
+        case LUA_TTABLE: {
+            // shared and cyclic tables, like M.__index = M, are written once
+            const auto [it, inserted] = ids.emplace(lua_topointer(L, index), static_cast<uint32_t>(ids.size()));
+            if (!inserted) {
+                w.write(state_value::reference);
+                w.write(it->second);
+                break;
+            }
+
+            w.write(has_unsaved_fields(L, index) ? state_value::mixed : state_value::table);
+            write_state_table(L, index, depth + 1, ids, w);
+            break;
+        }
+        default:
+            break;
+        }
+    }
+
+    static auto write_state_table(lua_State *L, const int index, const int depth, state_ids &ids, snapshot_writer &w) -> void {
+        const auto t = lua_absindex(L, index);
+
+        lua_pushnil(L);
+        while (lua_next(L, t)) {
+            const auto key_type = lua_type(L, -2);
+
+            // NOTE: lua_tolstring on number key would break lua_next, write_state_value checks type first
+            if ((key_type == LUA_TNUMBER || key_type == LUA_TSTRING) && is_state_value(L, -1, depth, ids)) {
+                write_state_value(L, -2, depth, ids, w);
+                write_state_value(L, -1, depth, ids, w);
+            }
+
+            lua_pop(L, 1);
+        }
+
+        w.write(state_value::end);
+    }
+
+    // stack slots of decoded tables by id and set of mixed ones
+    struct state_tables {
+        int         tables;
+        int         mixed;
+        uint32_t    count;
+    };
+
+    static auto read_state_table(lua_State *L, const int depth, state_tables &st, snapshot_reader &r) -> bool;
+
+    static auto read_state_value(lua_State *L, const state_value type, const int depth, state_tables &st, snapshot_reader &r) -> bool {
+        switch (type) {
+        case state_value::number: {
+            double value = 0.0;
+            if (!r.read(value))
+                return false;
+            lua_pushnumber(L, value);
+            return true;
+        }
+        case state_value::integer: {
+            int64_t value = 0;
+            if (!r.read(value))
+                return false;
+            lua_pushinteger(L, static_cast<lua_Integer>(value));
+            return true;
+        }
+        case state_value::boolean: {
+            uint8_t value = 0;
+            if (!r.read(value))
+                return false;
+            lua_pushboolean(L, value);
+            return true;
+        }
+        case state_value::string: {
+            std::string value;
+            if (!r.read(value))
+                return false;
+            lua_pushlstring(L, value.data(), value.size());
+            return true;
+        }
+        case state_value::table:
+        case state_value::mixed:
+            if (depth >= max_state_depth)
+                return false;
+
+            lua_newtable(L);
+            lua_pushvalue(L, -1);
+            lua_rawseti(L, st.tables, static_cast<int>(++st.count));
+
+            if (type == state_value::mixed) {
+                lua_pushvalue(L, -1);
+                lua_pushboolean(L, 1);
+                lua_rawset(L, st.mixed);
+            }
+
+            return read_state_table(L, depth + 1, st, r);
+        case state_value::reference: {
+            uint32_t id = 0;
+            if (!r.read(id) || id >= st.count)
+                return false;
+            lua_rawgeti(L, st.tables, static_cast<int>(id + 1));
+            return true;
+        }
+        default:
+            break;
+        }
+
+        return false;
+    }
+
+    // fills table on top of the stack
+    static auto read_state_table(lua_State *L, const int depth, state_tables &st, snapshot_reader &r) -> bool {
+        const auto t = lua_gettop(L);
+
+        for (;;) {
+            auto key_type = state_value::end;
+            if (!r.read(key_type))
+                return false;
+
+            if (key_type == state_value::end)
+                return true;
+
+            auto value_type = state_value::end;
+            // nil and NaN keys would raise error in lua_rawset
+            const auto valid_key = read_state_value(L, key_type, depth, st, r) && (lua_type(L, -1) != LUA_TNUMBER || !std::isnan(lua_tonumber(L, -1)));
+            if (!valid_key || !r.read(value_type)
+                    || !read_state_value(L, value_type, depth, st, r)) {
+                lua_settop(L, t);
+                return false;
+            }
+
+            lua_rawset(L, t);
+        }
+    }
+
+    auto save_script_state(const std::string &table, snapshot_writer &w) -> bool {
+        auto L = find_class_state(table);
+        if (!L)
+            return false;
+
+        lua_getglobal(L, table.c_str());
+
+        if (lua_type(L, -1) != LUA_TTABLE) {
+            lua_pop(L, 1);
+            return false;
         }
+
+        state_ids ids;
+        ids.emplace(lua_topointer(L, -1), 0);
+
+        write_state_table(L, -1, 0, ids, w);
+        lua_pop(L, 1);
+
+        return true;
+    }
+
+    auto decode_script_state(const std::string &table, snapshot_reader &r) -> std::optional<script_state> {
+        auto L = find_class_state(table);
+        if (!L)
+            return script_state{};
+
+        const auto top = lua_gettop(L);
+
+        // staging keeps class table copy, set of mixed tables and all tables by id
+        lua_createtable(L, 3, 0);
+        lua_newtable(L);
+        lua_newtable(L);
+
+        state_tables st{top + 2, top + 3, 1};
+
+        lua_newtable(L);
+        lua_pushvalue(L, -1);
+        lua_rawseti(L, st.tables, 1);
+
+        if (!read_state_table(L, 0, st, r)) {
+            lua_settop(L, top);
+            return {};
+        }
+
+        lua_rawseti(L, top + 1, 1);
+        lua_rawseti(L, top + 1, 2);
+        lua_rawseti(L, top + 1, 3);
+
+        return script_state{L, table, luaL_ref(L, LUA_REGISTRYINDEX)};
+    }
+
+    // pushes value, decoded table which is merged into live one is replaced by live table
+    static auto push_linked(lua_State *L, const int index, const int map) -> void {
+        lua_pushvalue(L, index);
+
+        if (lua_type(L, -1) != LUA_TTABLE)
+            return;
+
+        lua_pushvalue(L, -1);
+        lua_rawget(L, map);
+
+        if (lua_isnil(L, -1))
+            lua_pop(L, 1);
+        else
+            lua_remove(L, -2);
+    }
+
+    // pairs decoded class and mixed tables with live tables at the same keys
+    static auto map_state_tables(lua_State *L, const int live, const int decoded, const int mixed, const int map) -> void {
+        lua_pushvalue(L, decoded);
+        lua_pushvalue(L, live);
+        lua_rawset(L, map);
+
+        lua_pushnil(L);
+        while (lua_next(L, decoded)) {
+            if (lua_type(L, -1) == LUA_TTABLE) {
+                lua_pushvalue(L, -1);
+                lua_rawget(L, mixed);
+                const auto is_mixed = lua_toboolean(L, -1);
+
+                lua_pushvalue(L, -2);
+                lua_rawget(L, map);
+                const auto mapped = !lua_isnil(L, -1);
+                lua_pop(L, 2);
+
+                if (is_mixed && !mapped) {
+                    lua_pushvalue(L, -2);
+                    lua_rawget(L, live);
+
+                    if (lua_type(L, -1) == LUA_TTABLE)
+                        map_state_tables(L, lua_absindex(L, -1), lua_absindex(L, -2), mixed, map);
+
+                    lua_pop(L, 1);
+                }
+            }
+
+            lua_pop(L, 1);
+        }
+    }
+
+    // data fields of live table are replaced, functions and other unsaved fields stay
+    static auto replace_state_fields(lua_State *L, const int live, const int decoded, const int map) -> void {
+        lua_newtable(L);
+        const auto keys = lua_gettop(L);
+        int n = 0;
+
+        lua_pushnil(L);
+        while (lua_next(L, live)) {
+            if (is_data_type(lua_type(L, -1))) {
+                lua_pushvalue(L, -2);
+                lua_rawseti(L, keys, ++n);
+            }
+
+            lua_pop(L, 1);
+        }
+
+        for (int i = 1; i <= n; i++) {
+            lua_rawgeti(L, keys, i);
+            lua_pushnil(L);
+            lua_rawset(L, live);
+        }
+
+        lua_pop(L, 1);
+
+        lua_pushnil(L);
+        while (lua_next(L, decoded)) {
+            lua_pushvalue(L, -2);
+            push_linked(L, lua_absindex(L, -2), map);
+            lua_rawset(L, live);
+            lua_pop(L, 1);
+        }
+    }
+
+    // plain decoded tables become live, their references to merged tables are redirected
+    static auto link_state_table(lua_State *L, const int t, const int map) -> void {
+        lua_pushnil(L);
+        while (lua_next(L, t)) {
+            push_linked(L, lua_absindex(L, -1), map);
+
+            if (lua_rawequal(L, -1, -2))
+                lua_pop(L, 1);
+            else {
+                lua_pushvalue(L, -3);
+                lua_insert(L, -2);
+                lua_rawset(L, t); // existing key, safe during traversal
+            }
+
+            lua_pop(L, 1);
+        }
+    }
+
+    auto apply_script_state(const script_state &st) -> void {
+        auto L = st.state;
+        if (!L)
+            return;
+
+        lua_getglobal(L, st.table.c_str());
+
+        if (lua_type(L, -1) != LUA_TTABLE) {
+            lua_pop(L, 1);
+            drop_script_state(st);
+            return;
+        }
+
+        const auto live = lua_gettop(L);
+
+        lua_rawgeti(L, LUA_REGISTRYINDEX, st.ref);
+        lua_rawgeti(L, live + 1, 1);
+        lua_rawgeti(L, live + 1, 2);
+        lua_rawgeti(L, live + 1, 3);
+        lua_newtable(L);
+
+        const auto decoded = live + 2, mixed = live + 3, tables = live + 4, map = live + 5;
+
+        // class table and tables with functions are updated in place, so methods and identity survive
+        map_state_tables(L, live, decoded, mixed, map);
+
+        lua_pushnil(L);
+        while (lua_next(L, map)) {
+            replace_state_fields(L, lua_absindex(L, -1), lua_absindex(L, -2), map);
+            lua_pop(L, 1);
+        }
+
+        const auto n = static_cast<int>(lua_rawlen(L, tables));
+        for (int i = 1; i <= n; i++) {
+            lua_rawgeti(L, tables, i);
+            lua_pushvalue(L, -1);
+            lua_rawget(L, map);
+
+            if (lua_isnil(L, -1))
+                link_state_table(L, lua_absindex(L, -2), map);
+
+            lua_pop(L, 2);
+        }
+
+        lua_settop(L, live - 1);
+        drop_script_state(st);
+    }
+
+    auto drop_script_state(const script_state &st) -> void {
+        if (st.state)
+            luaL_unref(st.state, LUA_REGISTRYINDEX, st.ref);
     }
 
     template auto call_with_args<int>(const script_instance *, const char *, int&&) -> int32_t;
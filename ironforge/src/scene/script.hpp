@@ -2,11 +2,14 @@
 
 #include <cstdint>
 #include <string>
+#include <vector>
 #include <optional>
 #include <functional>
 
 #include <core/json.hpp>
 
+struct lua_State;
+
 namespace assets {
     struct instance_type;
     typedef instance_type instance_t;
@@ -23,12 +26,18 @@ namespace scene {
         return static_cast<script_flags>(static_cast<uint32_t>(a) | static_cast<uint32_t>(b));
     }
 
+    constexpr uint32_t invalid_script_class = UINT32_MAX;
+    constexpr uint32_t max_script_groups = 16;
+    constexpr int32_t invalid_script_ref = -2; // LUA_NOREF
+
     struct script_instance {
         std::string name;
         std::string source;
         std::string table;
-        uint32_t    entity;
-        uint32_t    flags;
+        uint32_t    entity = 0;
+        uint32_t    flags = 0;
+        uint32_t    group = 0; // Lua state, groups are updated in parallel
+        uint32_t    class_index = invalid_script_class; // resolved class table, see create_script
 
         //script_type type; but now only Lua supported
     };
@@ -46,13 +55,57 @@ namespace scene {
 
     auto call_fn(const script_instance *sc, const char *fn_name) -> int32_t;
 
+    // function of script class resolved once to registry reference, valid until script_classes_generation changes
+    auto resolve_script_fn(const script_instance &sc, const std::string &fn_name) -> int32_t;
+    auto script_classes_generation() -> uint64_t;
+    auto call_script_fn(const script_instance &sc, const int32_t fn_ref, const char *fn_name) -> int32_t;
+    auto call_script_fn(const script_instance &sc, const int32_t fn_ref, const char *fn_name, const float arg) -> int32_t;
+
     struct instance_type;
     typedef instance_type instance_t;
 
+    struct snapshot_writer;
+    struct snapshot_reader;
+    struct coroutine_scheduler;
+
+    using script_command = std::function<void(instance_t &)>;
+
     auto reset_scripts_engine() -> bool;
     auto setup_bindings(instance_t &sc) -> void;
+    // scenes share script groups, points bindings to scene about to run scripts
+    auto bind_scripts(instance_t &sc) -> void;
     auto create_script(assets::instance_t &asset, const uint32_t entity, const json &info) -> std::optional<script_instance>;
+    // class index of already loaded class table, invalid_script_class falls back to global lookup
+    auto find_script_class(const uint32_t group, const std::string &table) -> uint32_t;
 
+    ///
+    /// \brief Calls _update(self, entities, dt) once per script class with array of its entities
+    ///
     auto update_all_scripts(instance_t &sc, const float dt) -> void;
+
+    // resumes coroutines of bound scene blocked in wait_until(event)
+    auto signal_script_event(const std::string &event) -> void;
+    // scheduler of bound scene for script group, nullptr when no scene is bound
+    auto bound_coroutines(const uint32_t group) -> coroutine_scheduler*;
+
+    // queue for scene writes while script groups run in parallel, nullptr when writes are immediate
+    auto deferred_script_commands() -> std::vector<script_command>*;
+
+    // numbers, booleans, strings and nested tables of script class table, shared tables once,
+    // functions are skipped and stay in live tables on restore
+    auto save_script_state(const std::string &table, snapshot_writer &w) -> bool;
+
+    // decoded class state kept in registry of its Lua state until applied or dropped
+    struct script_state {
+        lua_State   *state = nullptr; // nullptr when class isn't loaded
+        std::string table;
+        int32_t     ref = -1;
+    };
+
+    // std::nullopt when data is corrupted, class table isn't touched
+    auto decode_script_state(const std::string &table, snapshot_reader &r) -> std::optional<script_state>;
+    // replaces state fields of class table, releases decoded state
+    auto apply_script_state(const script_state &st) -> void;
+    auto drop_script_state(const script_state &st) -> void;
 } // namespace scene
 
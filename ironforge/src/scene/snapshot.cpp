@@ -0,0 +1,469 @@
+#include <algorithm>
+#include <iterator>
+
+#include <SDL2/SDL_rwops.h>
+
+#include <core/journal.hpp>
+#include <scene/instance.hpp>
+
+#include "snapshot.hpp"
+
+namespace scene {
+    enum class snapshot_section : uint32_t {
+        end,
+        names,
+        bodies,
+        transforms,
+        cameras,
+        lights,
+        scripts,
+        timers,
+        models,
+        materials,
+        script_components,
+        emitters
+    };
+
+    struct snapshot_timer {
+        int32_t         id;
+        timer_type      type;
+        timer_status    status;
+        float           value;
+        float           stop_value;
+    };
+
+    // emitter parameters and spawn state, particles are visual only and not saved
+    struct snapshot_emitter {
+        float       rate;
+        float       lifetime_min;
+        float       lifetime_max;
+        float       size;
+        glm::vec3   spread;
+        glm::vec3   velocity_min;
+        glm::vec3   velocity_max;
+        glm::vec3   acceleration;
+        uint32_t    enabled;
+        float       spawn_accumulator;
+        uint32_t    seed;
+        std::array<float, particle_curve_samples>       speed_curve;
+        std::array<glm::vec4, particle_curve_samples>   color_curve;
+    };
+
+    static auto to_snapshot(const emitter_instance &e) -> snapshot_emitter {
+        return {e.rate, e.lifetime_min, e.lifetime_max, e.size, e.spread, e.velocity_min, e.velocity_max, e.acceleration,
+                e.enabled ? 1u : 0u, e.spawn_accumulator, e.seed, e.speed_curve, e.color_curve};
+    }
+
+    static auto from_snapshot(const snapshot_emitter &s) -> emitter_instance {
+        emitter_instance e;
+        e.rate = s.rate;
+        e.lifetime_min = s.lifetime_min;
+        e.lifetime_max = s.lifetime_max;
+        e.size = s.size;
+        e.spread = s.spread;
+        e.velocity_min = s.velocity_min;
+        e.velocity_max = s.velocity_max;
+        e.acceleration = s.acceleration;
+        e.enabled = s.enabled != 0;
+        e.spawn_accumulator = s.spawn_accumulator;
+        e.seed = s.seed;
+        e.speed_curve = s.speed_curve;
+        e.color_curve = s.color_curve;
+
+        return e;
+    }
+
+    template <typename Map>
+    static auto write_components(snapshot_writer &w, const Map &components) -> void {
+        using index_t = typename Map::key_type;
+        using value_t = typename Map::mapped_type;
+
+        static_assert(std::is_trivially_copyable<value_t>::value, "Component must be trivially copyable");
+
+        w.out.reserve(w.out.size() + components.size() * (sizeof(index_t) + sizeof(value_t)));
+
+        for (const auto &[ix, c] : components) {
+            w.write(ix);
+            w.write(c);
+        }
+    }
+
+    template <typename Map>
+    static auto read_components(snapshot_reader &r, const uint32_t count, Map &components) -> bool {
+        typename Map::key_type ix;
+        typename Map::mapped_type c;
+
+        components.clear();
+        components.reserve(count);
+
+        for (uint32_t i = 0; i < count; i++) {
+            if (!r.read(ix) || !r.read(c))
+                return false;
+
+            components.emplace(ix, c);
+        }
+
+        return true;
+    }
+
+    // section header is patched after body, size lets reader skip unknown sections
+    template <typename Fn>
+    static auto write_section(snapshot_writer &w, const snapshot_section section, const size_t count, Fn &&fn) -> void {
+        w.write(section);
+        w.write(static_cast<uint32_t>(count));
+
+        const auto size_offset = w.out.size();
+        w.write(uint32_t{0});
+
+        fn();
+
+        const auto size = static_cast<uint32_t>(w.out.size() - size_offset - sizeof(uint32_t));
+        memcpy(w.out.data() + size_offset, &size, sizeof size);
+    }
+
+    auto save_snapshot(const instance_t &sc) -> snapshot_data {
+        snapshot_data data;
+        snapshot_writer w{data};
+
+        w.write(snapshot_magic);
+        w.write(snapshot_version);
+        w.write(sc.current_entity_id);
+        w.write(sc.current_camera_index);
+
+        write_section(w, snapshot_section::names, sc.names.size(), [&] {
+            for (const auto &[name, ix] : sc.names) {
+                w.write(ix);
+                w.write(name);
+            }
+        });
+
+        write_section(w, snapshot_section::bodies, sc.bodies.size(), [&] {
+            write_components(w, sc.bodies);
+        });
+
+        write_section(w, snapshot_section::transforms, sc.transforms.size(), [&] {
+            write_components(w, sc.transforms);
+        });
+
+        write_section(w, snapshot_section::cameras, sc.cameras.size(), [&] {
+            write_components(w, sc.cameras);
+        });
+
+        write_section(w, snapshot_section::lights, sc.lights.size(), [&] {
+            write_components(w, sc.lights);
+        });
+
+        // handles address storages of the scene loaded from the same source
+        write_section(w, snapshot_section::models, sc.models.size(), [&] {
+            write_components(w, sc.models);
+        });
+
+        write_section(w, snapshot_section::materials, sc.materials.size(), [&] {
+            write_components(w, sc.materials);
+        });
+
+        // class index is resolved again by table name on restore
+        write_section(w, snapshot_section::script_components, sc.scripts.size(), [&] {
+            for (const auto &[ix, s] : sc.scripts) {
+                w.write(ix);
+                w.write(s.name);
+                w.write(s.source);
+                w.write(s.table);
+                w.write(s.flags);
+                w.write(s.group);
+            }
+        });
+
+        write_section(w, snapshot_section::emitters, sc.emitters.size(), [&] {
+            for (const auto &[ix, e] : sc.emitters) {
+                w.write(ix);
+                w.write(to_snapshot(e));
+            }
+        });
+
+        // several entities could share one class table
+        std::vector<std::string> tables;
+        tables.reserve(sc.scripts.size());
+        for (const auto &[ix, s] : sc.scripts) {
+            (void)ix;
+            if (std::find(tables.begin(), tables.end(), s.table) == tables.end())
+                tables.push_back(s.table);
+        }
+
+        write_section(w, snapshot_section::scripts, tables.size(), [&] {
+            for (const auto &table : tables) {
+                w.write(table);
+
+                const auto size_offset = w.out.size();
+                w.write(uint32_t{0});
+
+                if (!save_script_state(table, w))
+                    w.write(uint8_t{0}); // empty table
+
+                const auto size = static_cast<uint32_t>(w.out.size() - size_offset - sizeof(uint32_t));
+                memcpy(w.out.data() + size_offset, &size, sizeof size);
+            }
+        });
+
+        write_section(w, snapshot_section::timers, sc.timers.alive, [&] {
+            for_each_timer(sc.timers, [&] (const timer_instance &t) {
+                w.write(snapshot_timer{t.id, t.type, t.status, get_timer_elapsed(sc.timers, t), t.stop_value});
+            });
+        });
+
+        w.write(snapshot_section::end);
+
+        return data;
+    }
+
+    auto restore_snapshot(instance_t &sc, const snapshot_data &data) -> bool {
+        using namespace game;
+
+        snapshot_reader r{data.data(), data.data() + data.size()};
+
+        uint32_t magic = 0, version = 0;
+        if (!r.read(magic) || magic != snapshot_magic) {
+            journal::error(journal::_SCENE, "%", "Not a scene snapshot");
+            return false;
+        }
+
+        if (!r.read(version) || version != snapshot_version) {
+            journal::error(journal::_SCENE, "Unsupported snapshot version % (expected %)", version, snapshot_version);
+            return false;
+        }
+
+        instance_t::index_t current_entity_id = 0, current_camera_index = 0;
+        if (!r.read(current_entity_id) || !r.read(current_camera_index))
+            return false;
+
+        // decode everything before touching the scene, broken snapshot leaves it as is
+        decltype(sc.names) names;
+        decltype(sc.bodies) bodies;
+        decltype(sc.transforms) transforms;
+        decltype(sc.cameras) cameras;
+        decltype(sc.lights) lights;
+        decltype(sc.models) models;
+        decltype(sc.materials) materials;
+        decltype(sc.scripts) script_components;
+        std::vector<std::pair<instance_t::index_t, snapshot_emitter>> emitters;
+        std::vector<std::pair<std::string, snapshot_reader>> scripts;
+        std::vector<snapshot_timer> timers;
+
+        // restore succeeds only when end marker is reached, cut off data is rejected
+        for (auto ended = false; !ended;) {
+            auto section = snapshot_section::end;
+            uint32_t count = 0, size = 0;
+
+            if (!r.read(section)) {
+                journal::error(journal::_SCENE, "%", "Truncated snapshot, no end marker");
+                return false;
+            }
+
+            if (section == snapshot_section::end) {
+                ended = true;
+                continue;
+            }
+
+            if (!r.read(count) || !r.read(size) || static_cast<size_t>(r.end - r.ptr) < size) {
+                journal::error(journal::_SCENE, "Truncated snapshot section %", static_cast<uint32_t>(section));
+                return false;
+            }
+
+            snapshot_reader sr{r.ptr, r.ptr + size};
+            r.ptr += size;
+
+            auto ok = true;
+
+            switch (section) {
+            case snapshot_section::names:
+                names.reserve(count);
+                for (uint32_t i = 0; i < count && ok; i++) {
+                    instance_t::index_t ix = 0;
+                    std::string name;
+                    ok = sr.read(ix) && sr.read(name);
+                    if (ok)
+                        names.emplace(name, ix);
+                }
+                break;
+            case snapshot_section::bodies:
+                ok = read_components(sr, count, bodies);
+                break;
+            case snapshot_section::transforms:
+                ok = read_components(sr, count, transforms);
+                break;
+            case snapshot_section::cameras:
+                ok = read_components(sr, count, cameras);
+                break;
+            case snapshot_section::lights:
+                ok = read_components(sr, count, lights);
+                break;
+            case snapshot_section::models:
+                ok = read_components(sr, count, models);
+                break;
+            case snapshot_section::materials:
+                ok = read_components(sr, count, materials);
+                break;
+            case snapshot_section::script_components:
+                script_components.reserve(count);
+                for (uint32_t i = 0; i < count && ok; i++) {
+                    instance_t::index_t ix = 0;
+                    script_instance s;
+                    ok = sr.read(ix) && sr.read(s.name) && sr.read(s.source) && sr.read(s.table) && sr.read(s.flags) && sr.read(s.group);
+                    if (ok) {
+                        s.entity = ix;
+                        s.class_index = find_script_class(s.group, s.table);
+                        script_components.emplace(ix, std::move(s));
+                    }
+                }
+                break;
+            case snapshot_section::emitters:
+                emitters.resize(count);
+                for (uint32_t i = 0; i < count && ok; i++)
+                    ok = sr.read(emitters[i].first) && sr.read(emitters[i].second);
+                break;
+            case snapshot_section::scripts:
+                for (uint32_t i = 0; i < count && ok; i++) {
+                    std::string table;
+                    uint32_t state_size = 0;
+                    ok = sr.read(table) && sr.read(state_size) && static_cast<size_t>(sr.end - sr.ptr) >= state_size;
+                    if (ok) {
+                        scripts.push_back({table, snapshot_reader{sr.ptr, sr.ptr + state_size}});
+                        sr.ptr += state_size;
+                    }
+                }
+                break;
+            case snapshot_section::timers:
+                timers.resize(count);
+                for (uint32_t i = 0; i < count && ok; i++)
+                    ok = sr.read(timers[i]);
+                break;
+            default:
+                journal::warning(journal::_SCENE, "Skip unknown snapshot section %", static_cast<uint32_t>(section));
+                break;
+            }
+
+            if (!ok) {
+                journal::error(journal::_SCENE, "Corrupted snapshot section %", static_cast<uint32_t>(section));
+                return false;
+            }
+        }
+
+        // script blobs are parsed into staging tables, class tables change only when all of them are valid
+        std::vector<script_state> script_states;
+        script_states.reserve(scripts.size());
+
+        for (auto &[table, sr] : scripts) {
+            auto st = decode_script_state(table, sr);
+            if (!st) {
+                journal::error(journal::_SCENE, "Corrupted '%' script state", table);
+
+                for (const auto &decoded : script_states)
+                    drop_script_state(decoded);
+
+                return false;
+            }
+
+            if (!st->state)
+                journal::warning(journal::_SCENE, "Can't restore '%' script state", table);
+
+            script_states.push_back(std::move(st.value()));
+        }
+
+        sc.current_entity_id = current_entity_id;
+        sc.current_camera_index = current_camera_index;
+        sc.names = std::move(names);
+        sc.bodies = std::move(bodies);
+        sc.transforms = std::move(transforms);
+        sc.cameras = std::move(cameras);
+        sc.lights = std::move(lights);
+        sc.models = std::move(models);
+        sc.materials = std::move(materials);
+        sc.scripts = std::move(script_components);
+
+        // particles of emitters which survive restore stay alive
+        decltype(sc.emitters) restored_emitters;
+        restored_emitters.reserve(emitters.size());
+        for (const auto &[ix, s] : emitters) {
+            auto e = from_snapshot(s);
+            if (auto it = sc.emitters.find(ix); it != sc.emitters.end())
+                e.particles = std::move(it->second.particles);
+
+            restored_emitters.emplace(ix, std::move(e));
+        }
+        sc.emitters = std::move(restored_emitters);
+
+        // occluder geometry and input sources aren't saved, entities created after save lose them,
+        // so reused ids don't collide
+        const auto created_after = [current_entity_id] (const auto &c) {
+            return c.first >= current_entity_id;
+        };
+
+        for (auto it = sc.occluders.begin(); it != sc.occluders.end();)
+            it = created_after(*it) ? sc.occluders.erase(it) : std::next(it);
+
+        const auto inputs = sc.inputs.size();
+        for (auto it = sc.inputs.begin(); it != sc.inputs.end();)
+            it = created_after(*it) ? sc.inputs.erase(it) : std::next(it);
+
+        if (sc.inputs.size() != inputs)
+            sc.input_dispatch.dirty = true;
+
+        for (const auto &st : script_states)
+            apply_script_state(st);
+
+        // callbacks can't be stored, only still existing timers are rescheduled
+        for (const auto &st : timers) {
+            const auto h = get_timer_handle(sc.timers, st.id);
+            auto t = get_timer(sc.timers, h);
+            if (!t)
+                continue;
+
+            t->type = st.type;
+            t->stop_value = st.stop_value;
+            t->period = to_timer_ticks(st.stop_value);
+            reset_timer(sc.timers, h, st.stop_value - st.value);
+        }
+
+        return true;
+    }
+
+    auto write_snapshot(const std::string &path, const snapshot_data &data) -> bool {
+        using namespace game;
+
+        auto rw = SDL_RWFromFile(path.c_str(), "wb");
+        if (!rw) {
+            journal::error(journal::_SCENE, "Can't write snapshot '%': %", path, SDL_GetError());
+            return false;
+        }
+
+        const auto written = SDL_RWwrite(rw, data.data(), 1, data.size());
+        SDL_RWclose(rw);
+
+        return written == data.size();
+    }
+
+    auto read_snapshot(const std::string &path) -> std::optional<snapshot_data> {
+        using namespace game;
+
+        auto rw = SDL_RWFromFile(path.c_str(), "rb");
+        if (!rw) {
+            journal::error(journal::_SCENE, "Can't read snapshot '%': %", path, SDL_GetError());
+            return {};
+        }
+
+        const auto size = SDL_RWsize(rw);
+        if (size < 0) {
+            SDL_RWclose(rw);
+            return {};
+        }
+
+        snapshot_data data(static_cast<size_t>(size));
+        const auto read = SDL_RWread(rw, data.data(), 1, data.size());
+        SDL_RWclose(rw);
+
+        if (read != data.size())
+            return {};
+
+        return data;
+    }
+} // namespace scene
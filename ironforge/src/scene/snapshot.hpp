@@ -0,0 +1,88 @@
+#pragma once
+
+#include <vector>
+#include <string>
+#include <cstdint>
+#include <cstring>
+#include <optional>
+#include <type_traits>
+
+namespace scene {
+    struct instance_type;
+    typedef instance_type instance_t;
+
+    constexpr uint32_t snapshot_magic = 0x4e534649; // IFSN
+    constexpr uint32_t snapshot_version = 2;
+
+    using snapshot_data = std::vector<uint8_t>;
+
+    struct snapshot_writer {
+        snapshot_data &out;
+
+        auto write_bytes(const void *ptr, const size_t size) -> void {
+            const auto offset = out.size();
+            out.resize(offset + size);
+            if (size > 0)
+                memcpy(out.data() + offset, ptr, size);
+        }
+
+        template <typename T>
+        auto write(const T &value) -> void {
+            static_assert(std::is_trivially_copyable<T>::value, "Only trivially copyable types could be written");
+            write_bytes(&value, sizeof value);
+        }
+
+        auto write(const std::string &value) -> void {
+            write(static_cast<uint32_t>(value.size()));
+            write_bytes(value.data(), value.size());
+        }
+    };
+
+    struct snapshot_reader {
+        const uint8_t *ptr = nullptr;
+        const uint8_t *end = nullptr;
+
+        auto read_bytes(void *dst, const size_t size) -> bool {
+            if (static_cast<size_t>(end - ptr) < size)
+                return false;
+
+            if (size > 0)
+                memcpy(dst, ptr, size);
+            ptr += size;
+
+            return true;
+        }
+
+        template <typename T>
+        auto read(T &value) -> bool {
+            static_assert(std::is_trivially_copyable<T>::value, "Only trivially copyable types could be read");
+            return read_bytes(&value, sizeof value);
+        }
+
+        auto read(std::string &value) -> bool {
+            uint32_t size = 0;
+            if (!read(size) || static_cast<size_t>(end - ptr) < size)
+                return false;
+
+            value.assign(reinterpret_cast<const char*>(ptr), size);
+            ptr += size;
+
+            return true;
+        }
+    };
+
+    ///
+    /// \brief Write names, bodies, transforms, cameras, lights, models, materials, scripts, emitters,
+    /// script tables and timers
+    ///
+    auto save_snapshot(const instance_t &sc) -> snapshot_data;
+
+    ///
+    /// \brief Restore state written by save_snapshot into scene loaded from the same source,
+    /// occluders and inputs of entities created after save are removed, others are kept
+    ///
+    [[nodiscard]] auto restore_snapshot(instance_t &sc, const snapshot_data &data) -> bool;
+
+    auto write_snapshot(const std::string &path, const snapshot_data &data) -> bool;
+    auto read_snapshot(const std::string &path) -> std::optional<snapshot_data>;
+} // namespace scene
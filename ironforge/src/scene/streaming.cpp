@@ -0,0 +1,490 @@
+#include <chrono>
+#include <algorithm>
+#include <numeric>
+
+#include <core/journal.hpp>
+#include <core/assets.hpp>
+#include <utility/thread_pool.hpp>
+#include <scene/scene.hpp>
+#include <scene/instance.hpp>
+
+#include "streaming.hpp"
+
+namespace scene {
+    using streaming_clock = std::chrono::steady_clock;
+
+    auto create_world_streaming(assets::instance_t &asset, const json &info) -> std::optional<world_streaming> {
+        using namespace std;
+        using namespace game;
+        using namespace glm;
+
+        world_streaming ws;
+
+        if (info.find("load_radius") != info.end())
+            ws.load_radius = info["load_radius"].get<float>();
+
+        ws.unload_radius = info.find("unload_radius") != info.end() ? info["unload_radius"].get<float>() : ws.load_radius * 1.5f;
+
+        if (info.find("budget") != info.end())
+            ws.budget = info["budget"].get<float>();
+
+        if (info.find("cells") == info.end())
+            return {};
+
+        for (const auto &c : info["cells"]) {
+            world_cell cell;
+            cell.name = c.find("name") != c.end() ? c["name"].get<string>() : string{};
+
+            // all_files is filled up front, so path is resolved here and worker only reads the file
+            const auto file = c.find("path") != c.end() ? c["path"].get<string>() : string{};
+            if (const auto it = asset.all_files.find(file); it != asset.all_files.end())
+                cell.path = it->second;
+            else {
+                journal::warning(journal::_SCENE, "Cell '%' file '%' not found", cell.name, file);
+                continue;
+            }
+
+            if (c.find("min") != c.end())
+                cell.min = c["min"].get<vec3>();
+
+            if (c.find("max") != c.end())
+                cell.max = c["max"].get<vec3>();
+
+            ws.cells.push_back(std::move(cell));
+        }
+
+        journal::info(journal::_SCENE, "Create world streaming:\n\tcells %\n\tload radius %\n\tunload radius %", ws.cells.size(), ws.load_radius, ws.unload_radius);
+
+        return ws;
+    }
+
+    static auto distance_to_cell(const world_cell &cell, const glm::vec3 &p) -> float {
+        return glm::length(glm::max(glm::max(cell.min - p, p - cell.max), glm::vec3{0.f}));
+    }
+
+    // file reading and decoding of textures, shaders and meshes, nothing touches video context
+    static auto read_cell_assets(assets::instance_t &asset, const uint32_t texture_level, const json &contents) -> cell_assets {
+        using namespace std;
+        using namespace game;
+
+        cell_assets ca;
+
+        if (contents.find("textures") != contents.end())
+            for (const auto &tex_info : contents["textures"])
+                if (auto t = video::read_texture(asset, texture_level, tex_info); t)
+                    ca.textures.push_back(std::move(t.value()));
+
+        if (contents.find("effects") != contents.end())
+            for (const auto &eff : contents["effects"])
+                if (eff.find("type") != eff.end() && eff["type"].get<string>() == "shader")
+                    if (auto p = video::read_program(asset, eff); p)
+                        ca.programs.push_back(std::move(p.value()));
+
+        const auto read_meshes = [&asset] (const json &meshes, vector<video::vertices_info> &out) {
+            for (const auto &msh : meshes)
+                if (auto v = video::create_vertices_info(asset, msh); v)
+                    out.push_back(std::move(v.value()));
+        };
+
+        if (contents.find("models") != contents.end())
+            for (const auto &md : contents["models"]) {
+                model_data m;
+                m.name = md.find("name") != md.end() ? md["name"].get<string>() : string{};
+
+                if (md.find("meshes") == md.end()) {
+                    journal::warning(journal::_SCENE, "Model '%' not contain meshes", m.name);
+                    continue;
+                }
+
+                read_meshes(md["meshes"], m.meshes);
+
+                if (md.find("lods") != md.end())
+                    for (const auto &ld : md["lods"]) {
+                        lod_data lod;
+                        lod.screen_size = ld.find("screen_size") != ld.end() ? ld["screen_size"].get<float>() : 0.f;
+
+                        if (ld.find("meshes") != ld.end())
+                            read_meshes(ld["meshes"], lod.meshes);
+
+                        if (lod.meshes.empty()) {
+                            journal::warning(journal::_SCENE, "Model '%' lod not contain meshes", m.name);
+                            continue;
+                        }
+
+                        m.lods.push_back(std::move(lod));
+                    }
+
+                if (!m.meshes.empty())
+                    ca.models.push_back(std::move(m));
+            }
+
+        return ca;
+    }
+
+    static auto start_fetch(assets::instance_t &asset, const uint32_t texture_level, world_cell &cell) -> void {
+        cell.state = cell_state::fetching;
+        cell.fetch = utils::shared_pool().enqueue([path = cell.path, &asset, texture_level] () -> std::optional<cell_fetch> {
+            const auto contents = assets::get_config(path);
+            if (!contents)
+                return {};
+
+            // exception would be rethrown by get() on main thread
+            try {
+                cell_fetch f;
+                f.contents = json::parse(contents.value());
+                f.assets = read_cell_assets(asset, texture_level, f.contents);
+
+                return f;
+            } catch (const std::exception &) {
+                return {};
+            }
+        });
+    }
+
+    static auto resource_names(const json &contents, const char *key) -> std::vector<std::string> {
+        std::vector<std::string> names;
+
+        if (contents.find(key) == contents.end())
+            return names;
+
+        for (const auto &r : contents[key])
+            if (r.find("name") != r.end())
+                names.push_back(r["name"].get<std::string>());
+
+        return names;
+    }
+
+    // counts resources of other cells, returns names not loaded yet
+    template <typename Exists>
+    static auto acquire_resources(std::unordered_map<std::string, uint32_t> &refs, const std::vector<std::string> &names, Exists &&exists, std::vector<std::string> &used) -> std::vector<std::string> {
+        std::vector<std::string> fresh;
+
+        for (const auto &name : names) {
+            if (std::find(used.begin(), used.end(), name) != used.end() || std::find(fresh.begin(), fresh.end(), name) != fresh.end())
+                continue;
+
+            if (auto it = refs.find(name); it != refs.end()) {
+                it->second++;
+                used.push_back(name);
+            } else if (!exists(name))
+                fresh.push_back(name);
+        }
+
+        return fresh;
+    }
+
+    // fresh names created while cell was uploaded belong to cell, other cell could upload the same name meanwhile
+    template <typename Exists>
+    static auto own_resources(std::unordered_map<std::string, uint32_t> &refs, const std::vector<std::string> &fresh, Exists &&exists, std::vector<std::string> &used) -> void {
+        for (const auto &name : fresh)
+            if (exists(name)) {
+                refs[name]++;
+                used.push_back(name);
+            }
+    }
+
+    // true when last user is gone
+    static auto release_ref(std::unordered_map<std::string, uint32_t> &refs, const std::string &name) -> bool {
+        auto it = refs.find(name);
+        if (it == refs.end() || --it->second > 0)
+            return false;
+
+        refs.erase(it);
+
+        return true;
+    }
+
+    // resources go straight to live caches and are invisible until referenced
+    struct resource_lookup {
+        video::instance_t   &vi;
+        instance_t          &sc;
+
+        auto texture(const std::string &name) const -> bool {
+            return vi.textures.find(name) != vi.textures.end();
+        }
+
+        auto material(const std::string &name) const -> bool {
+            return sc.all_materials.find(name) != sc.all_materials.end();
+        }
+
+        auto model(const std::string &name) const -> bool {
+            return sc.all_models.find(name) != sc.all_models.end();
+        }
+    };
+
+    static auto begin_upload(video::instance_t &vi, instance_t &sc, world_streaming &ws, world_cell &cell, cell_fetch &&fetched) -> void {
+        const resource_lookup has{vi, sc};
+
+        cell.contents = std::move(fetched.contents);
+        cell.assets = std::move(fetched.assets);
+        cell.next_asset = 0;
+
+        auto &res = cell.resources;
+        cell.fresh.textures = acquire_resources(ws.texture_refs, resource_names(cell.contents, "textures"), [&has] (const std::string &n) { return has.texture(n); }, res.textures);
+        cell.fresh.materials = acquire_resources(ws.material_refs, resource_names(cell.contents, "materials"), [&has] (const std::string &n) { return has.material(n); }, res.materials);
+        cell.fresh.models = acquire_resources(ws.model_refs, resource_names(cell.contents, "models"), [&has] (const std::string &n) { return has.model(n); }, res.models);
+
+        cell.state = cell_state::uploading;
+    }
+
+    static auto asset_count(const cell_assets &ca) -> size_t {
+        return ca.textures.size() + ca.programs.size() + ca.models.size();
+    }
+
+    // one texture, program or model, already loaded names are skipped
+    static auto upload_asset(video::instance_t &vi, instance_t &sc, cell_assets &ca, size_t index) -> void {
+        if (index < ca.textures.size()) {
+            video::upload_texture(vi, ca.textures[index]);
+            return;
+        }
+
+        index -= ca.textures.size();
+
+        if (index < ca.programs.size()) {
+            video::upload_program(vi, ca.programs[index]);
+            return;
+        }
+
+        index -= ca.programs.size();
+
+        const auto &md = ca.models[index];
+        if (sc.all_models.find(md.name) != sc.all_models.end())
+            return;
+
+        std::vector<video::mesh> meshes;
+        meshes.reserve(md.meshes.size());
+        for (const auto &v : md.meshes)
+            meshes.push_back(video::upload_mesh(vi, v));
+
+        std::vector<model_lod> lods;
+        lods.reserve(md.lods.size());
+        for (const auto &ld : md.lods) {
+            model_lod lod;
+            lod.screen_size = ld.screen_size;
+
+            for (const auto &v : ld.meshes)
+                lod.meshes.push_back(video::upload_mesh(vi, v));
+
+            lods.push_back(std::move(lod));
+        }
+
+        if (auto m = create_model(meshes, lods); m)
+            cache_model(sc, md.name, m.value());
+    }
+
+    // files are handled by upload, rest of resources is cheap and reads uploaded textures
+    static auto resources_without_files(const json &contents) -> json {
+        using namespace std;
+
+        json rest = json::object();
+
+        for (const auto key : {"materials", "inputs", "prefabs"})
+            if (contents.find(key) != contents.end())
+                rest[key] = contents[key];
+
+        if (contents.find("effects") != contents.end()) {
+            rest["effects"] = json::array();
+
+            for (const auto &eff : contents["effects"])
+                if (eff.find("type") == eff.end() || eff["type"].get<string>() != "shader")
+                    rest["effects"].push_back(eff);
+        }
+
+        return rest;
+    }
+
+    static auto begin_staging(assets::instance_t &asset, video::instance_t &vi, instance_t &sc, world_streaming &ws, world_cell &cell) -> void {
+        const resource_lookup has{vi, sc};
+
+        load_resources(asset, vi, sc, resources_without_files(cell.contents));
+
+        auto &res = cell.resources;
+        own_resources(ws.texture_refs, cell.fresh.textures, [&has] (const std::string &n) { return has.texture(n); }, res.textures);
+        own_resources(ws.material_refs, cell.fresh.materials, [&has] (const std::string &n) { return has.material(n); }, res.materials);
+        own_resources(ws.model_refs, cell.fresh.models, [&has] (const std::string &n) { return has.model(n); }, res.models);
+
+        cell.fresh = cell_resources{};
+        cell.assets = cell_assets{};
+
+        // components are created into staging only, models, materials and inputs are read from scene
+        auto staging = std::make_shared<instance_t>();
+
+        // reserve ids now, so entities spawned while cell is staged don't collide
+        const auto nodes = cell.contents.find("nodes") != cell.contents.end() ? cell.contents["nodes"].size() : 0;
+        staging->current_entity_id = sc.current_entity_id;
+        sc.current_entity_id += static_cast<uint32_t>(nodes);
+
+        cell.entities.resize(nodes);
+        std::iota(cell.entities.begin(), cell.entities.end(), staging->current_entity_id);
+
+        cell.staging = std::move(staging);
+        cell.next_node = 0;
+        cell.state = cell_state::staging;
+    }
+
+    template <typename Map>
+    static auto merge_components(Map &dst, Map &src) -> void {
+        for (auto &[ix, c] : src)
+            dst.insert_or_assign(ix, std::move(c));
+    }
+
+    static auto release_cell_resources(video::instance_t &vi, instance_t &sc, world_streaming &ws, world_cell &cell) -> void {
+        auto &res = cell.resources;
+
+        for (const auto &name : res.models)
+            if (release_ref(ws.model_refs, name))
+                release_model(vi, sc, name);
+
+        for (const auto &name : res.materials)
+            if (release_ref(ws.material_refs, name))
+                release_material(sc, name);
+
+        for (const auto &name : res.textures)
+            if (release_ref(ws.texture_refs, name))
+                video::destroy_texture(vi, name);
+
+        res = cell_resources{};
+    }
+
+    // names are unique in scene, clashing ones are prefixed with cell name
+    static auto merge_names(instance_t &sc, world_cell &cell) -> void {
+        using namespace game;
+
+        for (const auto &[name, ix] : cell.staging->names) {
+            if (sc.names.emplace(name, ix).second)
+                continue;
+
+            const auto prefixed = cell.name + "/" + name;
+            if (sc.names.emplace(prefixed, ix).second)
+                journal::warning(journal::_SCENE, "Cell '%' entity '%' renamed to '%'", cell.name, name, prefixed);
+            else
+                journal::warning(journal::_SCENE, "Cell '%' entity '%' name is already used", cell.name, name);
+        }
+    }
+
+    static auto merge_cell(instance_t &sc, world_cell &cell) -> void {
+        auto &st = *cell.staging;
+
+        merge_names(sc, cell);
+        merge_components(sc.materials, st.materials);
+        merge_components(sc.models, st.models);
+        merge_components(sc.cameras, st.cameras);
+        merge_components(sc.scripts, st.scripts);
+        merge_components(sc.bodies, st.bodies);
+        merge_components(sc.inputs, st.inputs);
+        merge_components(sc.transforms, st.transforms);
+        merge_components(sc.emitters, st.emitters);
+        merge_components(sc.lights, st.lights);
+        merge_components(sc.occluders, st.occluders);
+
+        if (!st.inputs.empty())
+            sc.input_dispatch.dirty = true;
+
+        cell.staging.reset();
+        cell.contents = json{};
+        cell.state = cell_state::loaded;
+
+        game::journal::info(game::journal::_SCENE, "Cell '%' loaded, % entities", cell.name, cell.entities.size());
+    }
+
+    auto update_streaming(assets::instance_t &asset, video::instance_t &vi, instance_t &sc) -> void {
+        using namespace game;
+
+        if (!sc.streaming)
+            return;
+
+        auto &ws = *sc.streaming;
+
+        const auto start = streaming_clock::now();
+        const auto deadline = start + std::chrono::duration_cast<streaming_clock::duration>(std::chrono::duration<float, std::milli>{ws.budget});
+        const auto in_budget = [&deadline] {
+            return streaming_clock::now() < deadline;
+        };
+
+        const auto camera = glm::vec3{glm::inverse(sc.current_camera().view)[3]};
+
+        for (auto &cell : ws.cells) {
+            const auto distance = distance_to_cell(cell, camera);
+
+            switch (cell.state) {
+            case cell_state::unloaded:
+                if (distance <= ws.load_radius)
+                    start_fetch(asset, vi.texture_level, cell);
+                break;
+            case cell_state::fetching: {
+                if (!in_budget() || cell.fetch.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+                    break;
+
+                auto contents = cell.fetch.get();
+                if (!contents) {
+                    journal::warning(journal::_SCENE, "Can't read cell '%'", cell.name);
+                    cell.state = cell_state::unloaded;
+                    break;
+                }
+
+                // camera went away while file was read
+                if (distance > ws.unload_radius) {
+                    cell.state = cell_state::unloaded;
+                    break;
+                }
+
+                begin_upload(vi, sc, ws, cell, std::move(contents.value()));
+                break;
+            }
+            case cell_state::uploading: {
+                const auto assets = asset_count(cell.assets);
+
+                for (; cell.next_asset < assets && in_budget(); cell.next_asset++)
+                    upload_asset(vi, sc, cell.assets, cell.next_asset);
+
+                if (cell.next_asset >= assets)
+                    begin_staging(asset, vi, sc, ws, cell);
+                break;
+            }
+            case cell_state::staging: {
+                auto &st = *cell.staging;
+                const auto nodes = cell.contents.find("nodes") != cell.contents.end() ? cell.contents["nodes"].size() : 0;
+
+                for (; cell.next_node < nodes && in_budget(); cell.next_node++) {
+                    const auto &n = cell.contents["nodes"][cell.next_node];
+
+                    // root belongs to scene
+                    if (n.find("name") != n.end() && n["name"].get<std::string>() == "root") {
+                        st.current_entity_id++;
+                        continue;
+                    }
+
+                    create_entity(asset, vi, st, n, sc);
+                }
+
+                // merge is one step, scene never sees part of cell
+                if (cell.next_node >= nodes)
+                    merge_cell(sc, cell);
+                break;
+            }
+            case cell_state::loaded:
+                if (distance > ws.unload_radius)
+                    cell.state = cell_state::unloading;
+                break;
+            case cell_state::unloading:
+                while (!cell.entities.empty() && in_budget()) {
+                    remove_entity(sc, cell.entities.back());
+                    cell.entities.pop_back();
+                }
+
+                if (cell.entities.empty()) {
+                    release_cell_resources(vi, sc, ws, cell);
+                    cell.state = cell_state::unloaded;
+                    journal::info(journal::_SCENE, "Cell '%' unloaded", cell.name);
+                }
+                break;
+            }
+        }
+    }
+
+    auto wait_streaming(world_streaming &ws) -> void {
+        for (auto &cell : ws.cells)
+            if (cell.fetch.valid())
+                cell.fetch.wait();
+    }
+} // namespace scene
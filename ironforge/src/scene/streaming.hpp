@@ -0,0 +1,112 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <future>
+#include <cstdint>
+#include <optional>
+#include <unordered_map>
+
+#include <core/math.hpp>
+#include <core/json.hpp>
+#include <video/video.hpp>
+
+namespace assets {
+    struct instance_type;
+    typedef instance_type instance_t;
+}
+
+namespace video {
+    struct instance_type;
+    typedef instance_type instance_t;
+}
+
+namespace scene {
+    struct instance_type;
+    typedef instance_type instance_t;
+
+    enum class cell_state : uint32_t {
+        unloaded,
+        fetching,   // cell file and its assets read and decoded on worker thread
+        uploading,  // decoded assets uploaded to video context, few per frame
+        staging,    // components created into staging scene, few nodes per frame
+        loaded,
+        unloading   // entities removed, few per frame
+    };
+
+    // names of resources created by cells, scene own resources are never listed
+    struct cell_resources {
+        std::vector<std::string>            textures;
+        std::vector<std::string>            materials;
+        std::vector<std::string>            models;
+    };
+
+    struct lod_data {
+        float                               screen_size = 0.f;
+        std::vector<video::vertices_info>   meshes;
+    };
+
+    struct model_data {
+        std::string                         name;
+        std::vector<video::vertices_info>   meshes;
+        std::vector<lod_data>               lods;
+    };
+
+    // files of cell resources decoded by worker, main thread only uploads them
+    struct cell_assets {
+        std::vector<video::texture_data>    textures;
+        std::vector<video::gl::program_info> programs;
+        std::vector<model_data>             models;
+    };
+
+    struct cell_fetch {
+        json                                contents;
+        cell_assets                         assets;
+    };
+
+    struct world_cell {
+        std::string                         name;
+        std::string                         path; // scene like json with resources and nodes
+        glm::vec3                           min = glm::vec3{0.f};
+        glm::vec3                           max = glm::vec3{0.f};
+        cell_state                          state = cell_state::unloaded;
+
+        std::future<std::optional<cell_fetch>> fetch;
+        json                                contents;
+        cell_assets                         assets;
+        size_t                              next_asset = 0;
+        size_t                              next_node = 0;
+        std::shared_ptr<instance_t>         staging;
+        std::vector<uint32_t>               entities; // ids reserved for cell nodes
+        cell_resources                      resources; // released when last cell using them is unloaded
+        cell_resources                      fresh; // not loaded when fetch finished, owned after upload
+    };
+
+    ///
+    /// \brief Cells of large world loaded and unloaded in background by distance to current camera
+    ///
+    struct world_streaming {
+        std::vector<world_cell> cells;
+        float                   load_radius = 100.f;
+        float                   unload_radius = 150.f; // larger than load radius, so border cells don't flicker
+        float                   budget = 2.f; // ms per frame for uploads, staging, merge and unloading
+
+        // loaded cells using resource created by a cell
+        std::unordered_map<std::string, uint32_t> texture_refs;
+        std::unordered_map<std::string, uint32_t> material_refs;
+        std::unordered_map<std::string, uint32_t> model_refs;
+    };
+
+    [[nodiscard]] auto create_world_streaming(assets::instance_t &asset, const json &info) -> std::optional<world_streaming>;
+
+    ///
+    /// \brief Starts fetches, uploads assets, stages components and merges finished cells into scene in one step.
+    /// Call once per frame from the thread owning the scene and video context.
+    /// With threaded simulation nobody owns both, so streaming doesn't run there for now
+    ///
+    auto update_streaming(assets::instance_t &asset, video::instance_t &vi, instance_t &sc) -> void;
+
+    // fetches read through assets instance, so it must outlive them
+    auto wait_streaming(world_streaming &ws) -> void;
+} // namespace scene
@@ -1,105 +1,244 @@
-#include <vector>
-#include <algorithm>
-
 #include <core/journal.hpp>
-#include <scene/scene.hpp>
 
 #include "timer.hpp"
 
 namespace scene {
-    std::vector<timer_instance> timers;
-
-    static auto default_on_time(timer_instance &t) -> void {
-        UNUSED(t);
+    constexpr uint32_t firing_list = timer_wheel_levels * timer_wheel_slots;
 
-        t.end = std::chrono::system_clock::now();
-        auto elapsed_seconds = std::chrono::duration<double> {t.end - t.start};
-        t.start = t.end;
+    timer_wheel::timer_wheel() {
+        heads.fill(timer_nil);
+    }
 
-        game::journal::debug(game::journal::_SCENE, "% % %s", t.id, "on_time", elapsed_seconds.count());
+    static inline auto make_handle(const uint32_t index, const uint32_t generation) -> timer_handle {
+        return (static_cast<uint64_t>(generation) << 32) | index;
     }
 
-    auto init_all_timers() -> void {
-        timers.reserve(max_timers);
+    static auto link(timer_wheel &tw, const uint32_t index, const uint32_t list) -> void {
+        auto &t = tw.timers[index];
+
+        t.list = list;
+        t.prev = timer_nil;
+        t.next = tw.heads[list];
 
-        timer_info ti;
-        ti.type = timer_type::once;
-        ti.time_interval = 1.0f;
-        ti.callback = nullptr;
+        if (t.next != timer_nil)
+            tw.timers[t.next].prev = index;
 
-        create_timer(ti);
+        tw.heads[list] = index;
     }
 
-    auto cleanup_all_timers() -> void {
-        timers.clear();
+    static auto unlink(timer_wheel &tw, const uint32_t index) -> void {
+        auto &t = tw.timers[index];
+
+        if (t.prev != timer_nil)
+            tw.timers[t.prev].next = t.next;
+        else
+            tw.heads[t.list] = t.next;
+
+        if (t.next != timer_nil)
+            tw.timers[t.next].prev = t.prev;
+
+        t.list = t.prev = t.next = timer_nil;
     }
 
-    auto update_all_timers(const float dt) -> void {
-        for (auto &t : timers) {
-            t.value += dt;
+    // level is highest group of bits where deadline and current differ
+    static auto schedule(timer_wheel &tw, const uint32_t index) -> void {
+        auto &t = tw.timers[index];
+
+        const auto max_deadline = tw.current + (uint64_t{1} << (timer_wheel_bits * timer_wheel_levels)) - 1;
+        t.deadline = std::min(t.deadline, max_deadline);
 
-            if (t.value > t.stop_value) {
-                switch (t.type) {
-                case timer_type::once:
-                    t.callback(t);
-                    t.value = 0;
-                    t.status = timer_status::dead;
-                    break;
-                case timer_type::periodic:
-                    t.callback(t);
-                    t.value = 0;
-                    break;
-                }
+        for (uint32_t level = 0; level < timer_wheel_levels; level++) {
+            const auto shift = timer_wheel_bits * (level + 1);
+
+            if ((t.deadline >> shift) == (tw.current >> shift) || level + 1 == timer_wheel_levels) {
+                const auto slot = (t.deadline >> (timer_wheel_bits * level)) & (timer_wheel_slots - 1);
+                link(tw, index, level * timer_wheel_slots + static_cast<uint32_t>(slot));
+                return;
             }
         }
+    }
 
-        for (size_t i = 0; i < max_timers; i++)
-            if (timers[i].status == timer_status::dead) {
-                auto t = &timers[i];
-                delete_timer(t);
-            }
+    static auto release(timer_wheel &tw, const uint32_t index) -> void {
+        auto &t = tw.timers[index];
+
+        if (t.list != timer_nil)
+            unlink(tw, index);
+
+        t.status = timer_status::dead;
+        t.callback = nullptr;
+        t.generation++;
+
+        tw.free_timers.push_back(index);
+        tw.alive--;
+    }
+
+    static auto find_alive(const timer_wheel &tw, const timer_handle h) -> uint32_t {
+        const auto index = static_cast<uint32_t>(h & 0xffffffffu);
+        const auto generation = static_cast<uint32_t>(h >> 32);
+
+        if (index >= tw.timers.size() || tw.timers[index].generation != generation || tw.timers[index].status != timer_status::alive)
+            return timer_nil;
+
+        return index;
+    }
+
+    static auto default_on_time(instance_t &, timer_instance &t) -> void {
+        game::journal::debug(game::journal::_SCENE, "% % %s", t.id, "on_time", t.value);
+    }
+
+    auto cleanup_all_timers(timer_wheel &tw) -> void {
+        tw = timer_wheel{};
+    }
+
+    static auto cascade(timer_wheel &tw, const uint32_t level) -> void {
+        const auto slot = (tw.current >> (timer_wheel_bits * level)) & (timer_wheel_slots - 1);
+        const auto list = level * timer_wheel_slots + static_cast<uint32_t>(slot);
+
+        while (tw.heads[list] != timer_nil) {
+            const auto index = tw.heads[list];
+            unlink(tw, index);
+            schedule(tw, index);
+        }
+    }
+
+    static auto advance(timer_wheel &tw, instance_t &owner) -> void {
+        tw.current++;
+
+        // higher levels first, so timers cascaded down can be cascaded again in the same tick
+        for (auto level = timer_wheel_levels - 1; level > 0; level--) {
+            const auto mask = (uint64_t{1} << (timer_wheel_bits * level)) - 1;
+            if ((tw.current & mask) == 0)
+                cascade(tw, level);
+        }
+
+        // move due timers to own list, callbacks may delete or create timers while it is walked
+        const auto due = static_cast<uint32_t>(tw.current & (timer_wheel_slots - 1));
+        while (tw.heads[due] != timer_nil) {
+            const auto index = tw.heads[due];
+            unlink(tw, index);
+            link(tw, index, firing_list);
+        }
+
+        while (tw.heads[firing_list] != timer_nil) {
+            const auto index = tw.heads[firing_list];
+            unlink(tw, index);
+
+            tw.timers[index].value = tw.timers[index].stop_value;
+
+            const auto generation = tw.timers[index].generation;
+            auto callback = tw.timers[index].callback;
+
+            // callback gets a copy, creating timers in it may reallocate pool
+            auto fired = tw.timers[index];
+            callback(owner, fired);
+
+            // deleted in callback
+            if (tw.timers[index].generation != generation || tw.timers[index].status != timer_status::alive)
+                continue;
+
+            auto &t = tw.timers[index];
+            if (t.type == timer_type::periodic && t.list == timer_nil) {
+                t.deadline = tw.current + t.period;
+                schedule(tw, index);
+            } else if (t.list == timer_nil)
+                release(tw, index);
+        }
     }
 
-    auto create_timer(const timer_info &info) -> timer_instance* {
-        static int32_t timer_id = 1;
-        timer_instance t;
-        t.id = timer_id++;
+    auto update_all_timers(timer_wheel &tw, instance_t &owner, const float dt) -> void {
+        tw.accumulator += dt;
+
+        // half tick tolerance against float drift of accumulated fixed steps
+        while (tw.accumulator >= timer_resolution * 0.5f) {
+            tw.accumulator -= timer_resolution;
+            advance(tw, owner);
+        }
+    }
+
+    auto create_timer(timer_wheel &tw, const timer_info &info) -> timer_handle {
+        uint32_t index;
+
+        if (!tw.free_timers.empty()) {
+            index = tw.free_timers.back();
+            tw.free_timers.pop_back();
+        } else {
+            index = static_cast<uint32_t>(tw.timers.size());
+            tw.timers.emplace_back();
+        }
+
+        auto &t = tw.timers[index];
+        t.id = tw.next_id++;
         t.type = info.type;
         t.status = timer_status::alive;
         t.value = 0.f;
-        // TODO: can't be smaller then timestep
         t.stop_value = info.time_interval;
         t.callback = info.callback ? info.callback : default_on_time;
-        t.start = std::chrono::system_clock::now();
+        t.period = to_timer_ticks(info.time_interval);
+        t.deadline = tw.current + t.period;
 
-        timers.push_back(t);
+        schedule(tw, index);
+        tw.alive++;
 
         game::journal::debug(game::journal::_SCENE, "Create timer %", t.id);
 
-        return &timers.back();
+        return make_handle(index, t.generation);
+    }
+
+    auto delete_timer(timer_wheel &tw, const timer_handle h) -> bool {
+        const auto index = find_alive(tw, h);
+        if (index == timer_nil)
+            return false;
+
+        game::journal::debug(game::journal::_SCENE, "Destroy timer %", tw.timers[index].id);
+
+        release(tw, index);
+
+        return true;
     }
 
-    auto delete_timer(timer_instance *&t) -> void {
-        assert(t != NULL);
+    auto get_timer(timer_wheel &tw, const timer_handle h) -> timer_instance* {
+        const auto index = find_alive(tw, h);
+        if (index == timer_nil)
+            return nullptr;
 
-        /*size_t i = 0;
-        for (; i < timers.size(); i++)
-            if (t->id == timers[i].id)
-                break;*/
+        auto &t = tw.timers[index];
+        t.value = get_timer_elapsed(tw, t);
 
-        auto it = std::find_if(timers.begin(), timers.end(), [t](const timer_instance &tr) {
-            return tr.id == t->id;
-        });
+        return &t;
+    }
 
-        if (it == timers.end())
-            return;
+    // derived from deadline, wheel doesn't touch pending timers every tick
+    auto get_timer_elapsed(const timer_wheel &tw, const timer_instance &t) -> float {
+        const auto remaining = t.deadline > tw.current ? t.deadline - tw.current : 0;
 
-        game::journal::debug(game::journal::_SCENE, "Destroy timer %", t->id);
+        return std::max(t.stop_value - static_cast<float>(remaining) * timer_resolution, 0.f);
+    }
 
-        if (timers.size() > 1)
-            *it = timers.back();
+    auto reset_timer(timer_wheel &tw, const timer_handle h, const float remaining) -> bool {
+        const auto index = find_alive(tw, h);
+        if (index == timer_nil)
+            return false;
+
+        if (tw.timers[index].list != timer_nil)
+            unlink(tw, index);
+
+        tw.timers[index].deadline = tw.current + to_timer_ticks(remaining);
+        schedule(tw, index);
+
+        return true;
+    }
+
+    auto get_timer_handle(const timer_wheel &tw, const int32_t id) -> timer_handle {
+        for (uint32_t i = 0; i < tw.timers.size(); i++)
+            if (tw.timers[i].status == timer_status::alive && tw.timers[i].id == id)
+                return make_handle(i, tw.timers[i].generation);
+
+        return invalid_timer;
+    }
 
-        timers.pop_back();
-        t = nullptr;
+    auto for_each_timer(const timer_wheel &tw, const std::function<void(const timer_instance &)> &fn) -> void {
+        for (const auto &t : tw.timers)
+            if (t.status == timer_status::alive)
+                fn(t);
     }
 } // namespace scene
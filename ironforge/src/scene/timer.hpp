@@ -1,8 +1,11 @@
 #pragma once
 
+#include <algorithm>
+#include <array>
+#include <cmath>
 #include <functional>
-#include <chrono>
 #include <cstdint>
+#include <vector>
 
 namespace scene {
     enum class timer_type : uint32_t {
@@ -17,29 +20,80 @@ namespace scene {
 
     struct timer_instance;
 
+    struct instance_type;
+    typedef instance_type instance_t;
+
+    // scene of wheel that fired it, callbacks keep no pointers into scene that could move
+    using timer_callback = std::function<void(instance_t &, timer_instance &)>;
+
+    // callback gets a copy of fired timer, changes to it are dropped, use handle functions instead
     struct timer_info {
         timer_type type;
         float time_interval;
-        std::function<void(timer_instance &)> callback;
+        timer_callback callback;
     };
 
-    struct timer_instance {
-        std::chrono::time_point<std::chrono::system_clock> start = {};
-        std::chrono::time_point<std::chrono::system_clock> end = {};
+    // wheel ticks with fixed simulation step
+    constexpr float timer_resolution = 0.002f;
+    constexpr uint32_t timer_wheel_bits = 8;
+    constexpr uint32_t timer_wheel_slots = 1u << timer_wheel_bits;
+    constexpr uint32_t timer_wheel_levels = 4; // covers 2^32 ticks
+    constexpr uint32_t timer_nil = UINT32_MAX;
+
+    inline auto to_timer_ticks(const float seconds) -> uint64_t {
+        return std::max<uint64_t>(static_cast<uint64_t>(std::ceil(seconds / timer_resolution - 0.001f)), 1);
+    }
 
+    // index and generation, stale handles are rejected after removal
+    using timer_handle = uint64_t;
+    constexpr timer_handle invalid_timer = 0;
+
+    struct timer_instance {
         int32_t         id = 0;
         timer_type      type = timer_type::once;
         timer_status    status = timer_status::dead;
-        float           value = 0.f;
+        float           value = 0.f; // elapsed since start or last fire, updated before callback
         float           stop_value = 0.f;
-        std::function<void(timer_instance &)> callback;
+        timer_callback  callback;
+
+        // wheel internals
+        uint64_t        deadline = 0;
+        uint64_t        period = 0; // in ticks
+        uint32_t        generation = 1;
+        uint32_t        list = timer_nil;
+        uint32_t        prev = timer_nil;
+        uint32_t        next = timer_nil;
     };
 
-    auto init_all_timers() -> void;
-    auto cleanup_all_timers() -> void;
-    auto update_all_timers(const float dt) -> void;
+    ///
+    /// \brief Hierarchical timing wheel, O(1) create and delete, cost per tick depends only on fired timers
+    ///
+    struct timer_wheel {
+        timer_wheel();
+
+        std::vector<timer_instance> timers; // pool, dead entries are reused
+        std::vector<uint32_t>       free_timers;
+
+        // levels * slots wheel lists and one list of timers firing at current tick
+        std::array<uint32_t, timer_wheel_levels * timer_wheel_slots + 1> heads;
+
+        uint64_t    current = 0;
+        float       accumulator = 0.f;
+        int32_t     next_id = 1;
+        size_t      alive = 0;
+    };
+
+    auto cleanup_all_timers(timer_wheel &tw) -> void;
+    // owner is scene passed to callbacks
+    auto update_all_timers(timer_wheel &tw, instance_t &owner, const float dt) -> void;
+
+    auto create_timer(timer_wheel &tw, const timer_info &info) -> timer_handle;
+    auto delete_timer(timer_wheel &tw, const timer_handle h) -> bool;
+    auto get_timer(timer_wheel &tw, const timer_handle h) -> timer_instance*;
 
-    // NOTE: if timer_type == once, return pointer will be invalid after auto remove
-    auto create_timer(const timer_info &info) -> timer_instance*;
-    auto delete_timer(timer_instance *&t) -> void;
+    // reschedules alive timer to fire after remaining seconds, keeps its period
+    auto reset_timer(timer_wheel &tw, const timer_handle h, const float remaining) -> bool;
+    auto get_timer_handle(const timer_wheel &tw, const int32_t id) -> timer_handle;
+    auto get_timer_elapsed(const timer_wheel &tw, const timer_instance &t) -> float;
+    auto for_each_timer(const timer_wheel &tw, const std::function<void(const timer_instance &)> &fn) -> void;
 } // namespace scene
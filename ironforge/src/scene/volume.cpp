@@ -0,0 +1,66 @@
+#include <scene/volume.hpp>
+
+namespace scene {
+    auto make_frustum(const glm::mat4 &projection_view) -> frustum {
+        using namespace glm;
+
+        const auto row = [&projection_view] (const int i) {
+            return vec4{projection_view[0][i], projection_view[1][i], projection_view[2][i], projection_view[3][i]};
+        };
+
+        const auto r0 = row(0);
+        const auto r1 = row(1);
+        const auto r2 = row(2);
+        const auto r3 = row(3);
+
+        frustum f;
+        f.planes[0] = r3 + r0;
+        f.planes[1] = r3 - r0;
+        f.planes[2] = r3 + r1;
+        f.planes[3] = r3 - r1;
+        f.planes[4] = r3 + r2;
+        f.planes[5] = r3 - r2;
+
+        for (auto &p : f.planes) {
+            const auto len = length(vec3{p});
+            if (len > 0.f)
+                p /= len;
+        }
+
+        return f;
+    }
+
+    auto is_empty(const bound_box &box) noexcept -> bool {
+        return box.min == box.max;
+    }
+
+    auto transform_bound_box(const bound_box &box, const glm::mat4 &model) -> bound_box {
+        using namespace glm;
+
+        const auto center = (box.min + box.max) * 0.5f;
+        const auto extent = (box.max - box.min) * 0.5f;
+
+        const auto world_center = vec3{model * vec4{center, 1.f}};
+        const auto world_extent = abs(vec3{model[0]}) * extent.x + abs(vec3{model[1]}) * extent.y + abs(vec3{model[2]}) * extent.z;
+
+        return {world_center - world_extent, world_center + world_extent};
+    }
+
+    auto is_visible(const frustum &f, const bound_box &box) noexcept -> bool {
+        using namespace glm;
+
+        const auto center = (box.min + box.max) * 0.5f;
+        const auto extent = (box.max - box.min) * 0.5f;
+
+        for (const auto &p : f.planes) {
+            const auto n = vec3{p};
+            const auto d = dot(n, center) + p.w;
+            const auto r = dot(abs(n), extent);
+
+            if (d + r < 0.f)
+                return false;
+        }
+
+        return true;
+    }
+} // namespace scene
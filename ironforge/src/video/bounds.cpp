@@ -0,0 +1,99 @@
+#include <cmath>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#include <video/journal.hpp>
+#include <video/video.hpp>
+
+namespace video {
+
+    // NOTE: all vertex formats start with vec3 position and are bigger than 16 bytes,
+    // so four floats could be loaded from any vertex, the last lane is ignored
+    auto calc_vertices_bounds(const vertices_data &data, const vertices_desc &desc) -> vertices_bounds {
+        vertices_bounds bounds;
+
+        const auto stride = get_vertex_stride(desc.vf);
+        if (!data.vertices || data.vertices_num == 0 || stride == 0)
+            return bounds;
+
+        const auto base = static_cast<const char*>(data.vertices);
+        const auto num = data.vertices_num;
+
+#if defined(__SSE2__)
+        const auto xyz_mask = _mm_castsi128_ps(_mm_set_epi32(0, -1, -1, -1));
+
+        auto min0 = _mm_loadu_ps(reinterpret_cast<const float*>(base));
+        auto max0 = min0;
+        auto min1 = min0;
+        auto max1 = min0;
+
+        size_t i = 1;
+        for (; i + 1 < num; i += 2) {
+            const auto p0 = _mm_loadu_ps(reinterpret_cast<const float*>(base + stride * i));
+            const auto p1 = _mm_loadu_ps(reinterpret_cast<const float*>(base + stride * (i + 1)));
+
+            min0 = _mm_min_ps(min0, p0);
+            max0 = _mm_max_ps(max0, p0);
+            min1 = _mm_min_ps(min1, p1);
+            max1 = _mm_max_ps(max1, p1);
+        }
+
+        if (i < num) {
+            const auto p = _mm_loadu_ps(reinterpret_cast<const float*>(base + stride * i));
+            min0 = _mm_min_ps(min0, p);
+            max0 = _mm_max_ps(max0, p);
+        }
+
+        const auto vmin = _mm_min_ps(min0, min1);
+        const auto vmax = _mm_max_ps(max0, max1);
+        const auto vcenter = _mm_mul_ps(_mm_add_ps(vmin, vmax), _mm_set1_ps(0.5f));
+
+        alignas(16) float out[4];
+        _mm_store_ps(out, vmin);
+        bounds.min = glm::vec3{out[0], out[1], out[2]};
+        _mm_store_ps(out, vmax);
+        bounds.max = glm::vec3{out[0], out[1], out[2]};
+
+        auto max_dist = _mm_setzero_ps();
+        for (size_t j = 0; j < num; j++) {
+            auto d = _mm_sub_ps(_mm_loadu_ps(reinterpret_cast<const float*>(base + stride * j)), vcenter);
+            d = _mm_and_ps(_mm_mul_ps(d, d), xyz_mask);
+
+            const auto s = _mm_add_ps(d, _mm_movehl_ps(d, d));
+            max_dist = _mm_max_ss(max_dist, _mm_add_ss(s, _mm_shuffle_ps(s, s, 1)));
+        }
+
+        bounds.center = (bounds.min + bounds.max) * 0.5f;
+        bounds.radius = std::sqrt(_mm_cvtss_f32(max_dist));
+#else
+        const auto position = [base, stride] (const size_t ix) {
+            const auto p = reinterpret_cast<const float*>(base + stride * ix);
+            return glm::vec3{p[0], p[1], p[2]};
+        };
+
+        bounds.min = position(0);
+        bounds.max = bounds.min;
+
+        for (size_t i = 1; i < num; i++) {
+            const auto p = position(i);
+            bounds.min = glm::min(bounds.min, p);
+            bounds.max = glm::max(bounds.max, p);
+        }
+
+        bounds.center = (bounds.min + bounds.max) * 0.5f;
+
+        auto max_dist = 0.f;
+        for (size_t i = 0; i < num; i++) {
+            const auto d = position(i) - bounds.center;
+            max_dist = glm::max(max_dist, glm::dot(d, d));
+        }
+
+        bounds.radius = std::sqrt(max_dist);
+#endif
+
+        return bounds;
+    }
+
+} // namespace video
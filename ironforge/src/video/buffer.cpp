@@ -102,6 +102,14 @@ namespace video {
             glBindBuffer(buf.target, 0);
         }
 
+        auto bind_buffer_range(buffer &buf, const uint32_t index, const size_t offset, const size_t size) -> void {
+            glBindBufferRange(buf.target, index, buf.id, static_cast<GLintptr>(offset), static_cast<GLsizeiptr>(size));
+        }
+
+        auto bind_buffer_base(buffer &buf, const uint32_t index) -> void {
+            glBindBufferBase(buf.target, index, buf.id);
+        }
+
         auto update_buffer(buffer &buf, const size_t offset, const void *data, const size_t size) -> void {
             glBindBuffer(buf.target, buf.id);
             glBufferSubData(buf.target, static_cast<GLintptr>(offset), static_cast<GLsizeiptr>(size), data);
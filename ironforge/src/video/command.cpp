@@ -7,8 +7,8 @@ namespace video {
 
         namespace detail {
 
-            bind_uniform::bind_uniform(const program &p, const std::string_view name, const glm::mat4 &m)
-                : location{get_uniform_location(p, name)},
+            bind_uniform::bind_uniform(const uniform_handle u, const glm::mat4 &m)
+                : location{u.location},
                   type{GL_FLOAT_MAT4},
                   size{sizeof m},
                   offset{0}, // calculated later
@@ -17,8 +17,8 @@ namespace video {
             {
             }
 
-            bind_uniform::bind_uniform(const program &p, const std::string_view name, const glm::mat3 &m)
-                : location{get_uniform_location(p, name)},
+            bind_uniform::bind_uniform(const uniform_handle u, const glm::mat3 &m)
+                : location{u.location},
                   type{GL_FLOAT_MAT3},
                   size{sizeof m},
                   offset{0}, // calculated later
@@ -27,8 +27,8 @@ namespace video {
             {
             }
 
-            bind_uniform::bind_uniform(const program &p, const std::string_view name, const float &value)
-                : location{get_uniform_location(p, name)},
+            bind_uniform::bind_uniform(const uniform_handle u, const float &value)
+                : location{u.location},
                   type{GL_FLOAT},
                   size{sizeof value},
                   offset{0}, // calculated later
@@ -37,8 +37,8 @@ namespace video {
             {
             }
 
-            bind_uniform::bind_uniform(const program &p, const std::string_view name, const glm::vec2 &value)
-                : location{get_uniform_location(p, name)},
+            bind_uniform::bind_uniform(const uniform_handle u, const glm::vec2 &value)
+                : location{u.location},
                   type{GL_FLOAT_VEC2},
                   size{sizeof value},
                   offset{0}, // calculated later
@@ -47,8 +47,8 @@ namespace video {
             {
             }
 
-            bind_uniform::bind_uniform(const program &p, const std::string_view name, const glm::vec3 &value)
-                : location{get_uniform_location(p, name)},
+            bind_uniform::bind_uniform(const uniform_handle u, const glm::vec3 &value)
+                : location{u.location},
                   type{GL_FLOAT_VEC3},
                   size{sizeof value},
                   offset{0}, // calculated later
@@ -57,8 +57,8 @@ namespace video {
             {
             }
 
-            bind_uniform::bind_uniform(const program &p, const std::string_view name, const glm::vec4 &value)
-                : location{get_uniform_location(p, name)},
+            bind_uniform::bind_uniform(const uniform_handle u, const glm::vec4 &value)
+                : location{u.location},
                   type{GL_FLOAT_VEC4},
                   size{sizeof value},
                   offset{0}, // calculated later
@@ -67,8 +67,8 @@ namespace video {
             {
             }
 
-            bind_uniform::bind_uniform(const program &p, const std::string_view name, const int &value)
-                : location{get_uniform_location(p, name)},
+            bind_uniform::bind_uniform(const uniform_handle u, const int &value)
+                : location{u.location},
                   type{GL_INT},
                   size{sizeof value},
                   offset{0}, // calculated later
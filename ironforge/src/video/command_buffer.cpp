@@ -1,3 +1,7 @@
+#include <array>
+#include <cstddef>
+#include <unordered_map>
+
 #include <glcore_330.h>
 #include <video/journal.hpp>
 #include <video/video.hpp>
@@ -46,6 +50,9 @@ namespace video {
 
         inline auto dispath_uniform(command_buffer &buf, uint32_t offset, int32_t location, uint32_t type, uint32_t count) -> void {
             switch (type) {
+            case GL_INT:
+                glUniform1iv(location, static_cast<GLsizei>(count), reinterpret_cast<const int32_t*>(static_cast<const char*>(buf.raw_memory) + offset));
+                break;
             case GL_UNSIGNED_INT:
                 glUniform1uiv(location, static_cast<GLsizei>(count), reinterpret_cast<const uint32_t*>(static_cast<const char*>(buf.raw_memory) + offset));
                 break;
@@ -70,6 +77,75 @@ namespace video {
             }
         }
 
+        constexpr uint32_t max_cached_units = 32;
+        constexpr uint32_t unknown_object = ~0u;
+
+        // objects bound by dispatch, binds of already bound object are skipped
+        struct dispatch_cache {
+            uint32_t                                            program = unknown_object;
+            uint32_t                                            vertex_array = unknown_object;
+            uint32_t                                            active_unit = unknown_object;
+            std::array<std::pair<uint32_t, uint32_t>, max_cached_units> textures; // target, texture
+            std::array<uint32_t, max_cached_units>              samplers;
+            std::unordered_map<uint64_t, uint32_t>              sampler_units; // program << 32 | location
+        };
+
+        static dispatch_cache bound;
+
+        auto reset_dispatch_cache() -> void {
+            bound.program = unknown_object;
+            bound.vertex_array = unknown_object;
+            bound.active_unit = unknown_object;
+            bound.textures.fill({unknown_object, unknown_object});
+            bound.samplers.fill(unknown_object);
+            bound.sampler_units.clear();
+        }
+
+        // true when value differs from cached one, cache is updated
+        template <typename T>
+        inline auto change_state(T &cached, const T &value) -> bool {
+            if (cached == value) {
+                stats_inc_state_skips();
+                return false;
+            }
+
+            stats_inc_state_changes();
+            cached = value;
+
+            return true;
+        }
+
+        inline auto bind_cached_texture(const detail::bind_texture &arg) -> void {
+            if (arg.unit >= max_cached_units) {
+                stats_inc_tex_bindings();
+                stats_inc_state_changes();
+
+                glActiveTexture(GL_TEXTURE0 + arg.unit);
+                glBindTexture(arg.target, arg.texture);
+                bound.active_unit = arg.unit;
+            } else if (change_state(bound.textures[arg.unit], {arg.target, arg.texture})) {
+                stats_inc_tex_bindings();
+
+                if (change_state(bound.active_unit, arg.unit))
+                    glActiveTexture(GL_TEXTURE0 + arg.unit);
+
+                glBindTexture(arg.target, arg.texture);
+            }
+
+            // sampler uniform is program state, usually same unit every time
+            if (arg.location < 0)
+                return;
+
+            const auto key = static_cast<uint64_t>(bound.program) << 32 | static_cast<uint32_t>(arg.location);
+            auto [it, inserted] = bound.sampler_units.try_emplace(key, arg.unit);
+            if (inserted || change_state(it->second, arg.unit)) {
+                if (inserted)
+                    stats_inc_state_changes();
+
+                glUniform1i(arg.location, static_cast<GLint>(arg.unit));
+            }
+        }
+
         template<class... Ts> struct overloaded : Ts... { using Ts::operator()...; };
         template<class... Ts> overloaded(Ts...) -> overloaded<Ts...>;
 
@@ -80,38 +156,59 @@ namespace video {
                 if constexpr (std::is_same_v<T, detail::clear>) {
                     glClearColor(buf.clear_color.x, buf.clear_color.y, buf.clear_color.z, buf.clear_color.w);
                     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT);
+                } else if constexpr (std::is_same_v<T, detail::clear_depth>) {
+                    glClear(GL_DEPTH_BUFFER_BIT);
                 } else if constexpr (std::is_same_v<T, detail::viewport>) {
                     glViewport(arg.x, arg.y, arg.w, arg.h);
                 } else if constexpr (std::is_same_v<T, detail::draw_arrays>) {
                     stats_inc_dips();
-                    stats_add_tris(arg.count);
-                    glDrawArrays(arg.mode, static_cast<GLint>(arg.first), static_cast<GLsizei>(arg.count));
-                    // TODO: instanced
-                    // glDrawArraysInstanced(arg.mode, arg.first, arg.count, arg.primcount);
+                    stats_add_tris(arg.count * arg.primcount);
+
+                    if (arg.primcount > 1)
+                        glDrawArraysInstanced(arg.mode, static_cast<GLint>(arg.first), static_cast<GLsizei>(arg.count), static_cast<GLsizei>(arg.primcount));
+                    else
+                        glDrawArrays(arg.mode, static_cast<GLint>(arg.first), static_cast<GLsizei>(arg.count));
                 } else if constexpr (std::is_same_v<T, detail::draw_elements>) {
                     stats_inc_dips();
-                    stats_add_tris(arg.count);
-                    glDrawElementsBaseVertex(arg.mode, static_cast<GLsizei>(arg.count), GL_UNSIGNED_SHORT, nullptr, static_cast<GLint>(arg.base_vertex));
+                    stats_add_tris(arg.count * arg.primcount);
 
-                    // TODO: instanced
-                    // glDrawElementsInstancedBaseVertex(arg.mode, arg.count, GL_UNSIGNED_SHORT, nullptr, arg.primcount, arg.base_vertex);
+                    if (arg.primcount > 1)
+                        glDrawElementsInstancedBaseVertex(arg.mode, static_cast<GLsizei>(arg.count), GL_UNSIGNED_SHORT, nullptr, static_cast<GLsizei>(arg.primcount), static_cast<GLint>(arg.base_vertex));
+                    else
+                        glDrawElementsBaseVertex(arg.mode, static_cast<GLsizei>(arg.count), GL_UNSIGNED_SHORT, nullptr, static_cast<GLint>(arg.base_vertex));
                 } else if constexpr (std::is_same_v<T, detail::bind_framebuffer>) {
                     glBindFramebuffer(GL_FRAMEBUFFER, arg.id);
                 } else if constexpr (std::is_same_v<T, detail::bind_program>) {
-                    stats_inc_prg_bindings();
+                    if (change_state(bound.program, arg.id)) {
+                        stats_inc_prg_bindings();
 
-                    glUseProgram(arg.id);
+                        glUseProgram(arg.id);
+                    }
                 } else if constexpr (std::is_same_v<T, detail::bind_texture>) {
-                    stats_inc_tex_bindings();
-
-                    glActiveTexture(GL_TEXTURE0 + arg.unit);
-                    glBindTexture(arg.target, arg.texture);
-
-                    glUniform1i(arg.location, static_cast<GLint>(arg.unit));
+                    bind_cached_texture(arg);
                 } else if constexpr (std::is_same_v<T, detail::bind_sampler>) {
-                    glBindSampler(arg.unit, arg.id);
+                    if (arg.unit >= max_cached_units || change_state(bound.samplers[arg.unit], arg.id))
+                        glBindSampler(arg.unit, arg.id);
                 } else if constexpr (std::is_same_v<T, detail::bind_vertex_array>) {
-                    glBindVertexArray(arg.id);
+                    if (change_state(bound.vertex_array, arg.id))
+                        glBindVertexArray(arg.id);
+                } else if constexpr (std::is_same_v<T, detail::bind_instances>) {
+                    // no base instance in 3.3, so pointers are moved to the batch instead
+                    constexpr auto stride = static_cast<GLsizei>(sizeof(instance_attributes));
+
+                    glBindBuffer(GL_ARRAY_BUFFER, arg.buf);
+
+                    for (uint32_t i = 0; i < 4; i++) {
+                        glEnableVertexAttribArray(instance_model_location + i);
+                        glVertexAttribPointer(instance_model_location + i, 4, GL_FLOAT, GL_FALSE, stride, reinterpret_cast<const void*>(arg.offset + sizeof(glm::vec4) * i));
+                        glVertexAttribDivisor(instance_model_location + i, 1);
+                    }
+
+                    glEnableVertexAttribArray(instance_material_location);
+                    glVertexAttribIPointer(instance_material_location, 1, GL_INT, stride, reinterpret_cast<const void*>(arg.offset + offsetof(instance_attributes, material)));
+                    glVertexAttribDivisor(instance_material_location, 1);
+                } else if constexpr (std::is_same_v<T, detail::bind_buffer_range>) {
+                    glBindBufferRange(arg.target, arg.index, arg.buf, static_cast<GLintptr>(arg.offset), static_cast<GLsizeiptr>(arg.size));
                 } else if constexpr (std::is_same_v<T, detail::bind_uniform>) {
                     dispath_uniform(buf, arg.offset, arg.location, arg.type, arg.count);
                 } else if constexpr (std::is_same_v<T, detail::update>) {
@@ -130,6 +227,10 @@ namespace video {
         }
 
         auto operator <<(command_buffer &cb, const detail::bind_uniform &c) -> command_buffer& {
+            // program doesn't use it
+            if (c.location < 0)
+                return cb;
+
             auto cc = c;
             if (cb.raw_memory) {
                 size_t sz = get_uniform_type_size(c.type) * c.count;
@@ -92,6 +92,31 @@ namespace video {
             return static_cast<int32_t>(p.uniforms.size());
         }
 
+        static auto get_program_uniform_blocks(program &p) -> int32_t {
+            int total = -1;
+            glGetProgramiv(p.pid, GL_ACTIVE_UNIFORM_BLOCKS, &total);
+
+            if (total < 0)
+                return -1;
+
+            p.uniform_blocks.reserve(static_cast<size_t>(total));
+
+            char name[1024] = {};
+            int name_len = -1, size = 0;
+            for (auto i = 0; i < total; i++) {
+                glGetActiveUniformBlockName(p.pid, static_cast<GLuint>(i), sizeof(name) - 1, &name_len, name);
+                glGetActiveUniformBlockiv(p.pid, static_cast<GLuint>(i), GL_UNIFORM_BLOCK_DATA_SIZE, &size);
+
+                if (name_len > 0) {
+                    p.uniform_blocks.push_back({name, utils::xxhash64(name, static_cast<size_t>(name_len)), static_cast<uint32_t>(i), size});
+
+                    journal::debug("-b- % %", p.uniform_blocks.back().name, p.uniform_blocks.back().size);
+                }
+            }
+
+            return static_cast<int32_t>(p.uniform_blocks.size());
+        }
+
         auto create_program(const program_info &info) -> program {
             const auto pid = glCreateProgram();
 
@@ -129,6 +154,7 @@ namespace video {
 
             get_program_uniforms(p);
             get_program_attributes(p);
+            get_program_uniform_blocks(p);
 
             return p;
         }
@@ -158,7 +184,41 @@ namespace video {
             return -1;
         }
 
+        auto get_uniform(const program &pro, const std::string_view name) -> uniform_handle {
+            const auto hash = utils::xxhash64(name.data(), name.size());
+
+            auto it = std::find_if(pro.uniforms.begin(), pro.uniforms.end(), [name_hash = hash](const auto &u) {
+                return u.name_hash == name_hash;
+            });
+
+            return {it != pro.uniforms.end() ? it->location : -1};
+        }
+
+        auto get_attribute_location(const program &pro, const std::string_view name) -> int32_t {
+            const auto hash = utils::xxhash64(name.data(), name.size());
+
+            auto it = std::find_if(pro.attributes.begin(), pro.attributes.end(), [name_hash = hash](const auto &a) {
+                return a.name_hash == name_hash;
+            });
+
+            return it != pro.attributes.end() ? it->location : -1;
+        }
+
+        auto bind_uniform_block(const program &pro, const std::string_view name, const uint32_t binding) -> bool {
+            const auto hash = utils::xxhash64(name.data(), name.size());
+
+            auto it = std::find_if(pro.uniform_blocks.begin(), pro.uniform_blocks.end(), [name_hash = hash](const auto &b) {
+                return b.name_hash == name_hash;
+            });
+
+            if (it == pro.uniform_blocks.end())
+                return false;
+
+            glUniformBlockBinding(pro.pid, it->index, binding);
+
+            return true;
+        }
+
     } // namespace gl330
 
 } // namespace video
-
@@ -106,91 +106,69 @@ namespace video {
         return make_texture_2d({}, data);
     }*/
 
-    auto create_texture(assets::instance_t &asset, instance_t &inst, const json &info) -> texture {
+    auto read_texture(assets::instance_t &asset, const uint32_t texture_level, const json &info) -> std::optional<texture_data> {
         using namespace game;
         using namespace std;
 
-        auto textures_flags = static_cast<uint32_t>(video::texture_flags::auto_mipmaps);
-
-        switch (inst.texture_filter) {
-        case texture_filtering::bilinear:
-            break;
-        case texture_filtering::trilinear:
-        case texture_filtering::anisotropic:
-            textures_flags |= static_cast<uint32_t>(texture_flags::auto_mipmaps);
-            break;
-        default:
-            break;
-        }
-
-        const auto name = info.find("name") != info.end() ? info["name"].get<string>() : string{};
+        texture_data data;
+        data.name = info.find("name") != info.end() ? info["name"].get<string>() : string{};
         const auto type = info.find("type") != info.end() ? info["type"].get<string>() : string{};
 
-        if (auto it = inst.textures.find(name); it != inst.textures.end())
-            return it->second;
-
         if (type == "2d") {
             const auto levels = info.find("levels") != info.end() ? info["levels"].get<vector<string>>() : vector<string>{};
 
             if (levels.empty()) {
-                journal::error("No levels for texture %", name);
+                journal::error("No levels for texture %", data.name);
                 return {};
             }
 
-            const auto texture_name = levels.size() < inst.texture_level ? levels.back() : levels[inst.texture_level];
+            const auto texture_name = levels.size() < texture_level ? levels.back() : levels[texture_level];
 
             auto imd = assets::get_image(asset, texture_name);
 
             if (!imd) {
-                journal::warning("Texture % not found '%'", name, texture_name);
+                journal::warning("Texture % not found '%'", data.name, texture_name);
                 return {};
             }
 
-            auto tex = gl::create_texture_2d(imd.value(), textures_flags);
-            inst.textures.emplace(name, tex);
-
-            journal::info("Create texture '%'", name);
+            data.images.push_back(std::move(imd.value()));
 
-            return tex;
+            return data;
         }
 
         if (type == "cubemap") {
             const auto levels = info.find("levels") != info.end() ? info["levels"].get<vector<vector<string>>>() : vector<vector<string>>{};
 
             if (levels.empty()) {
-                journal::error("No levels for texture %", name);
+                journal::error("No levels for texture %", data.name);
                 return {};
             }
 
-            const auto level = levels.size() < inst.texture_level ? levels.back() : levels[inst.texture_level];
+            const auto level = levels.size() < texture_level ? levels.back() : levels[texture_level];
 
             if (level.empty()) {
-                journal::error("No levels for texture %", name);
+                journal::error("No levels for texture %", data.name);
                 return {};
             }
 
             if (level.size() != 6) {
-                journal::error("Not enough sides for texture %", name);
+                journal::error("Not enough sides for texture %", data.name);
                 return {};
             }
 
-            image_data images[6];
+            data.cubemap = true;
+            data.images.resize(6);
 
             for (size_t i = 0; i < 6; i++) {
                 auto img = assets::get_image(asset, level[i]);
 
                 if (img)
-                    images[i] = img.value();
+                    data.images[i] = img.value();
 
                 // TODO: make error
             }
 
-            auto tex = gl::create_texture_cube(images, textures_flags);
-            inst.textures.emplace(name, tex);
-
-            journal::info("Create texture '%'", name);
-
-            return tex;
+            return data;
         }
 
         journal::error("Unknown texture type '%'", type);
@@ -198,53 +176,119 @@ namespace video {
         return {};
     }
 
-    auto create_program(assets::instance_t &asset, instance_t &inst, const json &info) -> program {
+    auto upload_texture(instance_t &vi, const texture_data &data) -> texture {
         using namespace game;
+
+        if (auto it = vi.textures.find(data.name); it != vi.textures.end())
+            return it->second;
+
+        auto textures_flags = static_cast<uint32_t>(video::texture_flags::auto_mipmaps);
+
+        switch (vi.texture_filter) {
+        case texture_filtering::bilinear:
+            break;
+        case texture_filtering::trilinear:
+        case texture_filtering::anisotropic:
+            textures_flags |= static_cast<uint32_t>(texture_flags::auto_mipmaps);
+            break;
+        default:
+            break;
+        }
+
+        texture tex;
+
+        if (data.cubemap) {
+            if (data.images.size() != 6)
+                return {};
+
+            image_data images[6];
+            std::copy(data.images.begin(), data.images.end(), std::begin(images));
+
+            tex = gl::create_texture_cube(images, textures_flags);
+        } else {
+            if (data.images.empty())
+                return {};
+
+            tex = gl::create_texture_2d(data.images.front(), textures_flags);
+        }
+
+        vi.textures.emplace(data.name, tex);
+
+        journal::info("Create texture '%'", data.name);
+
+        return tex;
+    }
+
+    auto create_texture(assets::instance_t &asset, instance_t &inst, const json &info) -> texture {
         using namespace std;
 
         const auto name = info.find("name") != info.end() ? info["name"].get<string>() : string{};
-        const auto programs = info.find("programs") != info.end() ? info["programs"].get<vector<string>>() : vector<string>{};
 
-        if (!programs.empty()) {
-            std::vector<gl::shader_source> sources;
+        if (auto it = inst.textures.find(name); it != inst.textures.end())
+            return it->second;
 
-            for (const auto &p : programs) {
-                auto ps = assets::get_text(asset, p);
+        const auto data = read_texture(asset, inst.texture_level, info);
 
-                if (!ps)
-                    continue;
+        return data ? upload_texture(inst, data.value()) : texture{};
+    }
 
-                gl::shader_source source;
-                source.name = p;
-                source.text = ps.value();
+    auto read_program(assets::instance_t &asset, const json &info) -> std::optional<gl::program_info> {
+        using namespace game;
+        using namespace std;
 
-                sources.push_back(source);
-            }
+        const auto name = info.find("name") != info.end() ? info["name"].get<string>() : string{};
+        const auto programs = info.find("programs") != info.end() ? info["programs"].get<vector<string>>() : vector<string>{};
 
-            if (!sources.empty()) {
-                gl::program_info pi;
-                pi.name = name;
-                pi.sources = sources;
+        if (programs.empty()) {
+            journal::error("Empty shader programs '%'", name);
+            return {};
+        }
 
-                auto p = gl::create_program(pi);
-                inst.programs.emplace(name, p);
+        gl::program_info pi;
+        pi.name = name;
 
-                journal::info("Create program '%'", name);
+        for (const auto &p : programs) {
+            auto ps = assets::get_text(asset, p);
 
-                return p;
-            }
+            if (!ps)
+                continue;
 
-            journal::error("Empty shader sources '%'", name);
+            gl::shader_source source;
+            source.name = p;
+            source.text = ps.value();
 
+            pi.sources.push_back(source);
+        }
+
+        if (pi.sources.empty()) {
+            journal::error("Empty shader sources '%'", name);
             return {};
         }
 
-        journal::error("Empty shader programs '%'", name);
+        return pi;
+    }
 
-        return {};
+    auto upload_program(instance_t &vi, const gl::program_info &info) -> program {
+        using namespace game;
+
+        if (auto it = vi.programs.find(info.name); it != vi.programs.end())
+            return it->second;
+
+        auto p = gl::create_program(info);
+        vi.programs.emplace(info.name, p);
+
+        journal::info("Create program '%'", info.name);
+
+        return p;
+    }
+
+    auto create_program(assets::instance_t &asset, instance_t &inst, const json &info) -> program {
+        const auto pi = read_program(asset, info);
+
+        return pi ? upload_program(inst, pi.value()) : program{};
     }
 
-    static auto create_vertices_info(assets::instance_t &asset, const json &info) -> std::optional<vertices_info> {
+    auto create_vertices_info(assets::instance_t &asset, const json &info) -> std::optional<vertices_info> {
         (void)asset;
 
         using namespace game;
@@ -294,6 +338,18 @@ namespace video {
         return {};
     }
 
+    auto upload_mesh(instance_t &vi, const vertices_info &info) -> mesh {
+        mesh m;
+        std::vector<vertices_draw> draws;
+
+        m.desc = info.desc;
+        m.source = make_vertices_source(vi, {info.data}, info.desc, draws);
+        m.draw = draws[0];
+        m.bounds = info.bounds;
+
+        return m;
+    }
+
     auto create_mesh(assets::instance_t &asset, instance_t &vi, const json &info) -> std::optional<mesh> {
         using namespace game;
         using namespace std;
@@ -306,18 +362,45 @@ namespace video {
             return {};
         }
 
-        mesh m;
-        std::vector<vertices_draw> draws;
-
-        m.desc = vsi.value().desc;
-        m.source = make_vertices_source(vi, {vsi.value().data}, vsi.value().desc, draws);
-        m.draw = draws[0];
+        auto m = upload_mesh(vi, vsi.value());
 
         journal::info("Create mesh '%'", type);
 
         return m;
     }
 
+    auto destroy_texture(instance_t &vi, const std::string &name) -> void {
+        auto it = vi.textures.find(name);
+        if (it == vi.textures.end())
+            return;
+
+        journal::debug("Destroy texture %", name);
+        gl::destroy_texture(it->second);
+        vi.textures.erase(it);
+    }
+
+    auto destroy_mesh(instance_t &vi, mesh &m) -> void {
+        auto destroy_tracked_buffer = [&vi] (gl::buffer &buf) {
+            if (buf.id == 0)
+                return;
+
+            vi.buffers.erase(std::remove_if(vi.buffers.begin(), vi.buffers.end(), [id = buf.id] (const auto &b) {
+                return b.id == id;
+            }), vi.buffers.end());
+
+            gl::destroy_buffer(buf);
+        };
+
+        destroy_tracked_buffer(m.source.vertices);
+        destroy_tracked_buffer(m.source.elements);
+
+        vi.arrays.erase(std::remove_if(vi.arrays.begin(), vi.arrays.end(), [id = m.source.array.id] (const auto &a) {
+            return a.id == id;
+        }), vi.arrays.end());
+
+        gl::destroy_vertex_array(m.source.array);
+    }
+
     auto make_texture_2d(instance_t &vi, const std::string &name, const image_data &data, const uint32_t flags) -> texture {
         auto tex = gl::create_texture_2d(data, flags);
         vi.textures.emplace(name, tex);
@@ -1,3 +1,5 @@
+#include <algorithm>
+
 #include <glcore_330.h>
 #include <video/sprite_batch.hpp>
 #include <video/commands.hpp>
@@ -12,10 +14,13 @@ namespace video {
         sb.sprites_count = 0;
         sb.tex = info.tex;
 
+        // indices are shared by all draws of batch
+        const auto indexed_sprites = std::min(info.max_sprites, max_sprites_per_draw);
+
         sb.vertices.reserve(info.max_sprites * 4);
-        sb.indices.reserve(info.max_sprites * 6);
+        sb.indices.reserve(indexed_sprites * 6);
 
-        for (size_t i = 0; i < info.max_sprites; i++)
+        for (size_t i = 0; i < indexed_sprites; i++)
         {
             const auto index = static_cast<uint16_t>(i);
 
@@ -35,7 +40,7 @@ namespace video {
         desc.vf = vertex_format::v3t2c4;
         desc.ef = index_format::ui16;
         desc.vb_usage = static_cast<uint32_t>(gl::buffer_usage::dynamic_draw);
-        data.push_back({nullptr, &sb.indices[0], info.max_sprites * 6, info.max_sprites * 4});
+        data.push_back({nullptr, &sb.indices[0], info.max_sprites * 4, indexed_sprites * 6});
 
         sb.source = make_vertices_source(vi, data, desc, draws);
 
@@ -70,21 +75,64 @@ namespace video {
         append_sprite_vertices(sb, vertices);
     }
 
+    auto map_sprites(sprite_batch &sb, const uint32_t count) -> v3t2c4* {
+        if (count == 0 || sb.sprites_count + count > sb.max_sprites)
+            return nullptr;
+
+        const auto first = sb.vertices.size();
+        sb.vertices.resize(first + count * 4);
+        sb.sprites_count += count;
+
+        return sb.vertices.data() + first;
+    }
+
     auto submit_sprite_batch(gl::command_buffer &cb, sprite_batch &sb, const gl::program &pm, const gl::sampler &sr) -> void {
-        cb << vcs::update{sb.source.vertices, 0, &sb.vertices[0], sb.vertices.size() * sizeof (sb.vertices[0])};
+        if (sb.sprites_count == 0)
+            return;
+
+        update_sprite_batch(cb, sb);
+        submit_sprite_range(cb, sb, pm, sr, 0, sb.sprites_count);
+        clear_sprite_batch(sb);
+    }
+
+    auto update_sprite_batch(gl::command_buffer &cb, sprite_batch &sb) -> void {
+        if (sb.sprites_count == 0)
+            return;
+
+        sb.sprites_count = std::min(sb.sprites_count, sb.max_sprites);
+
+        cb << vcs::update{sb.source.vertices, 0, &sb.vertices[0], sb.sprites_count * 4 * sizeof (sb.vertices[0])};
+    }
+
+    auto submit_sprite_range(gl::command_buffer &cb, sprite_batch &sb, const gl::program &pm, const gl::sampler &sr, const uint32_t first, const uint32_t count) -> void {
+        const auto last = std::min(first + count, sb.sprites_count);
+        if (first >= last)
+            return;
+
+        if (sb.program != pm.pid) {
+            sb.program = pm.pid;
+            sb.color_map = gl::get_uniform(pm, "color_map");
+        }
 
         cb << vcs::bind_program{pm};
-        cb << vcs::bind_texture{pm, "color_map", 0, sb.tex};
+        cb << vcs::bind_texture{sb.color_map, 0, sb.tex};
         cb << vcs::bind_sampler{0, sr};
         cb << vcs::bind_vertex_array{sb.source.array};
 
-        vertices_draw draw;
-        memset(&draw, 0, sizeof draw);
-        draw.mode = GL_TRIANGLES;
-        draw.base_vertex = 0;
-        draw.count = sb.sprites_count * 6;
-        cb << vcs::draw_elements{draw};
+        for (auto offset = first; offset < last; offset += max_sprites_per_draw) {
+            vertices_draw draw;
+            memset(&draw, 0, sizeof draw);
+            draw.mode = GL_TRIANGLES;
+            draw.count = std::min(last - offset, max_sprites_per_draw) * 6;
+
+            vcs::draw_elements de{draw};
+            de.base_vertex = offset * 4;
+            cb << de;
+        }
+    }
 
+    // vertices keep their memory, update commands read it when buffer is executed
+    auto clear_sprite_batch(sprite_batch &sb) -> void {
         sb.sprites_count = 0;
         sb.vertices.clear();
     }
@@ -11,6 +11,12 @@ namespace video {
             stats.tris = 0;
             stats.tex_bindings = 0;
             stats.prg_bindings = 0;
+            stats.state_changes = 0;
+            stats.state_skips = 0;
+            stats.culled = 0;
+            stats.occluded = 0;
+            memset(stats.lods, 0, sizeof stats.lods);
+            stats.particles_ms = 0.f;
         }
 
         auto update(drawing_info &stats, const float dt) -> void {
@@ -20,8 +26,9 @@ namespace video {
                 // per time info
                 // ...
 
-                const auto n_chars = snprintf(stats.info, sizeof stats.info, "DIPs/frame %d\nTriangles %d\nTex bindings %d\nPrg bindings %d",
-                                              stats.dips, stats.tris, stats.tex_bindings, stats.prg_bindings);
+                const auto n_chars = snprintf(stats.info, sizeof stats.info, "DIPs/frame %d\nTriangles %d\nTex bindings %d\nPrg bindings %d\nBinds %d/%d skipped\nCulled %d\nOccluded %d\nLODs %d/%d/%d/%d\nParticles %.2f ms",
+                                              stats.dips, stats.tris, stats.tex_bindings, stats.prg_bindings, stats.state_changes, stats.state_skips, stats.culled, stats.occluded,
+                                              stats.lods[0], stats.lods[1], stats.lods[2], stats.lods[3], static_cast<double>(stats.particles_ms));
 
                 if (n_chars > 0)
                     stats.info_size = static_cast<size_t>(n_chars);
@@ -42,8 +42,13 @@ namespace video {
     auto submit_triangles_batch(gl::command_buffer &cb, triangles_batch &tb, const gl::program &pm, const gl::sampler &sr) -> void {
         cb << vcs::update{tb.source.vertices, 0, &tb.vertices[0], tb.vertices.size() * sizeof (tb.vertices[0])};
 
+        if (tb.program != pm.pid) {
+            tb.program = pm.pid;
+            tb.color_map = gl::get_uniform(pm, "color_map");
+        }
+
         cb << vcs::bind_program{pm};
-        cb << vcs::bind_texture{pm, "color_map", 0, tb.tex};
+        cb << vcs::bind_texture{tb.color_map, 0, tb.tex};
         cb << vcs::bind_sampler{0, sr};
         cb << vcs::bind_vertex_array{tb.source.array};
 
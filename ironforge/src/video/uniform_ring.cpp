@@ -0,0 +1,71 @@
+#include <algorithm>
+#include <cstring>
+
+#include <glcore_330.h>
+#include <video/journal.hpp>
+#include <video/uniform_ring.hpp>
+
+namespace video {
+
+    namespace gl330 {
+
+        auto create_uniform_ring(const size_t region_size) -> uniform_ring {
+            uniform_ring ring;
+
+            GLint alignment = 0;
+            glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+            if (alignment > 0)
+                ring.alignment = static_cast<size_t>(alignment);
+
+            ring.region_size = aligned_uniform_size(ring, region_size);
+            ring.buf = create_buffer(buffer_target::uniform, ring.region_size * uniform_ring_frames, nullptr, buffer_usage::stream_draw);
+            ring.staging.reserve(ring.region_size);
+
+            return ring;
+        }
+
+        auto destroy_uniform_ring(uniform_ring &ring) -> void {
+            destroy_buffer(ring.buf);
+            ring.region_size = 0;
+            ring.staging.clear();
+        }
+
+        auto begin_uniform_frame(uniform_ring &ring, const size_t size) -> void {
+            ring.frame = (ring.frame + 1) % uniform_ring_frames;
+            ring.staging.clear();
+
+            if (size <= ring.region_size)
+                return;
+
+            // new storage, regions in flight keep old one
+            ring.region_size = aligned_uniform_size(ring, std::max(size, ring.region_size * 2));
+            destroy_buffer(ring.buf);
+            ring.buf = create_buffer(buffer_target::uniform, ring.region_size * uniform_ring_frames, nullptr, buffer_usage::stream_draw);
+
+            journal::debug("Uniform ring grows to % bytes per frame", ring.region_size);
+        }
+
+        auto push_uniforms(uniform_ring &ring, const void *data, const size_t size) -> size_t {
+            const auto offset = aligned_uniform_size(ring, ring.staging.size());
+
+            if (offset + size > ring.region_size) {
+                journal::warning("Uniform ring region % bytes overflow", ring.region_size);
+                return ring.region_size * ring.frame;
+            }
+
+            ring.staging.resize(offset + size);
+            std::memcpy(ring.staging.data() + offset, data, size);
+
+            return ring.region_size * ring.frame + offset;
+        }
+
+        auto upload_uniform_frame(uniform_ring &ring) -> void {
+            if (ring.staging.empty())
+                return;
+
+            update_buffer(ring.buf, ring.region_size * ring.frame, ring.staging.data(), ring.staging.size());
+        }
+
+    } // namespace gl330
+
+} // namespace video
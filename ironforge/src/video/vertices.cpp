@@ -0,0 +1,81 @@
+#include <cstring>
+
+#include <glcore_330.h>
+#include <video/journal.hpp>
+#include <video/video.hpp>
+
+namespace video {
+    auto get_vertex_stride(const vertex_format vf) -> size_t {
+        switch (vf) {
+        case vertex_format::v3t2n3:
+            return sizeof(v3t2n3);
+        case vertex_format::v3t2c4:
+            return sizeof(v3t2c4);
+        case vertex_format::v3t2n3t3:
+            return sizeof(v3t2n3t3);
+        default:
+            break;
+        }
+
+        return 0;
+    }
+
+    static auto read_index(const vertices_data &data, const index_format ef, const size_t i) -> uint32_t {
+        switch (ef) {
+        case index_format::ui16:
+            return static_cast<const uint16_t*>(data.indices)[i];
+        case index_format::ui32:
+            return static_cast<const uint32_t*>(data.indices)[i];
+        default:
+            break;
+        }
+
+        return static_cast<uint32_t>(i);
+    }
+
+    auto read_triangles(const vertices_data &data, const vertices_desc &desc, std::vector<glm::vec3> &positions, std::vector<uint32_t> &indices) -> bool {
+        const auto stride = get_vertex_stride(desc.vf);
+        if (!data.vertices || stride == 0)
+            return false;
+
+        if (desc.primitive != GL_TRIANGLES && desc.primitive != GL_TRIANGLE_STRIP) {
+            journal::warning("%", "Can't read triangles from non triangle primitive");
+            return false;
+        }
+
+        const auto base = static_cast<uint32_t>(positions.size());
+        const auto base_ptr = static_cast<const char*>(data.vertices);
+
+        positions.reserve(positions.size() + data.vertices_num);
+        for (size_t i = 0; i < data.vertices_num; i++) {
+            glm::vec3 p;
+            memcpy(&p.x, base_ptr + stride * i, sizeof (glm::vec3));
+            positions.push_back(p);
+        }
+
+        const auto has_indices = data.indices && desc.ef != index_format::unknown;
+        const auto num = has_indices ? data.indices_num : data.vertices_num;
+
+        if (desc.primitive == GL_TRIANGLES) {
+            for (size_t i = 0; i + 2 < num; i += 3)
+                for (size_t k = 0; k < 3; k++)
+                    indices.push_back(base + read_index(data, has_indices ? desc.ef : index_format::unknown, i + k));
+        } else {
+            for (size_t i = 0; i + 2 < num; i++) {
+                const auto a = read_index(data, has_indices ? desc.ef : index_format::unknown, i);
+                const auto b = read_index(data, has_indices ? desc.ef : index_format::unknown, i + 1);
+                const auto c = read_index(data, has_indices ? desc.ef : index_format::unknown, i + 2);
+
+                // skip degenerated stitching triangles
+                if (a == b || b == c || a == c)
+                    continue;
+
+                indices.push_back(base + a);
+                indices.push_back(base + ((i & 1) ? c : b));
+                indices.push_back(base + ((i & 1) ? b : c));
+            }
+        }
+
+        return true;
+    }
+} // namespace video
@@ -71,7 +71,10 @@ namespace video {
                 break;
             }
 
-            return {{sh.attributes, sh.elements, sh.attributes_num, sh.elements_num}, {sh.mode, vf, ef}};
+            vertices_info info = {{sh.attributes, sh.elements, sh.attributes_num, sh.elements_num}, {sh.mode, vf, ef}, {}};
+            info.bounds = calc_vertices_bounds(info.data, info.desc);
+
+            return info;
         }
 
         auto make_plane(const glm::mat4 &transform) -> vertices_info {
@@ -140,19 +140,20 @@ namespace video {
     auto present(instance_t &vi, const std::vector<command_queue *> &buffers) -> void {
         assert(buffers.size() != 0);
 
-        for (auto &buf : buffers) {
-            for (auto &c : buf->commands) {
+        gl::reset_dispatch_cache();
 
-                gl::set_color_blend_state(buf->blend);
-                gl::set_rasterizer_state(buf->rasterizer);
-                gl::set_depth_stencil_state(buf->depth);
+        // commands don't touch pipeline state, so it is set once per buffer
+        for (auto &buf : buffers) {
+            gl::set_color_blend_state(buf->blend);
+            gl::set_rasterizer_state(buf->rasterizer);
+            gl::set_depth_stencil_state(buf->depth);
 
+            for (auto &c : buf->commands)
                 gl::dispath_command(c, *buf);
 
-                gl::clear_depth_stencil_state();
-                gl::clear_rasterizer_state();
-                gl::clear_color_blend_state();
-            }
+            gl::clear_depth_stencil_state();
+            gl::clear_rasterizer_state();
+            gl::clear_color_blend_state();
         }
 
         SDL_GL_SwapWindow(vi.window);
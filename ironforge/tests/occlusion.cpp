@@ -0,0 +1,84 @@
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+#include <core/math.hpp>
+
+#include <model.hpp>
+#include <culling.hpp>
+#include <occlusion.hpp>
+
+// occlusion stage has no GL dependency, so it runs headless against known boxes
+namespace {
+    int failures = 0;
+
+    auto check(const bool condition, const char *what) -> void {
+        if (condition)
+            return;
+
+        std::fprintf(stderr, "FAILED: %s\n", what);
+        failures++;
+    }
+
+    auto make_box(const glm::vec3 &min, const glm::vec3 &max) -> scene::model_instance {
+        scene::model_instance m;
+        m.aabb = {min, max};
+
+        return m;
+    }
+
+    // authored occluder box inside model geometry, like entities with "occluder": {"box": ...}
+    auto inner_box(const scene::model_instance &m, const float inset) -> scene::bound_box {
+        return {m.aabb.min + glm::vec3{inset}, m.aabb.max - glm::vec3{inset}};
+    }
+
+    auto cull(const std::vector<scene::bound_box> &occluders, std::vector<scene::render_candidate> &candidates, const glm::mat4 &view_projection) -> void {
+        std::vector<scene::occluder_instance> instances;
+        instances.reserve(occluders.size());
+
+        std::vector<scene::occluder_draw> draws;
+        for (const auto &box : occluders) {
+            instances.push_back(scene::make_box_occluder(box));
+            draws.push_back({&instances.back(), glm::mat4{1.f}});
+        }
+
+        scene::occlusion_buffer ob;
+        scene::rasterize_occluders(ob, draws, view_projection);
+        scene::cull_occluded_candidates(ob, candidates, view_projection);
+    }
+}
+
+int main() {
+    using namespace glm;
+
+    const auto projection = perspective(radians(60.f), 2.f, 0.1f, 100.f);
+    const auto view = lookAt(vec3{0.f, 0.f, 5.f}, vec3{0.f}, vec3{0.f, 1.f, 0.f});
+    const auto view_projection = projection * view;
+
+    const auto wall = make_box(vec3{-4.f, -4.f, -0.5f}, vec3{4.f, 4.f, 0.5f});
+    const auto behind = make_box(vec3{-0.5f, -0.5f, -5.5f}, vec3{0.5f, 0.5f, -4.5f});
+    const auto in_front = make_box(vec3{-0.5f, -0.5f, 1.5f}, vec3{0.5f, 0.5f, 2.5f});
+
+    {
+        std::vector<scene::render_candidate> candidates{{1, &behind}, {2, &in_front}, {3, &wall}};
+        cull({inner_box(wall, 0.1f)}, candidates, view_projection);
+
+        check(!candidates[0].visible, "box behind wall is occluded");
+        check(candidates[1].visible, "box in front of wall is visible");
+        check(candidates[2].visible, "wall is not occluded by its own occluder");
+    }
+
+    {
+        // camera facing neighbours with coplanar front faces, each one has its own inner occluder
+        const auto left = make_box(vec3{-2.f, -1.f, -1.f}, vec3{0.f, 1.f, 1.f});
+        const auto right = make_box(vec3{0.f, -1.f, -1.f}, vec3{2.f, 1.f, 1.f});
+
+        std::vector<scene::render_candidate> candidates{{1, &left}, {2, &right}};
+        cull({inner_box(left, 0.1f), inner_box(right, 0.1f)}, candidates, view_projection);
+
+        check(candidates[0].visible, "left neighbour is visible");
+        check(candidates[1].visible, "right neighbour is visible");
+    }
+
+    return failures == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}